@@ -49,6 +49,8 @@ namespace Caneda
  * \li FormatXmlSchematic
  * \li FormatXmlSymbol
  * \li FormatXmlLayout
+ * \li FormatBinary. This class implements an optional binary container for
+ * schematic, symbol and layout documents, described in \ref BinaryFormat.
  * \li FormatRawSimulation. This class does not implement a Caneda's specific
  * format, but rather reads the standard spice simulation raw waveform data.
  *
@@ -434,7 +436,39 @@ namespace Caneda
 </component>
 \endcode
  *
- * \sa  FormatXmlSchematic, FormatXmlSymbol, FormatXmlLayout, FormatRawSimulation, \ref ModelsFormat
+ * \section BinaryFormat Binary Format
+ * Large documents may also be saved in a compact binary format, selected by
+ * the file suffix (bsch, bsym and blay for schematics, symbols and layouts
+ * respectively). This file format is implemented by the FormatBinary class,
+ * and holds the same information as the xml formats, so documents can be
+ * converted back and forth by simply saving them with the other suffix.
+ *
+ * All values are written in big endian byte order, with QDataStream. The file
+ * starts with the following header:
+ * \li Magic number 0x4342494e ("CBIN").
+ * \li Version of the binary format.
+ * \li Document type: 1 for schematics, 2 for symbols and 3 for layouts.
+ * \li Caneda version used to write the file.
+ * \li Section table: the number of sections followed by an entry for each
+ * section, with its type, offset (relative to the end of the table), size in
+ * bytes and number of records.
+ *
+ * Sections may be read independently from each other, so a reader interested
+ * only in the connectivity of a schematic can skip the properties and
+ * paintings. The sections are:
+ * \li Strings: every string used in the document, stored only once. Other
+ * sections refer to strings by their index in this table.
+ * \li Components: one fixed size record per component, with its name and
+ * library indexes, position, rotation and mirroring matrix, properties
+ * position and number of properties.
+ * \li Properties: one record per component property, with its name and
+ * value indexes and visibility, in the same order as the components.
+ * \li Ports: one record per port symbol, with its label index and position.
+ * \li Wires: one record per wire, with the position of both ends.
+ * \li Paintings: one xml fragment per painting, as in the xml formats.
+ * \li Symbol: position and properties of a symbol document.
+ *
+ * \sa  FormatXmlSchematic, FormatXmlSymbol, FormatXmlLayout, FormatRawSimulation, FormatBinary, \ref ModelsFormat
  */
 
 } // namespace Caneda
\ No newline at end of file
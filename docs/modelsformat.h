@@ -64,8 +64,9 @@ namespace Caneda
  * properties modification.
  *
  * \section Syntax Models Syntax Rules
- * The general syntax rules follow. The parser implementation, for the case of
- * the SPICE output format is FormatSpice::generateNetlist(). In fact, these
+ * The general syntax rules follow. Models are parsed once into a ModelTemplate,
+ * which for the case of the SPICE output format is evaluated for each
+ * component by FormatSpice::generateNetlist(). In fact, these
  * rules are specifically designed to avoid conflicts with the SPICE syntax so,
  * in the future, the rules may be changed for other formats, or a better
  * syntax may be developed.
@@ -0,0 +1,395 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "batchprocessor.h"
+
+#include "chartview.h"
+#include "fileformats.h"
+#include "idocument.h"
+#include "library.h"
+#include "settings.h"
+#include "simulationjobmanager.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QMessageBox>
+#include <QProcess>
+#include <QSvgGenerator>
+#include <QThread>
+
+namespace Caneda
+{
+    //! \brief Constructor.
+    BatchProcessor::BatchProcessor(QObject *parent) :
+        QObject(parent),
+        m_width(1024),
+        m_plots(false)
+    {
+    }
+
+    //! \brief Returns true if \a command selects the batch mode.
+    bool BatchProcessor::isBatchCommand(const QString &command)
+    {
+        return command == "netlist" || command == "simulate" || command == "export";
+    }
+
+    /*!
+     * \brief Runs the batch command given in the command line \a arguments.
+     *
+     * \return The exit code of the application: 0 if all files were
+     * successfully processed, 1 otherwise.
+     */
+    int BatchProcessor::exec(const QStringList &arguments)
+    {
+        QCommandLineParser parser;
+        parser.setApplicationDescription(tr("Caneda batch mode"));
+        parser.addHelpOption();
+        parser.addPositionalArgument("command", tr("Command to run: netlist, simulate or export."));
+        parser.addPositionalArgument("files", tr("Schematic files to process."), "files...");
+
+        QCommandLineOption formatOption("format",
+                tr("Format of the exported images (png, jpg, svg, etc). Defaults to png."),
+                "format", "png");
+        QCommandLineOption widthOption("width",
+                tr("Width of the exported images, in pixels. Defaults to 1024."),
+                "width", "1024");
+        QCommandLineOption plotsOption("plots",
+                tr("Export the simulation waveforms after simulating."));
+        QCommandLineOption sweepOption("sweep",
+                tr("Simulate a netlist variant for each value of a .param parameter, "
+                   "for example rload=1k,10k,100k."),
+                "parameter=values");
+        QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                tr("Number of files processed in parallel. Defaults to the number of processor cores."),
+                "jobs", QString::number(qMax(1, QThread::idealThreadCount())));
+
+        parser.addOption(formatOption);
+        parser.addOption(widthOption);
+        parser.addOption(plotsOption);
+        parser.addOption(sweepOption);
+        parser.addOption(jobsOption);
+        parser.process(arguments);
+
+        QStringList files = parser.positionalArguments();
+        m_command = files.takeFirst();
+
+        if(files.isEmpty()) {
+            qWarning() << "Error: No files given";
+            return 1;
+        }
+
+        m_format = parser.value(formatOption).toLower();
+        if(m_format != "svg" && !QImageWriter::supportedImageFormats().contains(m_format.toLatin1())) {
+            qWarning() << "Error: Unsupported image format" << m_format;
+            return 1;
+        }
+
+        m_width = parser.value(widthOption).toInt();
+        if(m_width < 1) {
+            qWarning() << "Error: Invalid image width" << parser.value(widthOption);
+            return 1;
+        }
+
+        m_plots = parser.isSet(plotsOption);
+
+        m_sweep = parser.value(sweepOption);
+        if(!m_sweep.isEmpty() && (m_sweep.section('=', 0, 0).trimmed().isEmpty() ||
+                                  m_sweep.section('=', 1).trimmed().isEmpty())) {
+            qWarning() << "Error: Invalid parameter sweep" << m_sweep;
+            return 1;
+        }
+
+        // Split the files among several processes
+        int jobs = qMax(1, parser.value(jobsOption).toInt());
+        if(jobs > 1 && files.size() > 1) {
+            return runWorkers(files, jobs);
+        }
+
+        // File formats report errors with message boxes, which must be
+        // closed as there is nobody to do it.
+        qApp->installEventFilter(this);
+
+        Settings::instance()->load();
+        LibraryManager::instance()->loadLibraryTree();
+
+        int failed = 0;
+        foreach(const QString &fileName, files) {
+            if(!processFile(fileName)) {
+                ++failed;
+            }
+        }
+
+        if(failed > 0) {
+            qWarning() << "Error:" << failed << "of" << files.size() << "files failed";
+            return 1;
+        }
+
+        return 0;
+    }
+
+    /*!
+     * \brief Closes every message box as soon as it is shown, writing its
+     * text to the standard error output.
+     */
+    bool BatchProcessor::eventFilter(QObject *object, QEvent *event)
+    {
+        if(event->type() == QEvent::Show) {
+            QMessageBox *box = qobject_cast<QMessageBox*>(object);
+            if(box) {
+                qWarning() << "Error:" << box->text();
+                QMetaObject::invokeMethod(box, "done", Qt::QueuedConnection,
+                                          Q_ARG(int, QMessageBox::Cancel));
+            }
+        }
+
+        return QObject::eventFilter(object, event);
+    }
+
+    /*!
+     * \brief Runs the same batch command on \a files with \a jobs worker
+     * processes.
+     *
+     * The files are distributed round robin among the processes, so that
+     * each one gets a similar share of them. The output of the workers is
+     * forwarded to the output of this process.
+     *
+     * \return 0 if all workers succeeded, 1 otherwise.
+     */
+    int BatchProcessor::runWorkers(const QStringList &files, int jobs)
+    {
+        jobs = qMin(jobs, files.size());
+
+        QStringList options;
+        options << m_command;
+        options << "--format" << m_format;
+        options << "--width" << QString::number(m_width);
+        if(m_plots) {
+            options << "--plots";
+        }
+        if(!m_sweep.isEmpty()) {
+            options << "--sweep" << m_sweep;
+        }
+        options << "--jobs" << "1";
+
+        QList<QStringList> chunks;
+        for(int i = 0; i < files.size(); ++i) {
+            if(i < jobs) {
+                chunks << QStringList();
+            }
+            chunks[i % jobs] << files.at(i);
+        }
+
+        QList<QProcess*> workers;
+        foreach(const QStringList &chunk, chunks) {
+            QProcess *worker = new QProcess(this);
+            worker->setProcessChannelMode(QProcess::ForwardedChannels);
+            worker->start(QCoreApplication::applicationFilePath(), options + chunk);
+            workers << worker;
+        }
+
+        int status = 0;
+        foreach(QProcess *worker, workers) {
+            if(!worker->waitForFinished(-1) || worker->exitStatus() != QProcess::NormalExit ||
+                    worker->exitCode() != 0) {
+                status = 1;
+            }
+            delete worker;
+        }
+
+        return status;
+    }
+
+    /*!
+     * \brief Exports \a source to \a imageFile, keeping the aspect ratio of
+     * \a size.
+     *
+     * \a source may be any object with an exportImage(QPaintDevice&) method,
+     * such as a document or a chart view.
+     */
+    template<typename T>
+    bool BatchProcessor::writeImage(T *source, const QSizeF &size, const QString &imageFile)
+    {
+        if(size.isEmpty()) {
+            qWarning() << "Error: Nothing to export to" << imageFile;
+            return false;
+        }
+
+        int width = m_width;
+        int height = qMax(1, qRound(m_width * size.height() / size.width()));
+
+        if(m_format == "svg") {
+            QSvgGenerator svg;
+            svg.setFileName(imageFile);
+            svg.setSize(QSize(width, height));
+            source->exportImage(svg);
+            return true;
+        }
+
+        QImage image(width, height, QImage::Format_RGB32);
+        image.fill(qRgb(255, 255, 255));
+        source->exportImage(image);
+
+        if(!image.save(imageFile, m_format.toLatin1().constData())) {
+            qWarning() << "Error: Could not write" << imageFile;
+            return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Runs the batch command on the schematic \a fileName.
+     *
+     * The netlist and images are written next to the schematic, named after
+     * it.
+     */
+    bool BatchProcessor::processFile(const QString &fileName)
+    {
+        QFileInfo info(fileName);
+        if(info.suffix() != "xsch" && info.suffix() != "bsch") {
+            qWarning() << "Error: Unknown file format" << fileName;
+            return false;
+        }
+
+        SchematicDocument document;
+        document.setFileName(info.absoluteFilePath());
+        if(!document.load()) {
+            qWarning() << "Error: Could not load" << fileName;
+            return false;
+        }
+
+        QString baseName = info.absolutePath() + "/" + info.completeBaseName();
+
+        if(m_command == "export") {
+            return writeImage(&document, document.documentSize(), baseName + "." + m_format);
+        }
+
+        FormatSpice format(&document);
+        if(!format.save()) {
+            qWarning() << "Error: Could not write the netlist of" << fileName;
+            return false;
+        }
+
+        if(m_command == "simulate") {
+            QStringList rawFiles;
+            bool ok = simulate(&document, format.fileName(), &rawFiles);
+
+            if(m_plots) {
+                foreach(const QString &rawFile, rawFiles) {
+                    ok = exportPlots(rawFile) && ok;
+                }
+            }
+
+            return ok;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Runs the simulator on the netlist \a netlistFile of \a
+     * document, and waits for it to finish.
+     *
+     * If a parameter sweep was given, a variant of the netlist is simulated
+     * for each value instead, as many at the same time as allowed by the
+     * SimulationJobManager.
+     *
+     * The raw files expected from the successful simulations are appended
+     * to \a rawFiles. They are named after the log files of the jobs.
+     *
+     * \return True if all simulations succeeded, false otherwise.
+     *
+     * \sa SchematicDocument::simulationJob(), SimulationJobManager::addSweep()
+     */
+    bool BatchProcessor::simulate(SchematicDocument *document, const QString &netlistFile,
+                                  QStringList *rawFiles)
+    {
+        SimulationJobManager *jobManager = SimulationJobManager::instance();
+
+        QEventLoop loop;
+        connect(jobManager, SIGNAL(jobFinished(int)), &loop, SLOT(quit()));
+
+        bool ok = true;
+        QList<int> jobs;
+        if(m_sweep.isEmpty()) {
+            jobs << jobManager->addJob(document->simulationJob());
+        }
+        else {
+            QString parameter = m_sweep.section('=', 0, 0).trimmed();
+            QStringList values = m_sweep.section('=', 1).split(',', QString::SkipEmptyParts);
+
+            jobs = jobManager->addSweep(document->simulationJob(false), netlistFile,
+                                        parameter, values);
+            if(jobs.size() != values.size()) {
+                qWarning() << "Error: Could not write every variant of" << netlistFile;
+                ok = false;
+            }
+        }
+
+        foreach(int job, jobs) {
+            while(jobManager->isActive(job)) {
+                loop.exec();
+            }
+
+            SimulationJobManager::JobStatus status = jobManager->status(job);
+            QString logFile = jobManager->logFile(job);
+            jobManager->removeJob(job);
+
+            if(status != SimulationJobManager::Finished) {
+                qWarning() << "Error: Simulation of" << document->fileName() << "failed, see" << logFile;
+                ok = false;
+                continue;
+            }
+
+            QFileInfo info(logFile);
+            *rawFiles << info.absolutePath() + "/" + info.completeBaseName() + ".raw";
+        }
+
+        return ok;
+    }
+
+    /*!
+     * \brief Exports the waveforms of the simulation results \a rawFile to
+     * an image named after it.
+     */
+    bool BatchProcessor::exportPlots(const QString &rawFile)
+    {
+        SimulationDocument document;
+        document.setFileName(rawFile);
+        if(!document.load()) {
+            qWarning() << "Error: Could not load the simulation results" << rawFile;
+            return false;
+        }
+
+        ChartView view(document.chartScene());
+        view.populate();
+
+        QFileInfo info(rawFile);
+        QString imageFile = info.absolutePath() + "/" + info.completeBaseName() + "-waveforms." + m_format;
+
+        return writeImage(&view, document.documentSize(), imageFile);
+    }
+
+} // namespace Caneda
@@ -0,0 +1,92 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef BATCH_PROCESSOR_H
+#define BATCH_PROCESSOR_H
+
+#include <QObject>
+#include <QStringList>
+
+// Forward declarations
+class QSizeF;
+
+namespace Caneda
+{
+    // Forward declarations
+    class SchematicDocument;
+
+    /*!
+     * \brief This class runs Caneda from the command line, without showing
+     * any window.
+     *
+     * The batch mode is selected by giving a command as the first argument
+     * of caneda, followed by the options and the schematic files to process:
+     * \li netlist: writes the spice netlist of each schematic.
+     * \li simulate: writes the netlist and runs the simulator configured in
+     * the user settings. With the --plots option, the resulting waveforms
+     * are also exported to an image. With the --sweep option, a variant of
+     * the netlist is simulated for each value of a parameter, running the
+     * variants concurrently.
+     * \li export: exports each schematic to an image.
+     *
+     * Several files are processed in parallel by splitting them among
+     * --jobs worker processes, each one running caneda again on its share of
+     * the files. Processes are used instead of threads as documents, scenes
+     * and their items can only be used from the gui thread.
+     *
+     * Dialogs shown by the file formats on errors are closed right away,
+     * and their messages written to the standard error output instead.
+     *
+     * \sa SimulationJobManager
+     */
+    class BatchProcessor : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit BatchProcessor(QObject *parent = 0);
+
+        static bool isBatchCommand(const QString &command);
+
+        int exec(const QStringList &arguments);
+
+    protected:
+        bool eventFilter(QObject *object, QEvent *event);
+
+    private:
+        int runWorkers(const QStringList &files, int jobs);
+        bool processFile(const QString &fileName);
+
+        bool simulate(SchematicDocument *document, const QString &netlistFile,
+                      QStringList *rawFiles);
+        bool exportPlots(const QString &rawFile);
+
+        template<typename T>
+        bool writeImage(T *source, const QSizeF &size, const QString &imageFile);
+
+        QString m_command;  // Batch command being run
+        QString m_format;  // Format of the exported images
+        int m_width;  // Width of the exported images, in pixels
+        bool m_plots;  // Export the waveforms after simulating
+        QString m_sweep;  // Parameter sweep, as "parameter=value1,value2,..."
+    };
+
+} // namespace Caneda
+
+#endif //BATCH_PROCESSOR_H
@@ -19,15 +19,547 @@
 
 #include "chartitem.h"
 
+#include <QFile>
+#include <QtEndian>
+#include <QtMath>
+
+#include <qwt_point_data.h>
+
+#include <cstring>
+
 namespace Caneda
 {
+    /*************************************************************************
+     *                            ChartSeriesData                            *
+     *************************************************************************/
+    /*!
+     * \brief Constructs a new strided view of a mapped raw file.
+     *
+     * \param file File owning the mapping, shared among all views.
+     * \param data Start of the mapped data records.
+     * \param npoints Number of records (points) available.
+     * \param nvars Number of variables in each record. The first variable is
+     * always used as the x coordinate (time, frequency, etc).
+     * \param variable Index of the variable used as the y coordinate.
+     * \param format Conversion applied to the stored values.
+     */
+    ChartSeriesData::ChartSeriesData(const QSharedPointer<QFile> &file, const uchar *data,
+            int npoints, int nvars, int variable, Format format) :
+        m_file(file),
+        m_data(data),
+        m_npoints(npoints),
+        m_variable(variable),
+        m_format(format)
+    {
+        m_width = (format == Real) ? sizeof(double) : 2*sizeof(double);
+        m_stride = nvars * m_width;
+    }
+
+    //! \brief Returns the number of samples (points) of the waveform.
+    size_t ChartSeriesData::size() const
+    {
+        return m_npoints;
+    }
+
+    /*!
+     * \brief Returns the sample at position \a i.
+     *
+     * The values are read directly from the mapped file. Complex values are
+     * converted to magnitude (dB) or phase (degrees), and the frequency base
+     * (the first variable) is converted to its magnitude.
+     */
+    QPointF ChartSeriesData::sample(size_t i) const
+    {
+        if(m_format == Real) {
+            return QPointF(value(i, 0, 0), value(i, m_variable, 0));
+        }
+
+        double x = qSqrt(value(i, 0, 0)*value(i, 0, 0) + value(i, 0, 1)*value(i, 0, 1));
+
+        double real = value(i, m_variable, 0);
+        double imaginary = value(i, m_variable, 1);
+
+        if(m_format == Magnitude) {
+            return QPointF(x, 20*log10(qSqrt(real*real + imaginary*imaginary)));
+        }
+
+        return QPointF(x, qAtan(imaginary/real) * 180/M_PI);
+    }
+
+    /*!
+     * \brief Returns the bounding rectangle of the waveform.
+     *
+     * The rectangle is calculated the first time it is requested, and cached
+     * afterwards, as the mapped data never changes.
+     */
+    QRectF ChartSeriesData::boundingRect() const
+    {
+        if(d_boundingRect.width() < 0.0) {
+            d_boundingRect = qwtBoundingRect(*this);
+        }
+
+        return d_boundingRect;
+    }
+
+    /*!
+     * \brief Returns the real (\a part = 0) or imaginary (\a part = 1) part of
+     * \a variable in record \a i.
+     *
+     * The records are not necessarily aligned, so the value is copied out of
+     * the mapping instead of being dereferenced in place.
+     */
+    double ChartSeriesData::value(size_t i, int variable, int part) const
+    {
+        const uchar *pos = m_data + i*m_stride + variable*m_width + part*sizeof(double);
+
+        quint64 bits = qFromLittleEndian<quint64>(pos);
+        double result;
+        memcpy(&result, &bits, sizeof(double));
+
+        return result;
+    }
+
+
+    /*************************************************************************
+     *                            ChartSeriesArray                           *
+     *************************************************************************/
+    /*!
+     * \brief Constructs a new view of the values currently available in the
+     * arrays \a x and \a y.
+     *
+     * Values appended to the arrays afterwards are not part of this view.
+     */
+    ChartSeriesArray::ChartSeriesArray(const Values &x, const Values &y) :
+        m_x(x),
+        m_y(y)
+    {
+        m_size = qMin(m_x->size(), m_y->size());
+    }
+
+    //! \brief Returns the number of samples (points) of the waveform.
+    size_t ChartSeriesArray::size() const
+    {
+        return m_size;
+    }
+
+    //! \brief Returns the sample at position \a i.
+    QPointF ChartSeriesArray::sample(size_t i) const
+    {
+        return QPointF(m_x->at(i), m_y->at(i));
+    }
+
+    /*!
+     * \brief Returns the bounding rectangle of the waveform.
+     *
+     * The rectangle is calculated the first time it is requested, and cached
+     * afterwards, as the samples of this view never change.
+     */
+    QRectF ChartSeriesArray::boundingRect() const
+    {
+        if(d_boundingRect.width() < 0.0) {
+            d_boundingRect = qwtBoundingRect(*this);
+        }
+
+        return d_boundingRect;
+    }
+
+
+    /*************************************************************************
+     *                           ChartSeriesLevels                           *
+     *************************************************************************/
+    /*!
+     * \brief Constructs empty levels, to be built by update().
+     */
+    ChartSeriesLevels::ChartSeriesLevels() :
+        m_valid(true),
+        m_sampleCount(0),
+        m_lastX(0),
+        m_boundingRect(1.0, 1.0, -2.0, -2.0)  // Invalid
+    {
+    }
+
+    /*!
+     * \brief Extends the levels of detail with the samples of \a data not
+     * processed yet.
+     *
+     * \a data must hold the samples already processed, followed by the new
+     * ones. The first level groups the samples in buckets of 16 samples, and
+     * each following level groups 4 buckets of the previous one, until a
+     * level with less than 256 buckets is reached. As each bucket keeps only
+     * two points, the levels take about a quarter of the memory of the
+     * samples themselves.
+     *
+     * Only the buckets holding new samples are built (including the last
+     * bucket of each level, which may have been partial), so extending the
+     * levels costs about the same as building them for the new samples only.
+     */
+    void ChartSeriesLevels::update(const QwtSeriesData<QPointF> *data)
+    {
+        const int n = data->size();
+        const int first = m_sampleCount;
+        if(n <= first) {
+            return;
+        }
+
+        // Check the x values are still sorted, and extend the bounding rect
+        for(int i = first; i < n; ++i) {
+            QPointF point = data->sample(i);
+            if(i > 0 && point.x() < m_lastX) {
+                m_valid = false;
+            }
+            m_lastX = point.x();
+
+            if(m_boundingRect.width() < 0.0) {
+                m_boundingRect = QRectF(point, QSizeF(0.0, 0.0));
+            }
+            else {
+                m_boundingRect.setLeft(qMin(m_boundingRect.left(), point.x()));
+                m_boundingRect.setRight(qMax(m_boundingRect.right(), point.x()));
+                m_boundingRect.setTop(qMin(m_boundingRect.top(), point.y()));
+                m_boundingRect.setBottom(qMax(m_boundingRect.bottom(), point.y()));
+            }
+        }
+
+        m_sampleCount = n;
+
+        if(!m_valid) {
+            m_levels.clear();
+            m_bucketSizes.clear();
+            return;
+        }
+
+        // First level, built from the samples
+        if(m_levels.isEmpty()) {
+            m_levels.append(QVector<QPointF>());
+            m_bucketSizes.append(16);
+        }
+
+        const int bucketSize = m_bucketSizes.first();
+        int start = first / bucketSize;  // First bucket to be rebuilt
+
+        QVector<QPointF> &points = m_levels[0];
+        points.resize(2 * start);
+        points.reserve(2 * (n / bucketSize + 1));
+
+        for(int i = start * bucketSize; i < n; i += bucketSize) {
+            QPointF min = data->sample(i);
+            QPointF max = min;
+            int minIndex = i;
+            int maxIndex = i;
+
+            int end = qMin(n, i + bucketSize);
+            for(int j = i; j < end; ++j) {
+                QPointF point = data->sample(j);
+                if(point.y() < min.y()) {
+                    min = point;
+                    minIndex = j;
+                }
+                if(point.y() > max.y()) {
+                    max = point;
+                    maxIndex = j;
+                }
+            }
+
+            appendBucket(points, minIndex, min, maxIndex, max);
+        }
+
+        // Following levels, each one built from the previous one. A new
+        // level is added once the previous one has 256 buckets or more.
+        int changed = 2 * start;  // First point of the previous level rebuilt
+        for(int level = 1; level < m_levels.size() || m_levels.last().size() / 2 >= 256; ++level) {
+            start = changed / 8;
+            if(level == m_levels.size()) {
+                m_levels.append(QVector<QPointF>());
+                m_bucketSizes.append(4 * m_bucketSizes.last());
+                start = 0;
+            }
+
+            const QVector<QPointF> &previous = m_levels.at(level - 1);
+            QVector<QPointF> &levelPoints = m_levels[level];
+            levelPoints.resize(2 * start);
+            levelPoints.reserve(previous.size() / 4 + 2);
+
+            for(int i = 8 * start; i < previous.size(); i += 8) {
+                int minIndex = i;
+                int maxIndex = i;
+
+                int end = qMin(previous.size(), i + 8);
+                for(int j = i; j < end; ++j) {
+                    if(previous.at(j).y() < previous.at(minIndex).y()) {
+                        minIndex = j;
+                    }
+                    if(previous.at(j).y() > previous.at(maxIndex).y()) {
+                        maxIndex = j;
+                    }
+                }
+
+                appendBucket(levelPoints, minIndex, previous.at(minIndex), maxIndex, previous.at(maxIndex));
+            }
+
+            changed = 2 * start;
+        }
+    }
+
+    /*!
+     * \brief Appends the minimum and maximum points of a bucket to \a points,
+     * keeping their order in the x axis.
+     */
+    void ChartSeriesLevels::appendBucket(QVector<QPointF> &points, int minIndex, const QPointF &min,
+            int maxIndex, const QPointF &max)
+    {
+        if(minIndex <= maxIndex) {
+            points.append(min);
+            points.append(max);
+        }
+        else {
+            points.append(max);
+            points.append(min);
+        }
+    }
+
+
+    /*************************************************************************
+     *                          ChartSeriesDecimator                         *
+     *************************************************************************/
+    /*!
+     * \brief Constructs a new decimator.
+     *
+     * \param data Samples of the waveform. This object takes ownership of the
+     * data.
+     * \param levels Levels of detail of the waveform.
+     */
+    ChartSeriesDecimator::ChartSeriesDecimator(QwtSeriesData<QPointF> *data,
+            const QSharedPointer<ChartSeriesLevels> &levels) :
+        m_data(data),
+        m_levels(levels),
+        m_level(-1),
+        m_first(0)
+    {
+        m_count = m_data->size();
+    }
+
+    //! \brief Destructor.
+    ChartSeriesDecimator::~ChartSeriesDecimator()
+    {
+        delete m_data;
+    }
+
+    /*!
+     * \brief Replaces the samples and levels of detail of the waveform, for
+     * example to display the samples appended while following a simulation.
+     *
+     * \param data New samples of the waveform. This object takes ownership
+     * of the data, deleting the previous one.
+     * \param levels Levels of detail of the new samples.
+     *
+     * The whole waveform is used until the next call to setView().
+     */
+    void ChartSeriesDecimator::setData(QwtSeriesData<QPointF> *data,
+            const QSharedPointer<ChartSeriesLevels> &levels)
+    {
+        delete m_data;
+        m_data = data;
+        m_levels = levels;
+
+        m_level = -1;
+        m_first = 0;
+        m_count = m_data->size();
+    }
+
+    /*!
+     * \brief Sets the visible range of the waveform.
+     *
+     * \param xMin Minimum visible x value.
+     * \param xMax Maximum visible x value.
+     * \param pixels Width in pixels of the visible range.
+     */
+    void ChartSeriesDecimator::setView(double xMin, double xMax, int pixels)
+    {
+        const int n = m_data->size();
+
+        // Use all the samples if no levels are available
+        m_level = -1;
+        m_first = 0;
+        m_count = n;
+
+        if(!m_levels || !m_levels->isValid() || n == 0 || pixels <= 0) {
+            return;
+        }
+
+        // Visible range, including one sample at each side to draw the
+        // lines going out of the plot.
+        int first = qMax(0, lowerIndex(xMin) - 1);
+        int last = qMin(n - 1, lowerIndex(xMax));
+
+        // Use the coarsest level still having one bucket per pixel. The
+        // levels may hold more samples than the data of this view, but never
+        // less, as they are extended before handing out new data.
+        for(int i = m_levels->levelCount() - 1; i >= 0; --i) {
+            int bucketSize = m_levels->bucketSize(i);
+            if((last - first + 1) / bucketSize >= pixels) {
+                const int levelFirst = 2 * (first / bucketSize);
+                const int levelEnd = qMin(2 * (last / bucketSize + 1), m_levels->level(i).size());
+                if(levelEnd <= levelFirst) {
+                    break;
+                }
+
+                m_level = i;
+                m_first = levelFirst;
+                m_count = levelEnd - levelFirst;
+                return;
+            }
+        }
+
+        m_first = first;
+        m_count = last - first + 1;
+    }
+
+    //! \brief Returns the number of points of the visible range.
+    size_t ChartSeriesDecimator::size() const
+    {
+        return m_count;
+    }
+
+    //! \brief Returns the point at position \a i of the visible range.
+    QPointF ChartSeriesDecimator::sample(size_t i) const
+    {
+        if(m_level >= 0) {
+            return m_levels->level(m_level).at(m_first + i);
+        }
+
+        return m_data->sample(m_first + i);
+    }
+
+    /*!
+     * \brief Returns the bounding rectangle of the whole waveform (not only
+     * the visible range), to be able to autoscale the plot.
+     *
+     * The rectangle kept by the levels is used when they hold the same
+     * samples, to avoid going through all the samples of each new data.
+     */
+    QRectF ChartSeriesDecimator::boundingRect() const
+    {
+        if(m_levels && m_levels->sampleCount() == int(m_data->size())) {
+            return m_levels->boundingRect();
+        }
+
+        return m_data->boundingRect();
+    }
+
+    /*!
+     * \brief Returns the index of the first sample whose x value is not less
+     * than \a x, or the number of samples if there is no such sample.
+     */
+    int ChartSeriesDecimator::lowerIndex(double x) const
+    {
+        int low = 0;
+        int high = m_data->size();
+
+        while(low < high) {
+            int middle = low + (high - low) / 2;
+            if(m_data->sample(middle).x() < x) {
+                low = middle + 1;
+            }
+            else {
+                high = middle;
+            }
+        }
+
+        return low;
+    }
+
+
+    /*************************************************************************
+     *                              ChartSeries                              *
+     *************************************************************************/
     /*!
      * \brief Constructor
      *
      * \param title Title of the curve
      */
-    ChartSeries::ChartSeries(const QString &title) : QwtPlotCurve(title)
+    ChartSeries::ChartSeries(const QString &title) :
+        QwtPlotCurve(title),
+        m_levels(new ChartSeriesLevels())
     {
     }
 
+    /*!
+     * \brief Sets the data of the curve, taking ownership of \a data.
+     *
+     * \param data New data of the curve.
+     * \param appended True if \a data holds the samples of the previous data
+     * followed by new ones (for example, while following a simulation in
+     * progress). The levels of detail are then extended with the new
+     * samples only. Otherwise, new levels are built for \a data, and the
+     * views keep the previous ones until they are given the new data.
+     *
+     * \sa createViewData()
+     */
+    void ChartSeries::setSeriesData(QwtSeriesData<QPointF> *data, bool appended)
+    {
+        setData(data);
+
+        if(!appended) {
+            m_levels = QSharedPointer<ChartSeriesLevels>(new ChartSeriesLevels());
+        }
+    }
+
+    /*!
+     * \brief Creates the data to be used by a copy of this curve in a view.
+     *
+     * The returned data shares the samples of this curve (no samples are
+     * copied) and its levels of detail, which are brought up to date with
+     * the samples first. The caller takes ownership of the returned data.
+     *
+     * \sa updateViewData(), ChartSeriesDecimator, ChartView::populate()
+     */
+    QwtSeriesData<QPointF>* ChartSeries::createViewData()
+    {
+        m_levels->update(data());
+        return new ChartSeriesDecimator(copySamples(), m_levels);
+    }
+
+    /*!
+     * \brief Gives the current samples of this curve to the data of a view,
+     * previously created by createViewData().
+     *
+     * This allows the views to display new samples, for example while
+     * following a simulation in progress, without recreating their curves.
+     *
+     * \sa createViewData(), ChartView::updateItems()
+     */
+    void ChartSeries::updateViewData(ChartSeriesDecimator *viewData)
+    {
+        m_levels->update(data());
+        viewData->setData(copySamples(), m_levels);
+    }
+
+    /*!
+     * \brief Returns a new data object with the samples of this curve,
+     * sharing them whenever possible.
+     */
+    QwtSeriesData<QPointF>* ChartSeries::copySamples() const
+    {
+        const ChartSeriesData *mappedData = dynamic_cast<const ChartSeriesData*>(data());
+        const ChartSeriesArray *arrayData = dynamic_cast<const ChartSeriesArray*>(data());
+        const QwtPointArrayData *pointArrayData = dynamic_cast<const QwtPointArrayData*>(data());
+
+        if(mappedData) {
+            return new ChartSeriesData(*mappedData);
+        }
+        if(arrayData) {
+            return new ChartSeriesArray(*arrayData);
+        }
+        if(pointArrayData) {
+            return new QwtPointArrayData(pointArrayData->xData(), pointArrayData->yData());
+        }
+
+        QVector<QPointF> points;
+        points.reserve(dataSize());
+        for(size_t i = 0; i < dataSize(); ++i) {
+            points.append(sample(i));
+        }
+        return new QwtPointSeriesData(points);
+    }
+
 } // namespace Caneda
@@ -20,17 +20,198 @@
 #ifndef CHART_ITEM_H
 #define CHART_ITEM_H
 
+#include <QSharedPointer>
 #include <QString>
+#include <QVector>
 
 #include <qwt_plot_curve.h>
+#include <qwt_series_data.h>
+
+// Forward declarations
+class QFile;
 
 namespace Caneda
 {
+    /*!
+     * \brief This class provides a read-only view of one waveform stored in
+     * a memory mapped raw simulation file.
+     *
+     * Binary raw files store the simulation data as consecutive records (one
+     * record per point), each one holding the values of all variables as 64
+     * bit little endian floats (two floats for complex values). Instead of
+     * copying each variable into its own array, this class keeps a pointer
+     * to the mapped data and reads the requested variables on the fly, using
+     * the record size as the stride between consecutive samples. This way,
+     * opening a big raw file only uses the operating system page cache.
+     *
+     * The mapped file is shared among all series created from it, and is
+     * unmapped when the last of them is destroyed.
+     *
+     * \sa ChartSeries, FormatRawSimulation
+     */
+    class ChartSeriesData : public QwtSeriesData<QPointF>
+    {
+    public:
+        //! \brief Conversion applied to the stored values.
+        enum Format {
+            Real,       ///< Real values, returned as they are.
+            Magnitude,  ///< Complex values, returned as magnitude in dB.
+            Phase       ///< Complex values, returned as phase in degrees.
+        };
+
+        ChartSeriesData(const QSharedPointer<QFile> &file, const uchar *data,
+                int npoints, int nvars, int variable, Format format);
+
+        virtual size_t size() const;
+        virtual QPointF sample(size_t i) const;
+        virtual QRectF boundingRect() const;
+
+    private:
+        double value(size_t i, int variable, int part) const;
+
+        QSharedPointer<QFile> m_file;  //! \brief Mapped file, kept alive while the data is in use
+        const uchar *m_data;           //! \brief Start of the mapped data records
+
+        int m_npoints;    //! \brief Number of records (points) available
+        int m_stride;     //! \brief Size in bytes of one record
+        int m_width;      //! \brief Size in bytes of one value (real or complex)
+        int m_variable;   //! \brief Index of the variable used as y coordinate
+        Format m_format;  //! \brief Conversion applied to the stored values
+    };
+
+    /*!
+     * \brief This class provides a read-only view of the first samples of a
+     * waveform stored in growing arrays.
+     *
+     * Ascii raw files are read into one array of values per variable, and new
+     * values are appended to the arrays while following a simulation in
+     * progress. The arrays are shared through pointers instead of Qt's
+     * implicit sharing, so that appending values never copies them. Each
+     * view uses only the samples available when it was created, and new
+     * views are created to display the appended samples.
+     *
+     * \sa ChartSeries, FormatRawSimulation
+     */
+    class ChartSeriesArray : public QwtSeriesData<QPointF>
+    {
+    public:
+        //! \brief Growing array of values, shared by the reader and the views.
+        typedef QSharedPointer<QVector<double> > Values;
+
+        ChartSeriesArray(const Values &x, const Values &y);
+
+        virtual size_t size() const;
+        virtual QPointF sample(size_t i) const;
+        virtual QRectF boundingRect() const;
+
+    private:
+        Values m_x;  //! \brief Values of the x coordinate
+        Values m_y;  //! \brief Values of the y coordinate
+        int m_size;  //! \brief Number of samples available to this view
+    };
+
+    /*!
+     * \brief This class holds a multi-resolution min/max representation of
+     * a waveform.
+     *
+     * The samples of the waveform are grouped into buckets of consecutive
+     * samples, and only the minimum and maximum samples of each bucket are
+     * kept. Each level groups the buckets of the previous one, resulting in
+     * a pyramid of coarser and coarser representations of the waveform.
+     * Drawing a level with (at least) one bucket per pixel looks the same as
+     * drawing all the samples, as spikes are always kept, while the number
+     * of points drawn depends only on the plot width.
+     *
+     * Levels can only be used if the x values of the waveform are sorted
+     * (for example time or frequency), which is checked while building the
+     * levels. The levels can be shared among several views, and are
+     * extended by update() as samples are appended to the waveform, only the
+     * last (partial) bucket of each level being rebuilt.
+     *
+     * \sa ChartSeriesDecimator, ChartSeries
+     */
+    class ChartSeriesLevels
+    {
+    public:
+        ChartSeriesLevels();
+
+        void update(const QwtSeriesData<QPointF> *data);
+
+        //! \brief Returns true if the levels can be used (x values are sorted)
+        bool isValid() const { return m_valid; }
+        //! \brief Returns the number of samples the levels were built from
+        int sampleCount() const { return m_sampleCount; }
+        //! \brief Returns the bounding rectangle of the samples the levels were built from
+        QRectF boundingRect() const { return m_boundingRect; }
+
+        //! \brief Returns the number of levels available
+        int levelCount() const { return m_levels.size(); }
+        //! \brief Returns the number of samples of each bucket of \a level
+        int bucketSize(int level) const { return m_bucketSizes.at(level); }
+        //! \brief Returns the points (minimum and maximum of each bucket) of \a level
+        const QVector<QPointF>& level(int level) const { return m_levels.at(level); }
+
+    private:
+        void appendBucket(QVector<QPointF> &points, int minIndex, const QPointF &min,
+                int maxIndex, const QPointF &max);
+
+        bool m_valid;                        //! \brief True if the x values are sorted
+        int m_sampleCount;                   //! \brief Number of samples already processed
+        double m_lastX;                      //! \brief X value of the last sample processed
+        QRectF m_boundingRect;               //! \brief Bounding rectangle of the samples processed
+        QVector<int> m_bucketSizes;          //! \brief Samples per bucket of each level
+        QVector<QVector<QPointF> > m_levels; //! \brief Points of each level, two per bucket
+    };
+
+    /*!
+     * \brief This class provides the data of a curve of a ChartView,
+     * choosing the level of detail according to the visible range.
+     *
+     * Before drawing, the view sets the visible x range and the width in
+     * pixels of the plot. If the visible range holds many more samples than
+     * pixels, the coarsest level of the ChartSeriesLevels still having at
+     * least one bucket per pixel is used. Otherwise, the samples of the
+     * visible range are used directly. In both cases only the visible range
+     * (plus one point at each side) is returned.
+     *
+     * \sa ChartSeriesLevels, ChartView
+     */
+    class ChartSeriesDecimator : public QwtSeriesData<QPointF>
+    {
+    public:
+        ChartSeriesDecimator(QwtSeriesData<QPointF> *data, const QSharedPointer<ChartSeriesLevels> &levels);
+        ~ChartSeriesDecimator();
+
+        void setData(QwtSeriesData<QPointF> *data, const QSharedPointer<ChartSeriesLevels> &levels);
+
+        void setView(double xMin, double xMax, int pixels);
+
+        virtual size_t size() const;
+        virtual QPointF sample(size_t i) const;
+        virtual QRectF boundingRect() const;
+
+    private:
+        int lowerIndex(double x) const;
+
+        QwtSeriesData<QPointF> *m_data;              //! \brief Samples of the waveform, owned by this object
+        QSharedPointer<ChartSeriesLevels> m_levels;  //! \brief Levels of detail of the waveform
+
+        int m_level;  //! \brief Level in use, or -1 if using the samples directly
+        int m_first;  //! \brief First point of the visible range
+        int m_count;  //! \brief Number of points of the visible range
+    };
+
     /*!
      * \brief This class extends the QwtPlotCurve class, providing some
      * special properties needed for Caneda.
      *
-     * \sa QwtPlotCurve
+     * The curves of a ChartScene also keep the levels of detail of their
+     * data, shared by the curves created for the views. The levels belong to
+     * the data set with setSeriesData(): they are extended when the new data
+     * holds the previous samples followed by new ones, and replaced
+     * otherwise.
+     *
+     * \sa QwtPlotCurve, ChartSeriesLevels
      */
     class ChartSeries : public QwtPlotCurve
     {
@@ -42,8 +223,16 @@ namespace Caneda
         //! \brief Sets the type of curve
         void setType(const QString& type) { m_type = type; }
 
+        void setSeriesData(QwtSeriesData<QPointF> *data, bool appended);
+        QwtSeriesData<QPointF>* createViewData();
+        void updateViewData(ChartSeriesDecimator *viewData);
+
     private:
+        QwtSeriesData<QPointF>* copySamples() const;
+
         QString m_type;  //! \brief Type of curve (voltage, current, etc)
+
+        QSharedPointer<ChartSeriesLevels> m_levels;  //! \brief Levels of detail of the data, shared with the views
     };
 
 } // namespace Caneda
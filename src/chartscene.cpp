@@ -39,4 +39,19 @@ namespace Caneda
         m_items.append(item);
     }
 
+    /*!
+     * \brief Notifies the views that items were added or their data was
+     * changed.
+     *
+     * This is used, for example, while following a simulation in progress,
+     * to display the new waveform data. Adding several items or samples and
+     * calling this method only once avoids updating the views repeatedly.
+     *
+     * \sa itemsChanged()
+     */
+    void ChartScene::updateItems()
+    {
+        emit itemsChanged();
+    }
+
 } // namespace Caneda
@@ -49,6 +49,12 @@ namespace Caneda
         QList<ChartSeries*> items() const { return m_items; }
         void addItem(ChartSeries *item);
 
+        void updateItems();
+
+    Q_SIGNALS:
+        //! \brief Emitted when items were added or their data was changed
+        void itemsChanged();
+
     private:
         QList<ChartSeries*> m_items;  //! \brief Items available in the scene (curves, markers, etc)
     };
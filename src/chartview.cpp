@@ -26,6 +26,7 @@
 
 #include <QMenu>
 #include <QMouseEvent>
+#include <QtMath>
 
 #include <qwt_legend.h>
 #include <qwt_plot_canvas.h>
@@ -114,6 +115,9 @@ namespace Caneda
         // Context menu event
         setContextMenuPolicy(Qt::CustomContextMenu);
         connect(this, SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(contextMenuEvent(const QPoint &)));
+
+        // Update the curves when the scene data changes
+        connect(m_chartScene, SIGNAL(itemsChanged()), this, SLOT(updateItems()));
     }
 
     void ChartView::zoomIn()
@@ -138,8 +142,61 @@ namespace Caneda
 
     //! \brief Adds all items available in the scene to the plot widget.
     void ChartView::populate()
+    {
+        attachItems();
+
+        enableAxis(yRight);  // Always enable the y axis
+
+        // Refresh the plot
+        replot();
+
+        // Set the zoom base to the current (autoscale) value.
+        // This value is later used to be able to return to the base zoom,
+        // displaying all waveforms contents.
+        m_zoomer->setZoomBase();
+    }
+
+    /*!
+     * \brief Updates the curves of the plot, to display new items or data
+     * added to the scene.
+     *
+     * The curves already attached are kept, and only given the new samples
+     * of their items. If the user did not zoom in, the plot is rescaled to
+     * show all the data. Otherwise, the current zoom is kept.
+     *
+     * \sa ChartScene::updateItems()
+     */
+    void ChartView::updateItems()
+    {
+        attachItems();
+
+        bool zoomed = (m_zoomer->zoomRectIndex() != 0);
+        if(!zoomed) {
+            setAxisAutoScale(xBottom);
+            setAxisAutoScale(yLeft);
+            setAxisAutoScale(yRight);
+        }
+
+        replot();
+
+        if(!zoomed) {
+            m_zoomer->setZoomBase();
+        }
+    }
+
+    /*!
+     * \brief Attaches a copy of each item available in the scene to the plot,
+     * setting the styles and axis titles.
+     *
+     * Items already attached keep their curve, which is only given the
+     * current samples of the item.
+     */
+    void ChartView::attachItems()
     {
         QList<ChartSeries*> m_items = m_chartScene->items();
+        if(m_items.isEmpty()) {
+            return;
+        }
 
         QColor color = QColor(0, 0, 0);
         int colorIndex= 0;
@@ -147,18 +204,28 @@ namespace Caneda
 
         // Attach the items to the plot
         foreach(ChartSeries *item, m_items) {
-            // Recreate the curve to be able to attach
-            // the same curve to different views
-            ChartSeries *newCurve = new ChartSeries();
-            newCurve->setData(item->data());
-            newCurve->setTitle(item->title());
-            newCurve->attach(this);
-
-            // Set the correct axis depending on the curve magnitude
-            if(item->type() == "current" || item->type() == "phase") {
-                newCurve->setYAxis(yRight);
+            ChartSeries *newCurve = m_curves.value(item);
+            if(newCurve) {
+                // Already attached, display the current samples
+                item->updateViewData(static_cast<ChartSeriesDecimator*>(newCurve->data()));
+            }
+            else {
+                // Recreate the curve to be able to attach
+                // the same curve to different views
+                newCurve = new ChartSeries();
+                newCurve->setData(item->createViewData());
+                newCurve->attach(this);
+                m_curves.insert(item, newCurve);
+
+                // Set the correct axis depending on the curve magnitude
+                if(item->type() == "current" || item->type() == "phase") {
+                    newCurve->setYAxis(yRight);
+                }
             }
 
+            // The title changes once the file has several plots
+            newCurve->setTitle(item->title());
+
             // Select the style and color of the new curve
             newCurve->setRenderHint(ChartSeries::RenderAntialiased);
             color.setHsv(colorIndex , 200, valueIndex);
@@ -205,16 +272,6 @@ namespace Caneda
             setAxisTitle(yRight, QwtText(tr("Phase [º]")));
             setLogAxis(QwtPlot::xBottom, true);
         }
-
-        enableAxis(yRight);  // Always enable the y axis
-
-        // Refresh the plot
-        replot();
-
-        // Set the zoom base to the current (autoscale) value.
-        // This value is later used to be able to return to the base zoom,
-        // displaying all waveforms contents.
-        m_zoomer->setZoomBase();
     }
 
     /*!
@@ -268,6 +325,32 @@ namespace Caneda
         }
     }
 
+    /*!
+     * \brief Draws the items of the plot.
+     *
+     * Before drawing, the visible range and width of the canvas are passed
+     * to the data of each curve, to select the level of detail used. In this
+     * way, the cost of drawing depends on the width of the plot instead of
+     * on the number of samples of the waveforms.
+     *
+     * \sa ChartSeriesDecimator
+     */
+    void ChartView::drawItems(QPainter *painter, const QRectF &canvasRect,
+            const QwtScaleMap maps[axisCnt]) const
+    {
+        const QwtPlotItemList curves = itemList(QwtPlotItem::Rtti_PlotCurve);
+        foreach(QwtPlotItem *item, curves) {
+            QwtPlotCurve *curve = static_cast<QwtPlotCurve*>(item);
+            ChartSeriesDecimator *data = dynamic_cast<ChartSeriesDecimator*>(curve->data());
+            if(data) {
+                const QwtScaleMap &map = maps[curve->xAxis()];
+                data->setView(qMin(map.s1(), map.s2()), qMax(map.s1(), map.s2()), qCeil(canvasRect.width()));
+            }
+        }
+
+        QwtPlot::drawItems(painter, canvasRect, maps);
+    }
+
     //! \brief Loads the saved user settings, updating the values on the canvas.
     void ChartView::loadUserSettings()
     {
@@ -20,6 +20,7 @@
 #ifndef CHART_VIEW_H
 #define CHART_VIEW_H
 
+#include <QHash>
 #include <QtPrintSupport/QPrinter>
 
 #include <qwt_plot.h>
@@ -35,6 +36,7 @@ namespace Caneda
 {
     // Forward declations
     class ChartScene;
+    class ChartSeries;
 
     /*!
      * \brief Reimplementation of the QwtPlotMagnifier class to allow for the
@@ -95,6 +97,7 @@ namespace Caneda
         void exportImage(QPaintDevice &device);
 
     public Q_SLOTS:
+        void updateItems();
         void launchPropertiesDialog();
         void contextMenuEvent(const QPoint &pos);
 
@@ -102,11 +105,18 @@ namespace Caneda
         void cursorPositionChanged(const QString& newPos);
 
     protected:
+        virtual void drawItems(QPainter *painter, const QRectF &canvasRect,
+                const QwtScaleMap maps[axisCnt]) const;
+
         void mouseMoveEvent(QMouseEvent *event);
         void mouseDoubleClickEvent(QMouseEvent * event);
 
     private:
+        void attachItems();
+
         ChartScene *m_chartScene;
+        //! \brief Curve attached to this view for each item of the scene
+        QHash<ChartSeries*, ChartSeries*> m_curves;
 
         QwtPlotCanvas *m_canvas;
         QwtPlotGrid *m_grid;
@@ -36,35 +36,24 @@ namespace Caneda
     //! \brief Constructs default empty ComponentData.
     ComponentData::ComponentData()
     {
-        properties = new PropertyGroup();
     }
 
     /*!
-     * \brief Copy ComponentData from a ComponentDataPtr.
+     * \brief Compiles all models of the component into model templates.
      *
-     * Copies data from a ComponentData pointed by a ComponentDataPtr. Special
-     * care is taken to avoid copying the properties pointer, and copying
-     * properties content (PropertyMap) instead. Otherwise, one would be
-     * copying the reference to the PropertyGroup (properties) and all
-     * components would share only one reference, modifying only one set
-     * of properties data.
+     * This is done once, when the component is added to its library, to
+     * avoid parsing the models every time a component instance is exported.
+     *
+     * \sa ModelTemplate, Component::modelTemplate()
      */
-    void ComponentData::setData(const QSharedDataPointer<ComponentData> &other)
+    void ComponentData::compileModels()
     {
-        // Copy all data from given ComponentDataPtr
-        name = other->name;
-        filename = other->filename;
-        displayText = other->displayText;
-        labelPrefix = other->labelPrefix;
-        description = other->description;
-        library = other->library;
-        ports = other->ports;
-
-        // Recreate PropertyGroup (properties) as it is a pointer
-        // and only internal data must be copied.
-        properties->setPropertyMap(other->properties->propertyMap());
-
-        models = other->models;
+        modelTemplates.clear();
+
+        QMap<QString, QString>::const_iterator it;
+        for(it = models.constBegin(); it != models.constEnd(); ++it) {
+            modelTemplates.insert(it.key(), ModelTemplate(it.value()));
+        }
     }
 
     /*!
@@ -79,8 +68,11 @@ namespace Caneda
         setFlag(ItemSendsGeometryChanges, true);
         setFlag(ItemSendsScenePositionChanges, true);
 
-        // Create component shared data
-        d = new ComponentData();
+        // Share an empty component data until the actual one is set
+        static const ComponentDataPtr emptyData(new ComponentData());
+        d = emptyData;
+
+        m_properties = new PropertyGroup(this);
         updateSharedData();
     }
 
@@ -100,12 +92,15 @@ namespace Caneda
      */
     void Component::updateSharedData()
     {
-        // Add component label
+        // Share the default properties, only storing the component label
+        const ComponentData *data = d.constData();
+        m_properties->setDefaultPropertyMap(data->properties);
+
         Property _label("label", labelPrefix().append('1'), QObject::tr("Label"), true);
-        d->properties->addProperty("label", _label);
+        m_properties->addProperty("label", _label);
 
         // Add component ports
-        const QList<PortData*> portDatas = d.constData()->ports;
+        const QList<PortData*> portDatas = data->ports;
         foreach(const PortData *data, portDatas) {
             Port *port = new Port(this);
             port->setName(data->name);
@@ -117,9 +112,8 @@ namespace Caneda
         updateBoundingRect();
 
         // Update properties text position
-        d->properties->setParentItem(this);
-        d->properties->setTransform(transform().inverted());
-        d->properties->setPos(boundingRect().bottomLeft());
+        m_properties->setTransform(transform().inverted());
+        m_properties->setPos(boundingRect().bottomLeft());
     }
 
     //! \brief Returns the label's suffix part.
@@ -145,21 +139,21 @@ namespace Caneda
             return false;
         }
 
-        d->properties->setPropertyValue("label", newLabel);
+        m_properties->setPropertyValue("label", newLabel);
         return true;
     }
 
     /*!
      * \brief Sets the data of the component.
      *
-     * This method also handles updating internal data, component label,
-     * component ports, etc.
+     * The data is shared with \a other, not copied. This method also handles
+     * updating internal data, component label, component ports, etc.
      *
      * \param other Component data to set into this component.
      */
     void Component::setComponentData(const ComponentDataPtr &other)
     {
-        d->setData(other);
+        d = other;
         updateSharedData();
     }
 
@@ -187,6 +181,25 @@ namespace Caneda
         return d->models[type];
     }
 
+    /*!
+     * \brief Returns the specified model of a component, compiled into a
+     * model template.
+     *
+     * The template compiled when the component was added to its library is
+     * returned if available. Otherwise, the model is compiled on the fly.
+     *
+     * \sa model(), ComponentData::compileModels()
+     */
+    ModelTemplate Component::modelTemplate(const QString &type) const
+    {
+        QMap<QString, ModelTemplate>::const_iterator it = d->modelTemplates.constFind(type);
+        if(it != d->modelTemplates.constEnd()) {
+            return it.value();
+        }
+
+        return ModelTemplate(model(type));
+    }
+
     /*!
      * \brief Paints a previously registered component.
      *
@@ -201,7 +214,7 @@ namespace Caneda
             QWidget *)
     {
         // Paint the component symbol
-        Settings *settings = Settings::instance();
+        const RenderSettings &settings = Settings::instance()->renderSettings();
         LibraryManager *libraryManager = LibraryManager::instance();
         QPainterPath symbol = libraryManager->symbolCache(name(), library());
 
@@ -210,15 +223,16 @@ namespace Caneda
 
         if(option->state & QStyle::State_Selected) {
             // If selected, the paint is performed without the pixmap cache
-            painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(settings.selectionPen);
 
             painter->drawPath(symbol);  // Draw symbol
         }
-        else if(painter->worldTransform().isScaling()) {
-            // If zooming, the paint is performed without the pixmap cache
-            painter->setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+        else if(painter->worldTransform().isScaling() ||
+                painter->device()->devType() == QInternal::Picture) {
+            // If zooming or recording a picture (which may be played back
+            // outside the gui thread, where pixmaps can't be used), the paint
+            // is performed without the pixmap cache
+            painter->setPen(settings.linePen);
 
             painter->drawPath(symbol);  // Draw symbol
         }
@@ -232,6 +246,8 @@ namespace Caneda
 
         // Restore pen
         painter->setPen(savedPen);
+
+        paintPorts(painter);
     }
 
     //! \copydoc GraphicsItem::copy()
@@ -240,6 +256,11 @@ namespace Caneda
         Component *component = new Component(parentItem());
         component->setComponentData(d);
 
+        // Copy the property values, except for the label
+        QString label = component->label();
+        component->m_properties->setPropertyMap(m_properties->propertyMap());
+        component->setLabel(label);
+
         GraphicsItem::copyDataTo(component);
         return component;
     }
@@ -261,7 +282,7 @@ namespace Caneda
         writer->writePointAttribute(pos(), "pos");
         writer->writeTransformAttribute(sceneTransform());
 
-        d->properties->writeProperties(writer);
+        m_properties->writeProperties(writer);
 
         writer->writeEndElement();  //</component>
     }
@@ -309,7 +330,7 @@ namespace Caneda
 
             if(reader->isStartElement()) {
                 if(reader->name() == "properties") {
-                    d->properties->readProperties(reader);
+                    m_properties->readProperties(reader);
                 }
                 else {
                     qWarning() << "Warning: Found unknown element" << reader->name().toString();
@@ -322,7 +343,7 @@ namespace Caneda
     //! \copydoc GraphicsItem::launchPropertiesDialog()
     void Component::launchPropertiesDialog()
     {
-        d->properties->launchPropertiesDialog();
+        m_properties->launchPropertiesDialog();
     }
 
     //! \brief Returns the rect adjusted to accomodate ports too.
@@ -22,6 +22,7 @@
 #define QCOMPONENT_H
 
 #include "graphicsitem.h"
+#include "modeltemplate.h"
 #include "property.h"
 
 namespace Caneda
@@ -29,12 +30,21 @@ namespace Caneda
     // Forward declarations
     class PortData;
 
-    //! \brief Shareable component's data.
+    /*!
+     * \brief Shareable component's data.
+     *
+     * The data of each library component is loaded once, and shared by all
+     * the instances of the component. Instances never modify it, their
+     * particular data (such as the label and other property values) being
+     * kept in the instance's own PropertyGroup.
+     *
+     * \sa Component
+     */
     struct ComponentData : public QSharedData
     {
         explicit ComponentData();
 
-        void setData(const QSharedDataPointer<ComponentData>& other);
+        void compileModels();
 
         //! Static properties.
         QString name;
@@ -45,17 +55,39 @@ namespace Caneda
         QString library;
 
         /*!
-         * Dynamic properties modifiable by the user (in the properties dialog).
-         * Special care must be taken to copy the contents of this PropertyGroup
-         * and not the pointer itself.
+         * Default values of the dynamic properties, modifiable by the user (in
+         * the properties dialog). Each component instance holds its own
+         * PropertyGroup, which shares this property map as its defaults.
          */
-        PropertyGroup *properties;
+        PropertyMap properties;
 
         //! List of component's ports.
         QList<PortData*> ports;
 
         //! QMap with all the models available to the component.
         QMap<QString, QString> models;
+
+        /*!
+         * Models compiled by compileModels(), indexed by model type. They are
+         * compiled once for each library component, and shared by all its
+         * instances.
+         */
+        QMap<QString, ModelTemplate> modelTemplates;
+
+        /*!
+         * Symbol drawing, as read from the symbol file. It is registered in
+         * the LibraryManager symbol cache when the component is added to a
+         * library.
+         */
+        QPainterPath symbol;
+
+        /*!
+         * Symbol section of the symbol file, kept as xml while the component
+         * is read outside the gui thread. Its paintings are graphics items,
+         * so they are only created, and turned into the symbol, from the gui
+         * thread by FormatXmlSymbol::loadComponentSymbol().
+         */
+        QString symbolXml;
     };
 
     typedef QSharedDataPointer<ComponentData> ComponentDataPtr;
@@ -69,6 +101,12 @@ namespace Caneda
      * The component can either be directly loaded from an xml file or the data
      * manually set if required.
      *
+     * Components are flyweights: all the instances of a library component
+     * reference the same ComponentData, which is only accessed through const
+     * methods to avoid detaching it. Each instance stores only its position,
+     * its ports and a PropertyGroup with the property values differing from
+     * the library defaults.
+     *
      * This class uses LibraryManager::symbolCache() and
      * LibraryManager::pixmapCache() as a cache to render the component. To be
      * able to render the symbol, the symbol itself must be previously
@@ -106,17 +144,18 @@ namespace Caneda
         QString library() const { return d->library; }
 
         //! Returns the label of the component in the form {label_prefix}{number_suffix}
-        QString label() const { return d->properties->propertyValue("label"); }
+        QString label() const { return m_properties->propertyValue("label"); }
         bool setLabel(const QString &_label);
 
         //! Returns the component data.
         ComponentDataPtr componentData() const { return d; }
         void setComponentData(const ComponentDataPtr &other);
 
-        //! Returns the property map (actually copy of property map).
-        PropertyGroup* properties() const { return d->properties; }
+        //! Returns the properties of this component instance.
+        PropertyGroup* properties() const { return m_properties; }
 
         QString model(const QString &type) const;
+        ModelTemplate modelTemplate(const QString &type) const;
 
         void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *);
 
@@ -138,6 +177,8 @@ namespace Caneda
 
         //! \brief Component shared data
         ComponentDataPtr d;
+        //! \brief Properties of this instance
+        PropertyGroup *m_properties;
     };
 
 } // namespace Caneda
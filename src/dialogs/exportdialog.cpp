@@ -21,7 +21,6 @@
 
 #include "global.h"
 #include "idocument.h"
-#include "settings.h"
 
 #include <QCompleter>
 #include <QDialogButtonBox>
@@ -91,6 +90,7 @@ namespace Caneda
         connect(ui.spinHeight, SIGNAL(valueChanged(int)), SLOT(slotCorrectWidth()));
         connect(ui.btnLock, SIGNAL(toggled(bool)), SLOT(slotLockRatioChanged()));
         connect(ui.btnReset, SIGNAL(clicked()), this, SLOT(slotResetSize()));
+        connect(ui.spinResolution, SIGNAL(valueChanged(int)), SLOT(slotResetSize()));
         connect(ui.btnPreview, SIGNAL(clicked()), SLOT(slotPreview()));
         connect(ui.comboFormat, SIGNAL(currentIndexChanged(int)), SLOT(slotChangeFilesExtension()));
 
@@ -158,16 +158,19 @@ namespace Caneda
         }
     }
 
-    //! Reset the size of a schematic
+    /*!
+     * Reset the size of a schematic to its size at the selected resolution.
+     * Scene units are taken as pixels at 96 dpi, the usual screen resolution.
+     */
     void ExportDialog::slotResetSize()
     {
-        QSizeF size = m_document->documentSize();
+        QSizeF size = m_document->documentSize() * ui.spinResolution->value() / 96.0;
 
         ui.spinWidth->blockSignals(true);
         ui.spinHeight->blockSignals(true);
 
-        ui.spinWidth->setValue(size.width());
-        ui.spinHeight->setValue(size.height());
+        ui.spinWidth->setValue(qRound(size.width()));
+        ui.spinHeight->setValue(qRound(size.height()));
 
         ui.spinWidth->blockSignals(false);
         ui.spinHeight->blockSignals(false);
@@ -249,6 +252,13 @@ namespace Caneda
         }
         else {
             QImage image = generateImage();
+            if(image.isNull()) {
+                QMessageBox::critical(this, tr("Could not export the image"),
+                                      tr("There is not enough memory for an image of %1x%2 pixels.")
+                                      .arg(ui.spinWidth->value()).arg(ui.spinHeight->value()),
+                                      QMessageBox::Ok);
+                return;
+            }
             image.save(&file, acronym.toUtf8().data());
         }
 
@@ -266,20 +276,28 @@ namespace Caneda
     /*!
      * \brief Generate an image to export
      *
-     * \return Exported image
+     * The resolution selected by the user is stored in the image, for the
+     * formats supporting it.
+     *
+     * \return Exported image, or a null image if it could not be allocated
      */
     QImage ExportDialog::generateImage()
     {
         int width = ui.spinWidth->value();
         int height = ui.spinHeight->value();
 
-        saveReloadDiagramParameters(true);
-
         QImage image(width, height, QImage::Format_RGB32);
+        if(image.isNull()) {
+            return(image);
+        }
+
         image.fill(qRgb(255, 255, 255));
-        m_document->exportImage(image);
+        m_document->exportImage(image, ui.checkDrawGrid->isChecked());
 
-        saveReloadDiagramParameters(false);
+        // Set the resolution once rendered, as it affects the size of fonts
+        int dotsPerMeter = qRound(ui.spinResolution->value() / 0.0254);
+        image.setDotsPerMeterX(dotsPerMeter);
+        image.setDotsPerMeterY(dotsPerMeter);
 
         return(image);
     }
@@ -294,36 +312,10 @@ namespace Caneda
         int width = ui.spinWidth->value();
         int height = ui.spinHeight->value();
 
-        saveReloadDiagramParameters(true);
-
         QSvgGenerator svg_engine;
         svg_engine.setOutputDevice(&file);
         svg_engine.setSize(QSize(width, height));
-        m_document->exportImage(svg_engine);
-
-        saveReloadDiagramParameters(false);
-    }
-
-    /*!
-     * \brief Saves or restores the parameters of the scene
-     *
-     * \param save True to save the settings of the scene and apply those
-     * defined by the form, false to restore the settings
-     */
-    void ExportDialog::saveReloadDiagramParameters(bool save)
-    {
-        static bool state_drawGrid;
-
-        if(save) {
-            // save the parameters
-            state_drawGrid = Settings::instance()->currentValue("gui/gridVisible").value<bool>();
-
-            Settings::instance()->setCurrentValue("gui/gridVisible", ui.checkDrawGrid->isChecked());
-        }
-        else {
-            // restore the parameters
-            Settings::instance()->setCurrentValue("gui/gridVisible", state_drawGrid);
-        }
+        m_document->exportImage(svg_engine, ui.checkDrawGrid->isChecked());
     }
 
 } // namespace Caneda
@@ -57,7 +57,6 @@ namespace Caneda
 
         QImage generateImage();
         void generateSvg(QFile &);
-        void saveReloadDiagramParameters(bool = true);
 
         IDocument *m_document;
 
@@ -56,6 +56,8 @@ namespace Caneda
         map["gui/lineColor"] = settings->currentValue("gui/lineColor");
         map["gui/selectionColor"] = settings->currentValue("gui/selectionColor");
         map["gui/lineWidth"] = settings->currentValue("gui/lineWidth");
+        map["gui/undoLimit"] = settings->currentValue("gui/undoLimit");
+        map["gui/undoMemory"] = settings->currentValue("gui/undoMemory");
 
         // Libraries group of settings
         map["libraries/schematic"] = settings->currentValue("libraries/schematic");
@@ -65,6 +67,8 @@ namespace Caneda
         map["sim/simulationCommand"] = settings->currentValue("sim/simulationCommand");
         map["sim/simulationEngine"] = settings->currentValue("sim/simulationEngine");
         map["sim/outputFormat"] = settings->currentValue("sim/outputFormat");
+        map["sim/followSimulation"] = settings->currentValue("sim/followSimulation");
+        map["sim/maximumJobs"] = settings->currentValue("sim/maximumJobs");
 
         // Layout group of settings
         map["gui/layout/metal1"] = settings->currentValue("gui/layout/metal1");
@@ -248,6 +252,8 @@ namespace Caneda
         map["gui/lineColor"] = settings->defaultValue("gui/lineColor");
         map["gui/selectionColor"] = settings->defaultValue("gui/selectionColor");
         map["gui/lineWidth"] = settings->defaultValue("gui/lineWidth");
+        map["gui/undoLimit"] = settings->defaultValue("gui/undoLimit");
+        map["gui/undoMemory"] = settings->defaultValue("gui/undoMemory");
 
         // Libraries group of settings
         map["libraries/schematic"] = settings->defaultValue("libraries/schematic");
@@ -257,6 +263,8 @@ namespace Caneda
         map["sim/simulationCommand"] = settings->defaultValue("sim/simulationCommand");
         map["sim/simulationEngine"] = settings->defaultValue("sim/simulationEngine");
         map["sim/outputFormat"] = settings->defaultValue("sim/outputFormat");
+        map["sim/followSimulation"] = settings->defaultValue("sim/followSimulation");
+        map["sim/maximumJobs"] = settings->defaultValue("sim/maximumJobs");
 
         // Layout group of settings
         map["gui/layout/metal1"] = settings->defaultValue("gui/layout/metal1");
@@ -296,6 +304,8 @@ namespace Caneda
         settings->setCurrentValue("gui/selectionColor", getButtonColor(ui.buttonSelection));
 
         settings->setCurrentValue("gui/lineWidth", ui.spinWidth->value());
+        settings->setCurrentValue("gui/undoLimit", ui.spinUndoLimit->value());
+        settings->setCurrentValue("gui/undoMemory", ui.spinUndoMemory->value());
 
         // Libraries group of settings
         QStringList newLibraries;
@@ -330,6 +340,9 @@ namespace Caneda
             settings->setCurrentValue("sim/outputFormat", QString("ascii"));
         }
 
+        settings->setCurrentValue("sim/followSimulation", ui.checkFollowSimulation->isChecked());
+        settings->setCurrentValue("sim/maximumJobs", ui.spinMaximumJobs->value());
+
         // Layout group of settings
         settings->setCurrentValue("gui/layout/metal1", getButtonColor(ui.buttonMetal1));
         settings->setCurrentValue("gui/layout/metal2", getButtonColor(ui.buttonMetal2));
@@ -367,6 +380,8 @@ namespace Caneda
         setButtonColor(ui.buttonLine, map["gui/lineColor"].value<QColor>());
         setButtonColor(ui.buttonSelection, map["gui/selectionColor"].value<QColor>());
         ui.spinWidth->setValue(map["gui/lineWidth"].toInt());
+        ui.spinUndoLimit->setValue(map["gui/undoLimit"].toInt());
+        ui.spinUndoMemory->setValue(map["gui/undoMemory"].toInt());
 
         // Libraries group of settings
         ui.listLibraries->clear();
@@ -403,6 +418,9 @@ namespace Caneda
             ui.radioAsciiMode->setChecked(true);
         }
 
+        ui.checkFollowSimulation->setChecked(map["sim/followSimulation"].value<bool>());
+        ui.spinMaximumJobs->setValue(map["sim/maximumJobs"].toInt());
+
         // Layout group of settings
         setButtonColor(ui.buttonMetal1, map["gui/layout/metal1"].value<QColor>());
         setButtonColor(ui.buttonMetal2, map["gui/layout/metal2"].value<QColor>());
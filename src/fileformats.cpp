@@ -33,12 +33,19 @@
 #include "wire.h"
 #include "xmlutilities.h"
 
+#include <QBuffer>
+#include <QDataStream>
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QString>
+#include <QTimer>
+
+#include <climits>
+#include <cstring>
 
 namespace Caneda
 {
@@ -57,9 +64,9 @@ namespace Caneda
      *
      * This method checks the file to be written is accessible and that the
      * user has the correct permissions to write it, and then calls the
-     * saveText() method to generate the xml data to save.
+     * saveToDevice() method to write the xml data directly to the file.
      *
-     * \sa saveText(), load()
+     * \sa saveToDevice(), load()
      */
     bool FormatXmlSchematic::save() const
     {
@@ -67,22 +74,20 @@ namespace Caneda
             return false;
         }
 
-        QString text = saveText();
-
-        if(text.isEmpty()) {
-            qDebug() << "Looks buggy! Null data to save! Was this expected?";
-        }
-
-        QFile file(fileName());
+        // The data is written to a temporary file, which only replaces
+        // the document once it is completely written.
+        QSaveFile file(fileName());
         if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
             QMessageBox::critical(0, QObject::tr("Error"),
                     QObject::tr("Cannot save document!"));
             return false;
         }
 
-        QTextStream stream(&file);
-        stream << text;
-        file.close();
+        if(!saveToDevice(&file) || !file.commit()) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
+        }
 
         return true;
     }
@@ -92,9 +97,10 @@ namespace Caneda
      *
      * This method checks the file to be read is accessible and that the
      * user has the correct permissions to read it, and then calls the
-     * loadFromText() method to read the xml data into the scene.
+     * loadFromDevice() method to read the xml data into the scene, directly
+     * from the file.
      *
-     * \sa loadFromText(), save()
+     * \sa loadFromDevice(), save()
      */
     bool FormatXmlSchematic::load() const
     {
@@ -110,32 +116,27 @@ namespace Caneda
             return false;
         }
 
-        QTextStream stream(&file);
-        bool result = loadFromText(stream.readAll());
-        file.close();
-
-        return result;
+        return loadFromDevice(&file);
     }
 
     /*!
-     * \brief Saves an xml file description into a QString, obtaining the data
+     * \brief Writes an xml file description into a device, obtaining the data
      * from a scene and associated objects (componts, paintings, etc).
      *
-     * This method is used to generate an xml file into a QString to be saved
-     * by the save() method. Not only scene sections are created (components,
+     * This method is used to stream an xml file into the file opened by the
+     * save() method. Not only scene sections are created (components,
      * paintings, etc) but also file header information, for example document
      * version and name. Each section is created, in its turn, by calling an
      * appropiated method an thus improving source code readability by
      * splitting the different actions.
      *
-     * \return QString containing xml data to be saved.
+     * \return True if all the xml data was written to \a device.
      *
      * \sa save()
      */
-    QString FormatXmlSchematic::saveText() const
+    bool FormatXmlSchematic::saveToDevice(QIODevice *device) const
     {
-        QString retVal;
-        Caneda::XmlWriter *writer = new Caneda::XmlWriter(&retVal);
+        Caneda::XmlWriter *writer = new Caneda::XmlWriter(device);
         writer->setAutoFormatting(true);
 
         // Fist we start the document and write current version
@@ -153,8 +154,9 @@ namespace Caneda
         // Finally we finish the document
         writer->writeEndDocument(); //</caneda>
 
+        bool result = !writer->hasError();
         delete writer;
-        return retVal;
+        return result;
     }
 
     /*!
@@ -261,11 +263,11 @@ namespace Caneda
      * \brief Reads an xml file and constructs a scene and associated
      * objects (componts, paintings, etc) from the data read.
      *
-     * \param text String containing xml data to be read.
+     * \param device Device, usually a file, containing xml data to be read.
      */
-    bool FormatXmlSchematic::loadFromText(const QString& text) const
+    bool FormatXmlSchematic::loadFromDevice(QIODevice *device) const
     {
-        Caneda::XmlReader *reader = new Caneda::XmlReader(text.toUtf8());
+        Caneda::XmlReader *reader = new Caneda::XmlReader(device);
 
         while(!reader->atEnd()) {
             reader->readNext();
@@ -324,6 +326,8 @@ namespace Caneda
     void FormatXmlSchematic::loadComponents(Caneda::XmlReader *reader) const
     {
         GraphicsScene *scene = graphicsScene();
+        QList<GraphicsItem*> items;
+
         if(!reader->isStartElement() || reader->name() != "components") {
             reader->raiseError(QObject::tr("Malformatted file"));
         }
@@ -340,8 +344,7 @@ namespace Caneda
                 if(reader->name() == "component") {
                     Component *component = new Component();
                     component->loadData(reader);
-                    scene->addItem(component);
-                    scene->connectItems(component);
+                    items << component;
                 }
                 else {
                     qWarning() << "Error: Found unknown component type" << reader->name().toString();
@@ -350,6 +353,8 @@ namespace Caneda
                 }
             }
         }
+
+        scene->addItems(items);
     }
 
     /*!
@@ -360,6 +365,8 @@ namespace Caneda
     void FormatXmlSchematic::loadPorts(Caneda::XmlReader *reader) const
     {
         GraphicsScene *scene = graphicsScene();
+        QList<GraphicsItem*> items;
+
         if(!reader->isStartElement() || reader->name() != "ports") {
             reader->raiseError(QObject::tr("Malformatted file"));
         }
@@ -376,8 +383,7 @@ namespace Caneda
                 if(reader->name() == "port") {
                     PortSymbol *portSymbol = new PortSymbol();
                     portSymbol->loadData(reader);
-                    scene->addItem(portSymbol);
-                    scene->connectItems(portSymbol);
+                    items << portSymbol;
                 }
                 else {
                     qWarning() << "Error: Found unknown port type" << reader->name().toString();
@@ -386,6 +392,8 @@ namespace Caneda
                 }
             }
         }
+
+        scene->addItems(items);
     }
 
     /*!
@@ -396,6 +404,8 @@ namespace Caneda
     void FormatXmlSchematic::loadWires(Caneda::XmlReader* reader) const
     {
         GraphicsScene *scene = graphicsScene();
+        QList<GraphicsItem*> items;
+
         if(!reader->isStartElement() || reader->name() != "wires") {
             reader->raiseError(QObject::tr("Malformatted file"));
         }
@@ -412,8 +422,7 @@ namespace Caneda
                 if(reader->name() == "wire") {
                     Wire *wire = new Wire(QPointF(10,10), QPointF(50,50));
                     wire->loadData(reader);
-                    scene->addItem(wire);
-                    scene->connectItems(wire);
+                    items << wire;
                 }
                 else {
                     qWarning() << "Error: Found unknown wire type" << reader->name().toString();
@@ -422,6 +431,8 @@ namespace Caneda
                 }
             }
         }
+
+        scene->addItems(items);
     }
 
     /*!
@@ -509,9 +520,9 @@ namespace Caneda
      *
      * This method checks the file to be written is accessible and that the
      * user has the correct permissions to write it, and then calls the
-     * saveText() method to generate the xml data to save.
+     * saveToDevice() method to write the xml data directly to the file.
      *
-     * \sa saveText(), load()
+     * \sa saveToDevice(), load()
      */
     bool FormatXmlSymbol::save() const
     {
@@ -519,22 +530,20 @@ namespace Caneda
             return false;
         }
 
-        QString text = saveText();
-
-        if(text.isEmpty()) {
-            qDebug() << "Looks buggy! Null data to save! Was this expected?";
-        }
-
-        QFile file(fileName());
+        // The data is written to a temporary file, which only replaces
+        // the document once it is completely written.
+        QSaveFile file(fileName());
         if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
             QMessageBox::critical(0, QObject::tr("Error"),
                     QObject::tr("Cannot save document!"));
             return false;
         }
 
-        QTextStream stream(&file);
-        stream << text;
-        file.close();
+        if(!saveToDevice(&file) || !file.commit()) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
+        }
 
         return true;
     }
@@ -544,24 +553,28 @@ namespace Caneda
      *
      * This method checks the file to be read is accessible and that the
      * user has the correct permissions to read it, and then calls the
-     * loadFromText() method to read the xml data into the scene.
+     * loadFromDevice() method to read the xml data into the scene, directly
+     * from the file.
      *
-     * \sa loadFromText(), save()
+     * \sa loadFromDevice(), save()
      */
     bool FormatXmlSymbol::load() const
     {
         QFile file(fileName());
         if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QMessageBox::critical(0, QObject::tr("Error"),
-                    QObject::tr("Cannot open file %1").arg(fileName()));
+            // Components may be loaded outside the gui thread, and their
+            // errors are reported afterwards by the Library.
+            if(component()) {
+                qWarning() << "\nWarning: Cannot open file" << fileName();
+            }
+            else {
+                QMessageBox::critical(0, QObject::tr("Error"),
+                        QObject::tr("Cannot open file %1").arg(fileName()));
+            }
             return false;
         }
 
-        QTextStream stream(&file);
-        bool result = loadFromText(stream.readAll());
-        file.close();
-
-        return result;
+        return loadFromDevice(&file);
     }
 
     GraphicsScene* FormatXmlSymbol::graphicsScene() const
@@ -580,24 +593,23 @@ namespace Caneda
     }
 
     /*!
-     * \brief Saves an xml file description into a QString, obtaining the data
+     * \brief Writes an xml file description into a device, obtaining the data
      * from a scene and associated objects (componts, paintings, etc).
      *
-     * This method is used to generate an xml file into a QString to be saved
-     * by the save() method. Not only scene sections are created (components,
+     * This method is used to stream an xml file into the file opened by the
+     * save() method. Not only scene sections are created (components,
      * paintings, etc) but also file header information, for example document
      * version and name. Each section is created, in its turn, by calling an
      * appropiated method an thus improving source code readability by
      * splitting the different actions.
      *
-     * \return QString containing xml data to be saved.
+     * \return True if all the xml data was written to \a device.
      *
      * \sa save()
      */
-    QString FormatXmlSymbol::saveText() const
+    bool FormatXmlSymbol::saveToDevice(QIODevice *device) const
     {
-        QString retVal;
-        Caneda::XmlWriter *writer = new Caneda::XmlWriter(&retVal);
+        Caneda::XmlWriter *writer = new Caneda::XmlWriter(device);
         writer->setAutoFormatting(true);
 
         // Fist we start the document
@@ -636,8 +648,9 @@ namespace Caneda
         // Finally we finish the document
         writer->writeEndDocument(); //</component>
 
+        bool result = !writer->hasError();
         delete writer;
-        return retVal;
+        return result;
     }
 
     /*!
@@ -786,11 +799,11 @@ namespace Caneda
      * \brief Reads an xml file and constructs a scene and associated
      * objects (componts, paintings, etc) from the data read.
      *
-     * \param text String containing xml data to be read.
+     * \param device Device, usually a file, containing xml data to be read.
      */
-    bool FormatXmlSymbol::loadFromText(const QString &text) const
+    bool FormatXmlSymbol::loadFromDevice(QIODevice *device) const
     {
-        Caneda::XmlReader *reader = new Caneda::XmlReader(text.toUtf8());
+        Caneda::XmlReader *reader = new Caneda::XmlReader(device);
 
         while(!reader->atEnd()) {
             reader->readNext();
@@ -858,7 +871,16 @@ namespace Caneda
 
                     // Read symbol
                     else if(reader->name() == "symbol") {
-                        loadSymbol(reader);
+                        // Check if we are opening the file for edition or to include it in a library
+                        if(graphicsScene()) {
+                            // We are opening the file for symbol edition
+                            loadSymbol(reader);
+                        }
+                        else if(component()) {
+                            // We are opening the file as a component to include it in a library,
+                            // maybe outside the gui thread. Keep the symbol for loadComponentSymbol().
+                            component()->symbolXml = readElementXml(reader);
+                        }
                     }
 
                     // Read ports
@@ -882,7 +904,12 @@ namespace Caneda
 
         if(reader->hasError()) {
             qWarning() << "\nWarning: Failed to read data from\n" << fileName();
-            QMessageBox::critical(0, QObject::tr("Xml parse error"), reader->errorString());
+            if(component()) {
+                qWarning() << reader->errorString();
+            }
+            else {
+                QMessageBox::critical(0, QObject::tr("Xml parse error"), reader->errorString());
+            }
             delete reader;
             return false;
         }
@@ -933,11 +960,72 @@ namespace Caneda
             }
         }
 
-        // If we are opening the file as a component, register the recreated QPainterPath
+        // If we are opening the file as a component, keep the recreated
+        // QPainterPath. The library registers it once the component is added.
         if(component()) {
-            LibraryManager *libraryManager = LibraryManager::instance();
-            libraryManager->registerComponent(component()->name, component()->library, data);
+            component()->symbol = data;
+        }
+    }
+
+    /*!
+     * \brief Recreates the symbol of the component from the symbol section
+     * kept by load().
+     *
+     * Components are read by load() outside the gui thread, but the symbol
+     * paintings are graphics items. Their creation is therefore deferred to
+     * this method, which must be called from the gui thread.
+     *
+     * \sa ComponentData::symbolXml, Library::loadComponent()
+     */
+    void FormatXmlSymbol::loadComponentSymbol() const
+    {
+        if(!component() || component()->symbolXml.isEmpty()) {
+            return;
+        }
+
+        Caneda::XmlReader *reader = new Caneda::XmlReader(component()->symbolXml.toUtf8());
+
+        while(!reader->atEnd()) {
+            reader->readNext();
+            if(reader->isStartElement() && reader->name() == "symbol") {
+                loadSymbol(reader);
+                break;
+            }
+        }
+
+        component()->symbolXml.clear();
+        delete reader;
+    }
+
+    /*!
+     * \brief Returns the current element of \a reader as xml text, reading
+     * until its end.
+     *
+     * \param reader XmlReader positioned at the start of an element.
+     */
+    QString FormatXmlSymbol::readElementXml(Caneda::XmlReader *reader)
+    {
+        Q_ASSERT(reader->isStartElement());
+
+        QString xml;
+        QXmlStreamWriter writer(&xml);
+        writer.writeCurrentToken(*reader);
+
+        int depth = 1;
+        while(!reader->atEnd() && depth > 0) {
+            reader->readNext();
+
+            if(reader->isStartElement()) {
+                ++depth;
+            }
+            else if(reader->isEndElement()) {
+                --depth;
+            }
+
+            writer.writeCurrentToken(*reader);
         }
+
+        return xml;
     }
 
     /*!
@@ -1013,7 +1101,7 @@ namespace Caneda
                 }
                 else if(component()) {
                     // We are opening the file as a component to include it in a library
-                    component()->properties->addProperty(prop.name(), prop);
+                    component()->properties.insert(prop.name(), prop);
                 }
 
             }
@@ -1077,9 +1165,9 @@ namespace Caneda
      *
      * This method checks the file to be written is accessible and that the
      * user has the correct permissions to write it, and then calls the
-     * saveText() method to generate the xml data to save.
+     * saveToDevice() method to write the xml data directly to the file.
      *
-     * \sa saveText(), load()
+     * \sa saveToDevice(), load()
      */
     bool FormatXmlLayout::save() const
     {
@@ -1087,22 +1175,20 @@ namespace Caneda
             return false;
         }
 
-        QString text = saveText();
-
-        if(text.isEmpty()) {
-            qDebug() << "Looks buggy! Null data to save! Was this expected?";
-        }
-
-        QFile file(fileName());
+        // The data is written to a temporary file, which only replaces
+        // the document once it is completely written.
+        QSaveFile file(fileName());
         if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
             QMessageBox::critical(0, QObject::tr("Error"),
                     QObject::tr("Cannot save document!"));
             return false;
         }
 
-        QTextStream stream(&file);
-        stream << text;
-        file.close();
+        if(!saveToDevice(&file) || !file.commit()) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
+        }
 
         return true;
     }
@@ -1112,9 +1198,10 @@ namespace Caneda
      *
      * This method checks the file to be read is accessible and that the
      * user has the correct permissions to read it, and then calls the
-     * loadFromText() method to read the xml data into the scene.
+     * loadFromDevice() method to read the xml data into the scene, directly
+     * from the file.
      *
-     * \sa loadFromText(), save()
+     * \sa loadFromDevice(), save()
      */
     bool FormatXmlLayout::load() const
     {
@@ -1130,32 +1217,27 @@ namespace Caneda
             return false;
         }
 
-        QTextStream stream(&file);
-        bool result = loadFromText(stream.readAll());
-        file.close();
-
-        return result;
+        return loadFromDevice(&file);
     }
 
     /*!
-     * \brief Saves an xml file description into a QString, obtaining the data
+     * \brief Writes an xml file description into a device, obtaining the data
      * from a scene and associated objects (componts, paintings, etc).
      *
-     * This method is used to generate an xml file into a QString to be saved
-     * by the save() method. Not only scene sections are created (components,
+     * This method is used to stream an xml file into the file opened by the
+     * save() method. Not only scene sections are created (components,
      * paintings, etc) but also file header information, for example document
      * version and name. Each section is created, in its turn, by calling an
      * appropiated method an thus improving source code readability by
      * splitting the different actions.
      *
-     * \return QString containing xml data to be saved.
+     * \return True if all the xml data was written to \a device.
      *
      * \sa save()
      */
-    QString FormatXmlLayout::saveText() const
+    bool FormatXmlLayout::saveToDevice(QIODevice *device) const
     {
-        QString retVal;
-        Caneda::XmlWriter *writer = new Caneda::XmlWriter(&retVal);
+        Caneda::XmlWriter *writer = new Caneda::XmlWriter(device);
         writer->setAutoFormatting(true);
 
         // Fist we start the document and write current version
@@ -1170,8 +1252,9 @@ namespace Caneda
         // Finally we finish the document
         writer->writeEndDocument(); //</caneda>
 
+        bool result = !writer->hasError();
         delete writer;
-        return retVal;
+        return result;
     }
 
     /*!
@@ -1203,11 +1286,11 @@ namespace Caneda
      * \brief Reads an xml file and constructs a scene and associated
      * objects (componts, paintings, etc) from the data read.
      *
-     * \param text String containing xml data to be read.
+     * \param device Device, usually a file, containing xml data to be read.
      */
-    bool FormatXmlLayout::loadFromText(const QString& text) const
+    bool FormatXmlLayout::loadFromDevice(QIODevice *device) const
     {
-        Caneda::XmlReader *reader = new Caneda::XmlReader(text.toUtf8());
+        Caneda::XmlReader *reader = new Caneda::XmlReader(device);
 
         while(!reader->atEnd()) {
             reader->readNext();
@@ -1298,409 +1381,1368 @@ namespace Caneda
 
 
     /*************************************************************************
-     *                             FormatSpice                               *
+     *                             FormatBinary                              *
      *************************************************************************/
-    //! \brief Constructor.
-    FormatSpice::FormatSpice(SchematicDocument *document) :
+    //! \brief Constructs a binary format for a schematic \a document.
+    FormatBinary::FormatBinary(SchematicDocument *document) :
         QObject(document),
-        m_schematicDocument(document)
+        m_document(document),
+        m_graphicsScene(document->graphicsScene()),
+        m_documentType(SchematicType)
     {
     }
 
-    bool FormatSpice::save()
+    //! \brief Constructs a binary format for a symbol \a document.
+    FormatBinary::FormatBinary(SymbolDocument *document) :
+        QObject(document),
+        m_document(document),
+        m_graphicsScene(document->graphicsScene()),
+        m_documentType(SymbolType)
+    {
+    }
+
+    //! \brief Constructs a binary format for a layout \a document.
+    FormatBinary::FormatBinary(LayoutDocument *document) :
+        QObject(document),
+        m_document(document),
+        m_graphicsScene(document->graphicsScene()),
+        m_documentType(LayoutType)
+    {
+    }
+
+    /*!
+     * \brief Constructs a binary format for items not belonging to any
+     * document, as used by the clipboard.
+     *
+     * \sa saveItems(), loadItems()
+     */
+    FormatBinary::FormatBinary() :
+        QObject(),
+        m_document(0),
+        m_graphicsScene(0),
+        m_documentType(ItemsType)
+    {
+    }
+
+    /*!
+     * \brief Saves current scene data to a binary file.
+     *
+     * The file is written atomically, replacing the previous document only
+     * once it is completely written.
+     *
+     * \sa load(), write()
+     */
+    bool FormatBinary::save() const
     {
         GraphicsScene *scene = graphicsScene();
         if(!scene) {
             return false;
         }
 
-        QFile file(fileName());
-        if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QSaveFile file(fileName());
+        if(!file.open(QIODevice::WriteOnly)) {
             QMessageBox::critical(0, QObject::tr("Error"),
                     QObject::tr("Cannot save document!"));
             return false;
         }
 
-        QString text = generateNetlist();
-        if(text.isEmpty()) {
-            qDebug() << "Looks buggy! Null data to save! Was this expected?";
+        QList<QGraphicsItem*> items = scene->items();
+        if(!write(&file, items) || !file.commit()) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
         }
 
-        QTextStream stream(&file);
-        stream << text;
-        file.close();
-
         return true;
     }
 
-    GraphicsScene *FormatSpice::graphicsScene() const
+    /*!
+     * \brief Loads a binary file into the current scene.
+     *
+     * Only the sections in \a sections are read, the others are skipped by
+     * seeking over them. For example, loading only the components, ports and
+     * wires sections of a schematic is enough to generate its netlist.
+     * Component properties which are not loaded keep their default values.
+     *
+     * \sa save(), read(), Section
+     */
+    bool FormatBinary::load(int sections) const
     {
-        return m_schematicDocument ? m_schematicDocument->graphicsScene() : 0;
-    }
+        GraphicsScene *scene = graphicsScene();
+        if(!scene) {
+            return false;
+        }
 
-    QString FormatSpice::fileName() const
-    {
-        if(m_schematicDocument) {
-            QFileInfo info(m_schematicDocument->fileName());
-            QString baseName = info.completeBaseName();
-            QString path = info.path();
+        QFile file(fileName());
+        if(!file.open(QIODevice::ReadOnly)) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                    QObject::tr("Cannot load document ")+fileName());
+            return false;
+        }
 
-            return path + "/" + baseName + ".net";
+        QList<GraphicsItem*> items;
+        bool result = read(&file, sections, &items);
+        scene->addItems(items);
+
+        if(!result) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                    QObject::tr("Not a caneda file or probably malformatted file"));
+            return false;
         }
 
-        return QString();
+        return true;
     }
 
     /*!
-     *  \brief Generate netlist
+     * \brief Encodes \a items in the binary format.
      *
-     *  Iterate over all components, saving to a string the schematic netlist
-     *  according to the model provided as a set of rules. In order to do so,
-     *  the netlist topology must also be created, that is the connections
-     *  between the multiple components must be determined and numbered to be
-     *  used for the spice netlist. The set of rules used for generating the
-     *  netlist from the model is specified in \ref ModelsFormat.
+     * This is used to copy items to the clipboard, in a much more compact
+     * form than the xml format.
      *
-     *  \sa generateNetlistTopology(), \ref ModelsFormat
+     * \sa loadItems()
      */
-    QString FormatSpice::generateNetlist()
+    QByteArray FormatBinary::saveItems(const QList<GraphicsItem*> &items)
     {
-        LibraryManager *libraryManager = LibraryManager::instance();
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<Component*> components = filterItems<Component>(items);
-        PortsNetlist netlist = generateNetlistTopology();
+        QList<QGraphicsItem*> graphicsItems;
+        foreach(GraphicsItem *item, items) {
+            graphicsItems << item;
+        }
 
-        QStringList modelsList;
-        QStringList subcircuitsList;
-        QStringList directivesList;
-        QStringList schematicsList;
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
 
-        // Start the document and write the header
-        QString retVal;
-        retVal.append("* Spice automatic export. Generated by Caneda.\n");
-        retVal.append("\n* Spice netlist.\n");
+        FormatBinary format;
+        format.write(&buffer, graphicsItems);
 
-        // Copy all the elements and properties in the schematic by
-        // iterating over all schematic components.
-        // *Note*: the parsing order is important to allow, for example
-        // cascadable commands and if control statements correct extraction.
-        foreach(Component *c, components) {
+        return data;
+    }
 
-            // Get the spice model (multiple models may be available)
-            QString model = c->model("spice");
-
-            // ************************************************************
-            // Parse and replace the simple commands (e.g. label)
-            // ************************************************************
-            model.replace("%label", c->label());
-            model.replace("%n", "\n");
-
-            QString path = libraryManager->library(c->library())->libraryPath();
-            model.replace("%librarypath", path);
-
-            path = QFileInfo(m_schematicDocument->fileName()).absolutePath();
-            model.replace("%filepath", path);
-
-            // ************************************************************
-            // Parse and replace the commands with parameters
-            // ************************************************************
-            QStringList commands;
-            QRegularExpression re;
-            QRegularExpressionMatchIterator it;
-
-            // ************************************************************
-            // First parse the cascadable commands (e.g. properties)
-            // ************************************************************
-            commands.clear();
-            re.setPattern("(%\\w+\{([\\w+-]+)})");
-            it = re.globalMatch(model);
-            while (it.hasNext()) {
-                QRegularExpressionMatch match = it.next();
-                commands << match.captured(0);
-            }
-
-            // For each command replace the parameter with the correct value
-            for(int i=0; i<commands.size(); i++){
-
-                // Extract the parameters, removing the comand (including the
-                // "{" and the last character "}")
-                QString parameter = commands.at(i);
-                parameter.remove(QRegularExpression("(%\\w+\{)")).chop(1);
-
-                if(commands.at(i).startsWith("%port")){
-                    foreach(Port *_port, c->ports()) {
-                        if(_port->name() == parameter) {
-                            // Found the port, now look for its netlist name
-                            for(int j = 0; j < netlist.size(); ++j) {
-                                if(netlist.at(j).first == _port) {
-                                    model.replace(commands.at(i), netlist.at(j).second);
-                                }
-                            }
-                        }
-                    }
-                }
-                else if(commands.at(i).startsWith("%property")){
-                    model.replace(commands.at(i), c->properties()->propertyValue(parameter));
-                }
-            }
+    /*!
+     * \brief Decodes the items encoded by saveItems() in \a data.
+     *
+     * The items are returned without being added to any scene. If \a data
+     * is not valid, an empty list is returned.
+     *
+     * \sa saveItems()
+     */
+    QList<GraphicsItem*> FormatBinary::loadItems(const QByteArray &data)
+    {
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
 
-            // ************************************************************
-            // Parse if control statements
-            // ************************************************************
-            commands.clear();
-            re.setPattern("(%\\w+\{([\\w =+-,]*)})");
-            it = re.globalMatch(model);
-            while (it.hasNext()) {
-                QRegularExpressionMatch match = it.next();
-                commands << match.captured(0);
-            }
+        QList<GraphicsItem*> items;
 
-            // For each command replace the parameter with the correct value
-            for(int i=0; i<commands.size(); i++){
+        FormatBinary format;
+        if(!format.read(&buffer, AllSections, &items)) {
+            qDeleteAll(items);
+            items.clear();
+        }
 
-                // Extract the parameters, removing the comand (including the
-                // "{" and the last character "}")
-                QString parameter = commands.at(i);
-                parameter.remove(QRegularExpression("(%\\w+\{)")).chop(1);
-                QStringList controlStrings = parameter.split(",");
+        return items;
+    }
 
-                if(commands.at(i).startsWith("%if")){
-                    if(!controlStrings.at(0).isEmpty() && controlStrings.size() > 1) {
-                        model.replace(commands.at(i), controlStrings.at(1));
-                    }
-                    else {
-                        model.remove(commands.at(i));
-                    }
-                }
-            }
+    /*!
+     * \brief Writes \a items to \a device.
+     *
+     * All sections are first generated in memory, to know their sizes and
+     * fill the section table.
+     */
+    bool FormatBinary::write(QIODevice *device, QList<QGraphicsItem*> &items) const
+    {
+        StringTable strings;
+        QList<SectionEntry> entries;
+        QList<QByteArray> sections;
 
-            // ************************************************************
-            // Now parse the non-cascadable commands (e.g. models), which may
-            // have a cascadable command as an argument (e.g. properties).
-            // ************************************************************
-            commands.clear();
-            re.setPattern("(%\\w+\{([\\w =+-\\\\(\\\\)\\n\\*\{}]+)})");
-            it = re.globalMatch(model);
-            while (it.hasNext()) {
-                QRegularExpressionMatch match = it.next();
-                commands << match.captured(0);
-            }
+        SectionEntry entry;
+        entry.offset = 0;
 
-            // For each command replace the parameter with the correct value
-            for(int i=0; i<commands.size(); i++){
+        QByteArray properties;
+        entry.section = ComponentsSection;
+        sections << saveComponents(items, &strings, &entry.count, &properties);
+        entries << entry;
 
-                // Extract the parameters, removing the comand (including the
-                // "{" and the last character "}")
-                QString parameter = commands.at(i);
-                parameter.remove(QRegularExpression("(%\\w+\{)")).chop(1);
+        entry.section = PropertiesSection;
+        entry.count = 0;
+        sections << properties;
+        entries << entry;
 
-                if(commands.at(i).startsWith("%model")){
+        entry.section = PortsSection;
+        sections << savePorts(items, &strings, &entry.count);
+        entries << entry;
 
-                    // Models should be added to a temporal list to be included
-                    // only once at the end of the spice file.
-                    if(!modelsList.contains(parameter)) {
-                        modelsList << parameter;
-                    }
+        entry.section = WiresSection;
+        sections << saveWires(items, &entry.count);
+        entries << entry;
 
-                    model.remove(commands.at(i));
+        entry.section = PaintingsSection;
+        sections << savePaintings(items, &entry.count);
+        entries << entry;
 
-                }
-                else if(commands.at(i).startsWith("%subcircuit")){
+        if(m_documentType == SymbolType) {
+            entry.section = SymbolSection;
+            sections << saveSymbol(&strings, &entry.count);
+            entries << entry;
+        }
 
-                    // Subcircuits should be added to a temporal list to be included
-                    // only once at the end of the spice file.
-                    if(!subcircuitsList.contains(parameter)) {
-                        subcircuitsList << parameter;
-                    }
+        // The strings section must be generated last, once all strings are
+        // interned, but it is the first one in the file.
+        QByteArray stringsData;
+        QDataStream stringsStream(&stringsData, QIODevice::WriteOnly);
+        stringsStream.setVersion(QDataStream::Qt_5_3);
+        foreach(const QString &string, strings.strings) {
+            stringsStream << string;
+        }
 
-                    model.remove(commands.at(i));
+        entry.section = StringsSection;
+        entry.count = strings.strings.size();
+        sections.prepend(stringsData);
+        entries.prepend(entry);
 
-                }
-                else if(commands.at(i).startsWith("%directive")){
+        // Compute the offsets of the sections, relative to the end of the
+        // section table.
+        qint64 offset = 0;
+        for(int i = 0; i < entries.size(); ++i) {
+            entries[i].offset = offset;
+            entries[i].size = sections.at(i).size();
+            offset += entries.at(i).size;
+        }
 
-                    // Directives should be added to a temporal list to be included
-                    // only once at the end of the spice file.
-                    if(!directivesList.contains(parameter)) {
-                        directivesList << parameter;
-                    }
+        QDataStream stream(device);
+        stream.setVersion(QDataStream::Qt_5_3);
 
-                    model.remove(commands.at(i));
+        stream << quint32(Magic) << quint32(Version) << quint32(m_documentType);
+        stream << Caneda::version();
 
-                }
-            }
+        stream << quint32(entries.size());
+        foreach(const SectionEntry &e, entries) {
+            stream << e.section << e.offset << e.size << e.count;
+        }
 
-            // ************************************************************
-            // Now parse the generateNetlist command, which creates a
-            // temporal list of schematics needed for recursive netlists
-            // generation (for recursive simulations).
-            // ************************************************************
-            if(model.contains("%generateNetlist")){
+        foreach(const QByteArray &data, sections) {
+            stream.writeRawData(data.constData(), data.size());
+        }
 
-                QFileInfo info(c->filename());
-                QString baseName = info.completeBaseName();
-                QString path = libraryManager->library(c->library())->libraryPath();
-                QString schematic = path + "/" + baseName + ".xsch";
+        return stream.status() == QDataStream::Ok;
+    }
 
-                if(!schematicsList.contains(schematic)) {
-                    schematicsList << schematic;
-                }
+    /*!
+     * \brief Reads the \a sections of the binary data in \a device.
+     *
+     * The items read are appended to \a items, without adding them to any
+     * scene. Symbol properties are directly set in the scene.
+     */
+    bool FormatBinary::read(QIODevice *device, int sections, QList<GraphicsItem*> *items) const
+    {
+        QDataStream stream(device);
+        stream.setVersion(QDataStream::Qt_5_3);
 
-                model.remove("%generateNetlist");
-            }
+        quint32 magic, version, documentType;
+        QString canedaVersion;
+        stream >> magic >> version >> documentType >> canedaVersion;
 
-            // Add the model and a newline to the file
-            retVal.append(model + "\n");
+        if(stream.status() != QDataStream::Ok || magic != quint32(Magic) ||
+                version != quint32(Version) || documentType != quint32(m_documentType) ||
+                !Caneda::checkVersion(canedaVersion)) {
+            return false;
         }
 
-        // ************************************************************
-        // Write the QStringLists that should be in the end of the
-        // file (e.g. device models).
-        // ************************************************************
-        // Append the spice models in modelsList
-        if(!modelsList.isEmpty()) {
-            retVal.append("\n* Device models.\n");
-            for(int i=0; i<modelsList.size(); i++){
-                retVal.append(".model " + modelsList.at(i) + "\n");
-            }
+        quint32 count;
+        stream >> count;
+
+        QHash<quint32, SectionEntry> entries;
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            SectionEntry entry;
+            stream >> entry.section >> entry.offset >> entry.size >> entry.count;
+            entries.insert(entry.section, entry);
         }
 
-        // Append the spice subcircuits in subcircuitsList
-        if(!subcircuitsList.isEmpty()) {
-            retVal.append("\n* Subcircuits models.\n");
-            for(int i=0; i<subcircuitsList.size(); i++){
-                retVal.append(".subckt " + subcircuitsList.at(i) + "\n"
-                              + ".ends" + "\n");
-            }
+        if(stream.status() != QDataStream::Ok) {
+            return false;
         }
 
-        // Append the spice directives in directivesList
-        if(!directivesList.isEmpty()) {
-            retVal.append("\n* Spice directives.\n");
-            for(int i=0; i<directivesList.size(); i++){
-                retVal.append(directivesList.at(i) + "\n");
+        // Read the data of the requested sections. The strings are always
+        // needed, as the other sections refer to them. Sections must lie
+        // within the device, as their sizes are allocated before reading.
+        sections |= StringsSection;
+        qint64 dataStart = device->pos();
+        qint64 dataSize = device->size() - dataStart;
+
+        QHash<quint32, QByteArray> data;
+        QHash<quint32, SectionEntry>::const_iterator it;
+        for(it = entries.constBegin(); it != entries.constEnd(); ++it) {
+            if(!(sections & it->section)) {
+                continue;
+            }
+
+            if(it->offset < 0 || it->size < 0 || it->offset > dataSize ||
+                    it->size > dataSize - it->offset) {
+                return false;
+            }
+
+            if(!device->seek(dataStart + it->offset)) {
+                return false;
+            }
+
+            QByteArray sectionData = device->read(it->size);
+            if(sectionData.size() != it->size) {
+                return false;
+            }
+
+            data.insert(it->section, sectionData);
+        }
+
+        StringTable strings;
+        QDataStream stringsStream(data.value(StringsSection));
+        stringsStream.setVersion(QDataStream::Qt_5_3);
+        const quint32 stringCount = entries.value(StringsSection).count;
+        for(quint32 i = 0; i < stringCount && stringsStream.status() == QDataStream::Ok; ++i) {
+            QString string;
+            stringsStream >> string;
+            strings.strings << string;
+        }
+
+        bool result = stringsStream.status() == QDataStream::Ok;
+
+        if(result && data.contains(ComponentsSection)) {
+            result = loadComponents(data.value(ComponentsSection), entries.value(ComponentsSection).count,
+                                    data.value(PropertiesSection), strings, items);
+        }
+        if(result && data.contains(PortsSection)) {
+            result = loadPorts(data.value(PortsSection), entries.value(PortsSection).count, strings, items);
+        }
+        if(result && data.contains(WiresSection)) {
+            result = loadWires(data.value(WiresSection), entries.value(WiresSection).count, items);
+        }
+        if(result && data.contains(PaintingsSection)) {
+            result = loadPaintings(data.value(PaintingsSection), entries.value(PaintingsSection).count, items);
+        }
+        if(result && data.contains(SymbolSection) && graphicsScene()) {
+            result = loadSymbol(data.value(SymbolSection), entries.value(SymbolSection).count, strings);
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Returns the index of \a string in the table, adding it if it is
+     * not yet there.
+     */
+    quint32 FormatBinary::StringTable::intern(const QString &string)
+    {
+        QHash<QString, quint32>::const_iterator it = indexes.constFind(string);
+        if(it != indexes.constEnd()) {
+            return it.value();
+        }
+
+        quint32 index = strings.size();
+        strings << string;
+        indexes.insert(string, index);
+
+        return index;
+    }
+
+    //! \brief Returns the string at \a index, or a null string if there is none.
+    QString FormatBinary::StringTable::at(quint32 index) const
+    {
+        return index < quint32(strings.size()) ? strings.at(index) : QString();
+    }
+
+    /*!
+     * \brief Saves the scene components.
+     *
+     * Each component is saved as a record with its name and library, its
+     * position and transform, the position of its properties and the number
+     * of its properties. The properties themselves are saved into
+     * \a properties, one record per property, in the same order as the
+     * components.
+     *
+     * \sa loadComponents()
+     */
+    QByteArray FormatBinary::saveComponents(QList<QGraphicsItem*> &items, StringTable *strings,
+                                            quint32 *count, QByteArray *properties) const
+    {
+        QList<Component*> components = filterItems<Component>(items);
+
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        QDataStream propertiesStream(properties, QIODevice::WriteOnly);
+        propertiesStream.setVersion(QDataStream::Qt_5_3);
+
+        foreach(Component *c, components) {
+            // Only the rotation and mirroring part of the transform is
+            // saved, as in the xml format.
+            QTransform transform = c->sceneTransform();
+            PropertyGroup *group = c->properties();
+            PropertyMap propertyMap = group->propertyMap();
+
+            stream << strings->intern(c->name()) << strings->intern(c->library());
+            stream << double(c->pos().x()) << double(c->pos().y());
+            stream << double(transform.m11()) << double(transform.m12())
+                   << double(transform.m21()) << double(transform.m22());
+            stream << double(group->pos().x()) << double(group->pos().y());
+            stream << quint32(propertyMap.size());
+
+            foreach(const Property &property, propertyMap) {
+                propertiesStream << strings->intern(property.name())
+                                 << strings->intern(property.value())
+                                 << quint8(property.isVisible());
+            }
+        }
+
+        *count = components.size();
+        return data;
+    }
+
+    //! \brief Saves the scene port symbols, one record per port.
+    QByteArray FormatBinary::savePorts(QList<QGraphicsItem*> &items, StringTable *strings,
+                                       quint32 *count) const
+    {
+        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
+
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        foreach(PortSymbol *p, portSymbols) {
+            stream << strings->intern(p->label());
+            stream << double(p->pos().x()) << double(p->pos().y());
+        }
+
+        *count = portSymbols.size();
+        return data;
+    }
+
+    //! \brief Saves the scene wires, one record with both ends per wire.
+    QByteArray FormatBinary::saveWires(QList<QGraphicsItem*> &items, quint32 *count) const
+    {
+        QList<Wire*> wires = filterItems<Wire>(items);
+
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        foreach(Wire *w, wires) {
+            QPointF p1 = w->port1()->scenePos();
+            QPointF p2 = w->port2()->scenePos();
+
+            stream << double(p1.x()) << double(p1.y()) << double(p2.x()) << double(p2.y());
+        }
+
+        *count = wires.size();
+        return data;
+    }
+
+    /*!
+     * \brief Saves the scene paintings.
+     *
+     * Each painting is saved as the xml fragment written by its
+     * GraphicsItem::saveData() method.
+     */
+    QByteArray FormatBinary::savePaintings(QList<QGraphicsItem*> &items, quint32 *count) const
+    {
+        QList<Painting*> paintings = filterItems<Painting>(items);
+
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        foreach(Painting *p, paintings) {
+            QByteArray fragment;
+            {
+                Caneda::XmlWriter writer(&fragment);
+                p->saveData(&writer);
+            }
+
+            stream << fragment;
+        }
+
+        *count = paintings.size();
+        return data;
+    }
+
+    //! \brief Saves the properties of a symbol scene.
+    QByteArray FormatBinary::saveSymbol(StringTable *strings, quint32 *count) const
+    {
+        PropertyGroup *properties = graphicsScene()->properties();
+        PropertyMap propertyMap = properties->propertyMap();
+
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        stream << double(properties->pos().x()) << double(properties->pos().y());
+
+        foreach(const Property &property, propertyMap) {
+            stream << strings->intern(property.name())
+                   << strings->intern(property.value())
+                   << strings->intern(property.description())
+                   << quint8(property.isVisible());
+        }
+
+        *count = propertyMap.size();
+        return data;
+    }
+
+    /*!
+     * \brief Reads the components section.
+     *
+     * If \a properties is empty (the properties section was not loaded), the
+     * components keep the default values of their properties.
+     *
+     * \sa saveComponents()
+     */
+    bool FormatBinary::loadComponents(const QByteArray &data, quint32 count,
+                                      const QByteArray &properties, const StringTable &strings,
+                                      QList<GraphicsItem*> *items) const
+    {
+        LibraryManager *libraryManager = LibraryManager::instance();
+
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        QDataStream propertiesStream(properties);
+        propertiesStream.setVersion(QDataStream::Qt_5_3);
+
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            quint32 name, library, propertyCount;
+            double x, y, m11, m12, m21, m22, propertiesX, propertiesY;
+            stream >> name >> library >> x >> y >> m11 >> m12 >> m21 >> m22
+                   >> propertiesX >> propertiesY >> propertyCount;
+
+            // Read the property records of this component, even if it is
+            // skipped, to keep the properties in sync with the components.
+            QList<Property> values;
+            if(!properties.isEmpty()) {
+                for(quint32 j = 0; j < propertyCount && propertiesStream.status() == QDataStream::Ok; ++j) {
+                    quint32 propertyName, value;
+                    quint8 visible;
+                    propertiesStream >> propertyName >> value >> visible;
+                    values << Property(strings.at(propertyName), strings.at(value),
+                                       QString(), visible);
+                }
+            }
+
+            QString componentName = strings.at(name);
+            ComponentDataPtr componentData = libraryManager->componentData(componentName,
+                                                                          strings.at(library));
+            if(!componentData.constData()) {
+                qWarning() << "Warning: Found unknown element" << componentName << ", skipping...";
+                continue;
+            }
+
+            Component *component = new Component();
+            component->setPos(x, y);
+            component->setTransform(QTransform(m11, m12, m21, m22, 0, 0));
+            component->setComponentData(componentData);
+
+            PropertyGroup *group = component->properties();
+            group->setPos(propertiesX, propertiesY);
+
+            if(!values.isEmpty()) {
+                PropertyMap propertyMap = group->propertyMap();
+                foreach(const Property &value, values) {
+                    if(!propertyMap.contains(value.name())) {
+                        qWarning() << "Property " << value.name() << "not found in map!";
+                        continue;
+                    }
+
+                    Property &property = propertyMap[value.name()];
+                    property.setValue(value.value());
+                    property.setVisible(value.isVisible());
+                }
+                group->setPropertyMap(propertyMap);
+            }
+
+            *items << component;
+        }
+
+        return stream.status() == QDataStream::Ok && propertiesStream.status() == QDataStream::Ok;
+    }
+
+    //! \brief Reads the ports section. \sa savePorts()
+    bool FormatBinary::loadPorts(const QByteArray &data, quint32 count, const StringTable &strings,
+                                 QList<GraphicsItem*> *items) const
+    {
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            quint32 name;
+            double x, y;
+            stream >> name >> x >> y;
+
+            PortSymbol *portSymbol = new PortSymbol();
+            portSymbol->setPos(x, y);
+            portSymbol->setLabel(strings.at(name));
+            *items << portSymbol;
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    //! \brief Reads the wires section. \sa saveWires()
+    bool FormatBinary::loadWires(const QByteArray &data, quint32 count, QList<GraphicsItem*> *items) const
+    {
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            double x1, y1, x2, y2;
+            stream >> x1 >> y1 >> x2 >> y2;
+
+            Wire *wire = new Wire(QPointF(x1, y1), QPointF(x2, y2));
+            *items << wire;
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    //! \brief Reads the paintings section. \sa savePaintings()
+    bool FormatBinary::loadPaintings(const QByteArray &data, quint32 count,
+                                     QList<GraphicsItem*> *items) const
+    {
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QByteArray fragment;
+            stream >> fragment;
+
+            Caneda::XmlReader reader(fragment);
+            while(!reader.atEnd() && !reader.isStartElement()) {
+                reader.readNext();
+            }
+
+            if(reader.name() != "painting") {
+                return false;
+            }
+
+            QString name = reader.attributes().value("name").toString();
+            Painting *painting = Painting::fromName(name);
+            if(!painting) {
+                qWarning() << "Error: Found unknown painting type" << name;
+                continue;
+            }
+
+            painting->loadData(&reader);
+            *items << painting;
+
+            if(reader.hasError()) {
+                return false;
+            }
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    //! \brief Reads the properties of a symbol scene. \sa saveSymbol()
+    bool FormatBinary::loadSymbol(const QByteArray &data, quint32 count, const StringTable &strings) const
+    {
+        GraphicsScene *scene = graphicsScene();
+
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        double x, y;
+        stream >> x >> y;
+        scene->properties()->setPos(x, y);
+
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            quint32 name, value, description;
+            quint8 visible;
+            stream >> name >> value >> description >> visible;
+
+            scene->addProperty(Property(strings.at(name), strings.at(value),
+                                        strings.at(description), visible));
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    QString FormatBinary::fileName() const
+    {
+        return m_document ? m_document->fileName() : QString();
+    }
+
+
+    /*************************************************************************
+     *                             FormatSpice                               *
+     *************************************************************************/
+    //! \brief Constructor.
+    FormatSpice::FormatSpice(SchematicDocument *document) :
+        QObject(document),
+        m_schematicDocument(document)
+    {
+    }
+
+    bool FormatSpice::save()
+    {
+        GraphicsScene *scene = graphicsScene();
+        if(!scene) {
+            return false;
+        }
+
+        QFile file(fileName());
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                    QObject::tr("Cannot save document!"));
+            return false;
+        }
+
+        QString text = generateNetlist();
+        if(text.isEmpty()) {
+            qDebug() << "Looks buggy! Null data to save! Was this expected?";
+        }
+
+        QTextStream stream(&file);
+        stream << text;
+        file.close();
+
+        return true;
+    }
+
+    GraphicsScene *FormatSpice::graphicsScene() const
+    {
+        return m_schematicDocument ? m_schematicDocument->graphicsScene() : 0;
+    }
+
+    QString FormatSpice::fileName() const
+    {
+        if(m_schematicDocument) {
+            QFileInfo info(m_schematicDocument->fileName());
+            QString baseName = info.completeBaseName();
+            QString path = info.path();
+
+            return path + "/" + baseName + ".net";
+        }
+
+        return QString();
+    }
+
+    /*!
+     *  \brief Generate netlist
+     *
+     *  Iterate over all components, saving to a string the schematic netlist
+     *  according to the model provided as a set of rules. In order to do so,
+     *  the netlist topology must also be created, that is the connections
+     *  between the multiple components must be determined and numbered to be
+     *  used for the spice netlist. The set of rules used for generating the
+     *  netlist from the model is specified in \ref ModelsFormat.
+     *
+     *  \sa appendModel(), generateNetlistTopology(), \ref ModelsFormat
+     */
+    QString FormatSpice::generateNetlist()
+    {
+        QList<QGraphicsItem*> items = graphicsScene()->items();
+        QList<Component*> components = filterItems<Component>(items);
+
+        m_netlist = generateNetlistTopology();
+        m_filePath = QFileInfo(m_schematicDocument->fileName()).absolutePath();
+
+        m_models.clear();
+        m_subcircuits.clear();
+        m_directives.clear();
+        m_schematics.clear();
+
+        // Start the document and write the header
+        QString retVal;
+        retVal.append("* Spice automatic export. Generated by Caneda.\n");
+        retVal.append("\n* Spice netlist.\n");
+
+        // Copy all the elements and properties in the schematic by
+        // iterating over all schematic components. The spice model of each
+        // component is compiled only once per library component, and here
+        // it is just evaluated for each instance.
+        foreach(Component *c, components) {
+            ModelTemplate model = c->modelTemplate("spice");
+            appendModel(model, 0, model.size(), c, &retVal);
+
+            // Add a newline to the file
+            retVal.append("\n");
+        }
+
+        // ************************************************************
+        // Write the QStringLists that should be in the end of the
+        // file (e.g. device models).
+        // ************************************************************
+        // Append the spice models in m_models
+        if(!m_models.isEmpty()) {
+            retVal.append("\n* Device models.\n");
+            for(int i=0; i<m_models.size(); i++){
+                retVal.append(".model " + m_models.at(i) + "\n");
+            }
+        }
+
+        // Append the spice subcircuits in m_subcircuits
+        if(!m_subcircuits.isEmpty()) {
+            retVal.append("\n* Subcircuits models.\n");
+            for(int i=0; i<m_subcircuits.size(); i++){
+                retVal.append(".subckt " + m_subcircuits.at(i) + "\n"
+                              + ".ends" + "\n");
+            }
+        }
+
+        // Append the spice directives in m_directives
+        if(!m_directives.isEmpty()) {
+            retVal.append("\n* Spice directives.\n");
+            for(int i=0; i<m_directives.size(); i++){
+                retVal.append(m_directives.at(i) + "\n");
             }
         }
 
         // ************************************************************
         // Create the needed recursive netlist documents
         // ************************************************************
-        if(!schematicsList.isEmpty()) {
-            for(int i=0; i<schematicsList.size(); i++){
+        if(!m_schematics.isEmpty()) {
+            for(int i=0; i<m_schematics.size(); i++){
+
+                SchematicDocument *document = new SchematicDocument();
+                document->setFileName(m_schematics.at(i));
+
+                if(document->load()) {
+                    // Export the schematic to a spice netlist
+                    FormatSpice *format = new FormatSpice(document);
+                    format->save();
+                }
+
+                delete document;
+            }
+        }
+
+        // Remove multiple white spaces to clean up the file
+        QRegularExpression re(" {2,}");
+        retVal.replace(re, " ");
+
+        return retVal;
+    }
+
+    /*!
+     *  \brief Evaluate a compiled model
+     *
+     *  Evaluates the instructions of \a model between \a begin and \a end for
+     *  \a component, appending the result to \a output. Models, subcircuits
+     *  and directives are not written to the output, but collected to be
+     *  added only once at the end of the netlist, and components requiring
+     *  the generation of their own netlist are collected for recursive
+     *  netlists generation.
+     *
+     *  Ports not found in the netlist are written back as the original
+     *  escape sequence.
+     *
+     *  \sa generateNetlist(), ModelTemplate, \ref ModelsFormat
+     */
+    void FormatSpice::appendModel(const ModelTemplate &model, int begin, int end,
+                                  Component *component, QString *output)
+    {
+        for(int i = begin; i < end; ++i) {
+            const ModelTemplate::Instruction &instruction = model.at(i);
+
+            switch(instruction.opcode) {
+            case ModelTemplate::Text:
+                output->append(instruction.text);
+                break;
+
+            case ModelTemplate::Label:
+                output->append(component->label());
+                break;
+
+            case ModelTemplate::LibraryPath:
+                output->append(LibraryManager::instance()->library(component->library())->libraryPath());
+                break;
+
+            case ModelTemplate::FilePath:
+                output->append(m_filePath);
+                break;
+
+            case ModelTemplate::Port:
+            {
+                bool found = false;
+                foreach(Port *_port, component->ports()) {
+                    if(_port->name() == instruction.text) {
+                        // Found the port, now look for its netlist name
+                        PortsNetlist::const_iterator net = m_netlist.constFind(_port);
+                        if(net != m_netlist.constEnd()) {
+                            output->append(net.value());
+                            found = true;
+                        }
+                        break;
+                    }
+                }
+
+                if(!found) {
+                    output->append("%port{" + instruction.text + "}");
+                }
+                break;
+            }
+
+            case ModelTemplate::Property:
+                output->append(component->properties()->propertyValue(instruction.text));
+                break;
+
+            case ModelTemplate::If:
+            {
+                // The value is only output if the condition is not empty
+                QString condition;
+                appendModel(model, i + 1, i + 1 + instruction.condition, component, &condition);
+
+                if(!condition.isEmpty()) {
+                    appendModel(model, i + 1 + instruction.condition, i + 1 + instruction.size,
+                                component, output);
+                }
+
+                i += instruction.size;
+                break;
+            }
+
+            case ModelTemplate::Model:
+            case ModelTemplate::Subcircuit:
+            case ModelTemplate::Directive:
+            {
+                // Models, subcircuits and directives should be added to a
+                // temporal list to be included only once at the end of the
+                // spice file.
+                QString argument;
+                appendModel(model, i + 1, i + 1 + instruction.size, component, &argument);
+
+                QStringList *list = &m_directives;
+                if(instruction.opcode == ModelTemplate::Model) {
+                    list = &m_models;
+                }
+                else if(instruction.opcode == ModelTemplate::Subcircuit) {
+                    list = &m_subcircuits;
+                }
+
+                if(!list->contains(argument)) {
+                    list->append(argument);
+                }
+
+                i += instruction.size;
+                break;
+            }
+
+            case ModelTemplate::GenerateNetlist:
+            {
+                // Create a temporal list of schematics needed for recursive
+                // netlists generation (for recursive simulations).
+                QFileInfo info(component->filename());
+                QString baseName = info.completeBaseName();
+                QString path = LibraryManager::instance()->library(component->library())->libraryPath();
+                QString schematic = path + "/" + baseName + ".xsch";
+
+                if(!m_schematics.contains(schematic)) {
+                    m_schematics.append(schematic);
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    /*!
+     *  \brief Generate netlist net numbers
+     *
+     *  Iterate over all ports, to group all connected ports under
+     *  the same name (name = equiId). This name or net number must
+     *  be used afterwads by all component ports during netlist
+     *  generation.
+     *
+     *  We use all connected ports (including those connected by wires),
+     *  instead of connected wires during netlist generation. This allows
+     *  to create a netlist node even on those places not connected by
+     *  wires (for example when connecting two components together).
+     *
+     *  The nets are found with a breadth first search over the ports, where
+     *  the neighbours of a port are the members of its node (as returned by
+     *  Port::connections()) and, for wires, the opposite port of the wire.
+     *  As every node is visited only once, and the net number of each port
+     *  is stored in a hash, the extraction takes linear time in the number
+     *  of ports.
+     *
+     *  \sa saveComponents(), Port::getEquipotentialPorts()
+     */
+    PortsNetlist FormatSpice::generateNetlistTopology()
+    {
+        /*! \todo Investigate: If we use QList<GraphicsItem*> canedaItems = filterItems<Ports>(items);
+         *  some phantom ports appear, and seem to be uninitialized, generating an ugly crash. Hence
+         *  we filter generic items and use an iteration over their ports as a workaround.
+         */
+        QList<QGraphicsItem*> items = graphicsScene()->items();
+        QList<GraphicsItem*> canedaItems = filterItems<GraphicsItem>(items);
+        QList<Port*> ports;
+        foreach(GraphicsItem *i, canedaItems) {
+            ports << i->ports();
+        }
+
+        QHash<Port*, int> netIds;
+        netIds.reserve(ports.size());
+        QVector<QString> netNames;
+
+        QList<Port*> queue;
+
+        foreach(Port *p, ports) {
+            if(netIds.contains(p)) {
+                continue;
+            }
+
+            // Start a new net, numbered from 1
+            int equiId = netNames.size() + 1;
+            netNames.append(QString::number(equiId));
+
+            // A node is always assigned as a whole, so when a port is found
+            // unassigned, all its node members are also unassigned.
+            Port *next = p;
+            int head = 0;
+            queue.clear();
+
+            while(next) {
+                foreach(Port *member, next->connections()) {
+                    netIds.insert(member, equiId);
+                    queue.append(member);
+                }
+
+                // Look for a wire leading to a node not yet assigned
+                next = 0;
+                while(!next && head < queue.size()) {
+                    Port *current = queue.at(head++);
+                    if(current->parentItem()->type() == GraphicsItem::WireType) {
+                        Wire *_wire = static_cast<Wire*>(current->parentItem());
+                        Port *opposite = (current == _wire->port1()) ? _wire->port2() : _wire->port1();
+                        if(!netIds.contains(opposite)) {
+                            next = opposite;
+                        }
+                    }
+                }
+            }
+        }
+
+        replacePortNames(netIds, &netNames);
+
+        PortsNetlist netlist;
+        netlist.reserve(netIds.size());
+
+        QHash<Port*, int>::const_iterator it = netIds.constBegin();
+        for(; it != netIds.constEnd(); ++it) {
+            netlist.insert(it.key(), netNames.at(it.value() - 1));
+        }
+
+        return netlist;
+    }
+
+    /*!
+     * \brief Replace net names in the netlist by those specified by
+     * portSymbols.
+     *
+     * Iterate over all PortSymbols, renaming the net each one is connected
+     * to with the PortSymbol label. Take special care of the ground nets,
+     * that must be named "0" to be complatible with the spice netlist
+     * format.
+     *
+     * \param netIds Net number of each port, as found during the topology
+     * extraction.
+     * \param netNames Names of the nets, indexed by net number - 1, which
+     * are to be replaced by the PortSymbol names.
+     *
+     * \sa PortSymbol, generateNetlistTopology()
+     */
+    void FormatSpice::replacePortNames(const QHash<Port*, int> &netIds, QVector<QString> *netNames)
+    {
+        QList<QGraphicsItem*> items = graphicsScene()->items();
+        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
+
+        // Iterate over all PortSymbols
+        foreach(PortSymbol *p, portSymbols) {
+
+            // Given the port, look for its net number
+            int equiId = netIds.value(p->port(), 0);
+            if(equiId == 0) {
+                continue;
+            }
+
+            // Given the net number, rename the net with the new name
+            if(p->label().toLower() == "ground" || p->label().toLower() == "gnd") {
+                (*netNames)[equiId - 1] = QString::number(0);
+            }
+            else {
+                (*netNames)[equiId - 1] = p->label();
+            }
+        }
+    }
+
+
+    /*************************************************************************
+     *                            RawAsciiReader                             *
+     *************************************************************************/
+    /*!
+     * \brief Constructs a new reader, starting at the current position of
+     * \a device.
+     *
+     * \param device Device to read.
+     * \param completeLinesOnly If true, a last line without line terminator
+     * is not read, as it may still be being written (for example, when
+     * following a simulation in progress).
+     */
+    RawAsciiReader::RawAsciiReader(QIODevice *device, bool completeLinesOnly) :
+        m_device(device),
+        m_begin(0),
+        m_end(0),
+        m_completeLinesOnly(completeLinesOnly),
+        m_atHeader(false)
+    {
+        m_buffer.resize(1 << 20);  // Read the file in chunks of 1 MiB
+    }
+
+    /*!
+     * \brief Reads the value in the next non blank line.
+     *
+     * \param real Where to store the value, or its real part.
+     * \param imaginary Where to store the imaginary part, or 0 if the data
+     * is real.
+     * \return False if the end of the device or a header line was reached,
+     * true otherwise.
+     *
+     * \sa atHeader()
+     */
+    bool RawAsciiReader::readValue(double *real, double *imaginary)
+    {
+        const char *begin;
+        const char *end;
+        if(!nextLine(&begin, &end)) {
+            return false;
+        }
 
-                SchematicDocument *document = new SchematicDocument();
-                document->setFileName(schematicsList.at(i));
+        // The value is the last field of the line
+        const char *field = end;
+        while(field > begin && *(field - 1) != '\t') {
+            --field;
+        }
 
-                if(document->load()) {
-                    // Export the schematic to a spice netlist
-                    FormatSpice *format = new FormatSpice(document);
-                    format->save();
-                }
+        if(!imaginary) {
+            *real = parseDouble(field, end);
+            return true;
+        }
 
-                delete document;
-            }
+        // Split the real and imaginary parts
+        const char *comma = field;
+        while(comma < end && *comma != ',') {
+            ++comma;
         }
 
-        // Remove multiple white spaces to clean up the file
-        QRegularExpression re(" {2,}");
-        retVal.replace(re, " ");
+        *real = parseDouble(field, comma);
+        *imaginary = (comma < end) ? parseDouble(comma + 1, end) : 0;
 
-        return retVal;
+        return true;
+    }
+
+    //! \brief Returns the device position right after the last line read.
+    qint64 RawAsciiReader::pos() const
+    {
+        return m_device->pos() - (m_end - m_begin);
     }
 
     /*!
-     *  \brief Generate netlist net numbers
-     *
-     *  Iterate over all ports, to group all connected ports under
-     *  the same name (name = equiId). This name or net number must
-     *  be used afterwads by all component ports during netlist
-     *  generation.
-     *
-     *  We use all connected ports (including those connected by wires),
-     *  instead of connected wires during netlist generation. This allows
-     *  to create a netlist node even on those places not connected by
-     *  wires (for example when connecting two components together).
+     * \brief Finds the next non blank line in the buffer, reading more data
+     * from the device if needed.
      *
-     *  \sa saveComponents(), Port::getEquipotentialPorts()
+     * \param begin Set to the start of the line.
+     * \param end Set to the end of the line, excluding the line terminator.
+     * \return False if there are no more data lines, true otherwise.
      */
-    PortsNetlist FormatSpice::generateNetlistTopology()
+    bool RawAsciiReader::nextLine(const char **begin, const char **end)
     {
-        /*! \todo Investigate: If we use QList<GraphicsItem*> canedaItems = filterItems<Ports>(items);
-         *  some phantom ports appear, and seem to be uninitialized, generating an ugly crash. Hence
-         *  we filter generic items and use an iteration over their ports as a workaround.
-         */
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<GraphicsItem*> canedaItems = filterItems<GraphicsItem>(items);
-        QList<Port*> ports;
-        foreach(GraphicsItem *i, canedaItems) {
-            ports << i->ports();
-        }
+        int searchFrom = m_begin;
 
-        int equiId = 1;
-        PortsNetlist netlist;
-        QList<Port*> parsedPorts;
+        forever {
+            const char *data = m_buffer.constData();
 
-        foreach(Port *p, ports) {
-            if(parsedPorts.contains(p)) {
-                continue;
+            int newline = searchFrom;
+            while(newline < m_end && data[newline] != '\n') {
+                ++newline;
+            }
+
+            if(newline == m_end) {
+                int parsed = newline - m_begin;
+                if(fillBuffer()) {
+                    searchFrom = m_begin + parsed;  // Don't search the same bytes again
+                    continue;
+                }
+
+                // Last line of the device, without line terminator
+                if(m_begin == m_end || m_completeLinesOnly) {
+                    return false;
+                }
+                newline = m_end;
             }
 
-            QList<Port*> equi;
-            p->getEquipotentialPorts(equi);
-            foreach(Port *_port, equi) {
-                netlist.append(qMakePair(_port, QString::number(equiId)));
+            // Header lines (as the title of the next plot) start with a
+            // letter, while data lines start with the point index or blanks.
+            char first = data[m_begin];
+            if((first >= 'a' && first <= 'z') || (first >= 'A' && first <= 'Z')) {
+                m_atHeader = true;
+                return false;
             }
 
-            equiId++;
-            parsedPorts += equi;
-        }
+            // Strip the line terminator and skip blank lines
+            int lineEnd = newline;
+            if(lineEnd > m_begin && data[lineEnd - 1] == '\r') {
+                --lineEnd;
+            }
 
-        replacePortNames(&netlist);
+            int lineBegin = m_begin;
+            while(lineBegin < lineEnd && (data[lineBegin] == ' ' || data[lineBegin] == '\t')) {
+                ++lineBegin;
+            }
 
-        return netlist;
+            m_begin = qMin(newline + 1, m_end);
+            searchFrom = m_begin;
+
+            if(lineBegin < lineEnd) {
+                *begin = data + lineBegin;
+                *end = data + lineEnd;
+                return true;
+            }
+        }
     }
 
     /*!
-     * \brief Replace net names in the netlist by those specified by
-     * portSymbols.
-     *
-     * Iterate over all nets in the netlist, replacing those names that
-     * correspond to the ones selected by the user using PortSymbols.
-     * Take special care of the ground nets, that must be named "0" to
-     * be complatible with the spice netlist format.
+     * \brief Reads more data from the device into the buffer.
      *
-     * \param netlist Netlist which is to be used in PortSymbol names
-     * replacement.
+     * The unparsed data is moved to the start of the buffer, and the buffer
+     * grows if a single line does not fit into it.
      *
-     * \sa PortSymbol, generateNetlistTopology()
+     * \return False if no more data could be read, true otherwise.
      */
-    void FormatSpice::replacePortNames(PortsNetlist *netlist)
+    bool RawAsciiReader::fillBuffer()
     {
-        QList<QGraphicsItem*> items = graphicsScene()->items();
-        QList<PortSymbol*> portSymbols = filterItems<PortSymbol>(items);
+        if(m_begin > 0) {
+            memmove(m_buffer.data(), m_buffer.constData() + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        }
 
-        // Iterate over all PortSymbols
-        foreach(PortSymbol *p, portSymbols) {
+        if(m_end == m_buffer.size()) {
+            m_buffer.resize(2 * m_buffer.size());
+        }
+
+        qint64 read = m_device->read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+        if(read <= 0) {
+            return false;
+        }
+
+        m_end += read;
+        return true;
+    }
 
-            // Given the port, look for its netlist name
-            QString netName;
-            for(int i = 0; i < netlist->size(); ++i) {
-                if(netlist->at(i).first == p->port()) {
-                    netName = netlist->at(i).second;
+    /*!
+     * \brief Parses the floating point number in [\a begin, \a end).
+     *
+     * This is a locale independent parser which does not need a null
+     * terminated string, and therefore can be used directly on the read
+     * buffer. Up to 19 significant digits are used, and the result is exact
+     * whenever the mantissa and the power of ten are exactly representable,
+     * and within a couple of ulps otherwise (more than enough for waveform
+     * data). Anything the fast path does not understand (like the "nan" and
+     * "inf" values written by diverging simulations) is handed to
+     * QByteArray::toDouble().
+     *
+     * \return The number parsed, or 0 if no number could be parsed.
+     */
+    double RawAsciiReader::parseDouble(const char *begin, const char *end)
+    {
+        static const double powers[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+            1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+            1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const char *p = begin;
+        while(p < end && (*p == ' ' || *p == '\t')) {
+            ++p;
+        }
+
+        bool negative = false;
+        if(p < end && (*p == '-' || *p == '+')) {
+            negative = (*p == '-');
+            ++p;
+        }
+
+        quint64 mantissa = 0;
+        int digits = 0;    // Significant digits stored in the mantissa
+        int exponent = 0;  // Decimal exponent of the mantissa
+        bool valid = false;
+
+        // Integer part
+        for(; p < end && *p >= '0' && *p <= '9'; ++p) {
+            valid = true;
+            if(digits < 19) {
+                mantissa = 10*mantissa + (*p - '0');
+                if(mantissa != 0) {
+                    ++digits;
                 }
             }
+            else {
+                ++exponent;
+            }
+        }
 
-            // Given the netlist name, rename all occurencies with the new name
-            for(int i = 0; i < netlist->size(); ++i) {
-                if(netlist->at(i).second == netName) {
-                    if(p->label().toLower() == "ground" || p->label().toLower() == "gnd") {
-                        netlist->replace(i, qMakePair(netlist->at(i).first, QString::number(0)));
-                    }
-                    else {
-                        netlist->replace(i, qMakePair(netlist->at(i).first, p->label()));
+        // Fractional part
+        if(p < end && *p == '.') {
+            for(++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+                valid = true;
+                if(digits < 19) {
+                    mantissa = 10*mantissa + (*p - '0');
+                    if(mantissa != 0) {
+                        ++digits;
                     }
+                    --exponent;
                 }
             }
         }
+
+        if(!valid) {
+            // Not a plain decimal number, let Qt parse nan, inf and the like
+            bool ok;
+            double value = QByteArray(begin, end - begin).trimmed().toDouble(&ok);
+            return ok ? value : 0;
+        }
+
+        // Exponent part
+        if(p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool negativeExponent = false;
+            if(p < end && (*p == '-' || *p == '+')) {
+                negativeExponent = (*p == '-');
+                ++p;
+            }
+
+            int value = 0;
+            for(; p < end && *p >= '0' && *p <= '9'; ++p) {
+                if(value < 10000) {
+                    value = 10*value + (*p - '0');
+                }
+            }
+
+            exponent += negativeExponent ? -value : value;
+        }
+
+        // Scale the mantissa by the power of ten, using exact powers only
+        double result = double(mantissa);
+        if(mantissa != 0) {
+            while(exponent > 22) {
+                result *= powers[22];
+                exponent -= 22;
+            }
+            while(exponent < -22) {
+                result /= powers[22];
+                exponent += 22;
+            }
+            result = (exponent >= 0) ? result * powers[exponent] : result / powers[-exponent];
+        }
+
+        return negative ? -result : result;
     }
 
 
@@ -1710,8 +2752,21 @@ namespace Caneda
     //! \brief Constructor.
     FormatRawSimulation::FormatRawSimulation(SimulationDocument *document) :
         QObject(document),
-        m_simulationDocument(document)
+        m_simulationDocument(document),
+        m_position(0),
+        m_following(false)
+    {
+        m_file = new QFile(this);
+
+        m_followTimer = new QTimer(this);
+        m_followTimer->setInterval(500);  // Append new data in batches, twice per second
+        connect(m_followTimer, SIGNAL(timeout()), this, SLOT(update()));
+    }
+
+    //! \brief Destructor.
+    FormatRawSimulation::~FormatRawSimulation()
     {
+        qDeleteAll(m_plots);
     }
 
     //! \brief Load the waveform file indicated by \a filename.
@@ -1723,318 +2778,546 @@ namespace Caneda
         }
 
         QString filename = m_simulationDocument->fileName();
-        QFile file(filename);
-        if(!file.open(QIODevice::ReadOnly)) {
+        m_file->setFileName(filename);
+        if(!m_file->open(QIODevice::ReadOnly)) {
             QMessageBox::critical(0, QObject::tr("Error"),
                     QObject::tr("Cannot load document ") + filename);
             return false;
         }
 
-        QTextStream in(&file);
-        parseFile(&in);  // Parse the raw file
-        file.close();
+        parseFile();  // Parse the raw file
+
+        // Binary data stays mapped even after closing the file. Keep the
+        // position in the file, in case the file is followed later.
+        if(!m_following) {
+            m_position = m_file->pos();
+            m_file->close();
+        }
 
         return true;
     }
 
+    /*!
+     * \brief Sets the following state of the raw file.
+     *
+     * While following, the file is periodically checked for new data, which
+     * is appended to the existing curves in batches. This allows displaying
+     * the waveforms of a simulation while the simulator is still writing the
+     * raw file.
+     *
+     * As the simulator may still be writing the file, only complete lines
+     * and data records are read while following. The number of points of
+     * the plots is also not reliable (ngspice, for example, updates it once
+     * the simulation has finished), so all the data available is read.
+     *
+     * \sa update()
+     */
+    void FormatRawSimulation::setFollowing(bool following)
+    {
+        m_following = following;
+
+        if(m_following) {
+            if(!m_file->isOpen()) {
+                if(!m_file->open(QIODevice::ReadOnly)) {
+                    m_following = false;
+                    return;
+                }
+                m_file->seek(m_position);
+            }
+
+            // The data of the last plot may have been truncated
+            if(!m_plots.isEmpty()) {
+                m_plots.last()->complete = false;
+            }
+
+            m_followTimer->start();
+        }
+        else {
+            m_followTimer->stop();
+            if(m_file->isOpen()) {
+                m_position = m_file->pos();
+                m_file->close();
+            }
+        }
+    }
+
+    /*!
+     * \brief Reads the data appended to the file since the last read, and
+     * updates the scene.
+     *
+     * \sa setFollowing()
+     */
+    void FormatRawSimulation::update()
+    {
+        if(parseFile()) {
+            chartScene()->updateItems();
+        }
+    }
+
     /*!
      * \brief Parse the raw file
      *
-     * Parse the raw file. First check the header of the file and then call
-     * the parseAsciiData() or parseBinaryData() method depending on the
-     * type of file.
+     * Parse the raw file, from the position where the last call left off.
+     * First finish reading the data of the last plot, if it was not complete
+     * yet (while following the file). Then read the header of each of the
+     * following plots (op, tran, ac, sweeps, etc) and call the
+     * parseAsciiData() or parseBinaryData() method depending on the type of
+     * file.
      *
-     * \sa parseAsciiData(), parseBinaryData()
+     * The header is read directly from the file (instead of using a
+     * QTextStream) to know the exact offset where the binary data starts.
      *
-     * \todo There can be more than one plot set. This should be considered.
+     * \return True if any new data was read, false otherwise.
+     *
+     * \sa parseAsciiData(), parseBinaryData()
      */
-    void FormatRawSimulation::parseFile(QTextStream *file)
+    bool FormatRawSimulation::parseFile()
     {
-        int nvars = 0;     // Number of variables
-        int npoints = 0;   // Number of points in the simulation
-        bool real = true;  // Transient/AC simulation: real = transient / false = ac (complex numbers)
+        bool changed = false;
+
+        // Continue reading the data of the last plot
+        if(!m_plots.isEmpty() && !m_plots.last()->complete) {
+            RawPlot *plot = m_plots.last();
+            int pointsRead = plot->pointsRead;
+
+            if(plot->binary) {
+                parseBinaryData(plot);
+            }
+            else {
+                parseAsciiData(plot);
+            }
+
+            changed = (plot->pointsRead != pointsRead);
+            if(!plot->complete) {
+                return changed;
+            }
+        }
+
+        RawPlot *plot = 0;    // Plot whose header is being read
+        qint64 plotStart = 0; // Offset of the header of the plot
+
+        // Discard any buffered data, as the file may have grown since the
+        // last read.
+        m_file->seek(m_file->pos());
 
-        QString line = file->readLine();
+        while(!m_file->atEnd()) {
+
+            qint64 lineStart = m_file->pos();
+            QByteArray bytes = m_file->readLine();
+
+            // The line may still be being written
+            if(m_following && !bytes.endsWith('\n')) {
+                m_file->seek(lineStart);
+                break;
+            }
 
-        while(!line.isNull()) {
+            QString line = QString::fromLocal8Bit(bytes).trimmed();
+            if(line.isEmpty()) {
+                continue;
+            }
 
             line = line.toLower();  // Don't care the case of the entry
             QStringList tok = line.split(":");
             QString keyword = tok.at(0);
 
-            // Ignore the following keywords: title, date, plotname
-            if( keyword == "flags" ) {
-                if(tok.at(1) == " real") {
-                    real = true;
+            // The title is the first entry of each plot
+            if(keyword == "title" || !plot) {
+                plot = new RawPlot;
+                plotStart = lineStart;
+                m_plots.append(plot);
+            }
+
+            // Ignore the following keywords: title, date
+            if( keyword == "plotname" ) {
+                plot->name = QString::fromLocal8Bit(bytes).section(':', 1).trimmed();
+            }
+            else if( keyword == "flags" ) {
+                if(tok.at(1).contains("real")) {
+                    plot->real = true;
                 }
-                else if(tok.at(1) == " complex") {
-                    real = false;
+                else if(tok.at(1).contains("complex")) {
+                    plot->real = false;
                 }
                 else {
                     qDebug() << "Warning: unknown flag: " + tok.at(1);
                 }
             }
             else if( keyword == "no. variables") {
-                nvars = tok.at(1).toInt();
+                plot->nvars = tok.at(1).toInt();
             }
             else if( keyword == "no. points") {
-                npoints = tok.at(1).toInt();
+                plot->npoints = tok.at(1).toInt();
             }
             else if( keyword == "variables") {
+                if(!parseVariables(plot)) {
+                    break;  // The list of variables is not complete yet
+                }
+            }
+            else if( keyword == "values" || keyword == "binary" ) {
+                addCurves(plot);
 
-                for(int i = 0; i < nvars; i++) {
-                    line = file->readLine();
-
-                    tok = line.split("\t", QString::SkipEmptyParts);
-                    if(tok.size() >= 3){
-                        // Number property not used: number = tok.at(0)
+                // Read the data itself
+                plot->binary = (keyword == "binary");
+                plot->dataOffset = m_file->pos();
+                plot->resumeOffset = plot->dataOffset;
 
-                        // Create a new curve, and add it to the list
-                        if(real) {
-                            // If dealing with real numbers, create an array only for the magnitude and use the provided curve types
-                            ChartSeries *curve = new ChartSeries(tok.at(1));  // tok.at(1) = name
-                            curve->setType(tok.at(2));  // tok.at(2) = type of curve (voltage, current, etc)
-                            plotCurves.append(curve);   // Append new curve to the list
-                        }
-                        else {
-                            // If dealing with complex numbers, create an array for the magnitude and another one for the phase
-                            ChartSeries *curve = new ChartSeries("Mag(" + tok.at(1) + ")");       // tok.at(1) = name
-                            ChartSeries *curvePhase = new ChartSeries("Phase(" + tok.at(1) + ")");  // tok.at(1) = name
-                            curve->setType("magnitude");         // type of curve (magnitude, phase, etc)
-                            curvePhase->setType("phase");        // type of curve (magnitude, phase, etc)
-                            plotCurves.append(curve);            // Append new curve to the list
-                            plotCurvesPhase.append(curvePhase);  // Append new curve to the list
-                        }
+                if(plot->binary) {
+                    parseBinaryData(plot);
+                }
+                else {
+                    parseAsciiData(plot);
+                }
 
-                    }
-                    else {
-                        qDebug() << "List of variables too short.";
-                    }
+                changed = true;
+                if(!plot->complete) {
+                    break;
                 }
+
+                plot = 0;  // The next line starts a new plot
             }
-            else if( keyword == "values" ) {
-                parseAsciiData(file, nvars, npoints, real);  // Read the data itself
-            }
-            else if( keyword == "binary") {
-                parseBinaryData(file, nvars, npoints, real);  // Read the data itself
-            }
+        }
 
-            // Read the next line
-            line = file->readLine();
+        // Drop the header of a plot whose data was not reached yet. While
+        // following, it will be read again from the start on the next call.
+        if(plot && plot->dataOffset == 0) {
+            qDeleteAll(plot->curves);
+            qDeleteAll(plot->curvesPhase);
+            m_plots.removeAll(plot);
+            delete plot;
+
+            m_file->seek(plotStart);
         }
+
+        return changed;
     }
 
     /*!
-     * \brief Read the data in Ascii format implementation
+     * \brief Read the list of variables of \a plot, creating its curves.
      *
-     * Read the data in Ascii format implementation. Here we use a QTextStream
-     * object to serially read text data from the file. QTextStream assumes
-     * text data and "translates it" to text using the default codec (utf-8,
-     * iso-8859-1, etc), and interpreting special characters as for example
-     * newlines.
+     * \return False if the list of variables was not complete, true
+     * otherwise.
      *
-     * \sa parseBinaryData(), parseFile()
+     * \sa addCurves()
      */
-    void FormatRawSimulation::parseAsciiData(QTextStream *file, const int nvars, const int npoints, const bool real)
+    bool FormatRawSimulation::parseVariables(RawPlot *plot)
     {
-        // Create the arrays to deal with the data
-        QList<double*> dataSamples;               // List of curve's magnitude data. Once filled, used to set data in plotCurves.
-        QList<double*> dataSamplesPhase;          // List of curve's phase data. Used for complex numbers. Once filled, used to set data in plotCurves.
+        QList<QStringList> variables;
+
+        for(int i = 0; i < plot->nvars; i++) {
+            QByteArray bytes = m_file->readLine();
+            if(m_following && !bytes.endsWith('\n')) {
+                return false;
+            }
+
+            QString line = QString::fromLocal8Bit(bytes).trimmed();
+            variables.append(line.split("\t", QString::SkipEmptyParts));
+        }
+
+        foreach(const QStringList &tok, variables) {
+            if(tok.size() >= 3){
+                // Number property not used: number = tok.at(0)
+
+                // Create a new curve, and add it to the list
+                if(plot->real) {
+                    // If dealing with real numbers, create an array only for the magnitude and use the provided curve types
+                    ChartSeries *curve = new ChartSeries(tok.at(1));  // tok.at(1) = name
+                    curve->setType(tok.at(2));  // tok.at(2) = type of curve (voltage, current, etc)
+                    plot->curves.append(curve);   // Append new curve to the list
+                }
+                else {
+                    // If dealing with complex numbers, create an array for the magnitude and another one for the phase
+                    ChartSeries *curve = new ChartSeries("Mag(" + tok.at(1) + ")");       // tok.at(1) = name
+                    ChartSeries *curvePhase = new ChartSeries("Phase(" + tok.at(1) + ")");  // tok.at(1) = name
+                    curve->setType("magnitude");         // type of curve (magnitude, phase, etc)
+                    curvePhase->setType("phase");        // type of curve (magnitude, phase, etc)
+                    plot->curves.append(curve);            // Append new curve to the list
+                    plot->curvesPhase.append(curvePhase);  // Append new curve to the list
+                }
 
-        for(int i = 0; i < nvars; i++) {
-            if(real) {
-                // If dealing with real numbers, create an array only for the magnitude and use the provided curve types
-                double *data = new double[npoints];  // Create new dataset
-                dataSamples.append(data);  // Append new data set to the list
             }
             else {
-                // If dealing with complex numbers, create an array for the magnitude and another one for the phase
-                double *data = new double[npoints];  // Create new dataset
-                double *dataPhase = new double[npoints];  // Create new dataset
-                dataSamples.append(data);  // Append new data set to the list
-                dataSamplesPhase.append(dataPhase);  // Append new data set to the list
+                qDebug() << "List of variables too short.";
+                return true;
             }
         }
 
-        // Read the data
-        if(real) {
-            // The data is of type real
-            for(int i = 0; i < npoints; i++){
-                for(int j = 0; j < nvars; j++){
-                    QString line = file->readLine();
-                    dataSamples[j][i] = line.split("\t").last().toDouble();
+        return true;
+    }
+
+    /*!
+     * \brief Add the curves of \a plot to the scene.
+     *
+     * If the raw file has more than one plot, the index of the plot is added
+     * to the names of the curves, to be able to tell them apart.
+     */
+    void FormatRawSimulation::addCurves(RawPlot *plot)
+    {
+        // Name the curves after their plot, once there is more than one
+        if(m_plots.size() > 1) {
+            int first = (m_plots.size() == 2) ? 0 : m_plots.size() - 1;
+            for(int i = first; i < m_plots.size(); i++) {
+                QList<ChartSeries*> curves = m_plots.at(i)->curves + m_plots.at(i)->curvesPhase;
+                foreach(ChartSeries *curve, curves) {
+                    curve->setTitle(QString("%1 [%2]").arg(curve->title().text()).arg(i + 1));
                 }
             }
+        }
 
-            // Avoid the first var, as it is the time base for the rest
-            // of the curves.
-            for(int i = 1; i < nvars; i++){
-                // Copy the data into the curves
-                plotCurves[i]->setSamples(dataSamples[0], dataSamples[i], npoints);
-                // Add the curve to the scene
-                chartScene()->addItem(plotCurves[i]);
+        // Avoid the first var, as it is the time/frequency base for the
+        // rest of the curves.
+        for(int i = 1; i < plot->curves.size(); i++) {
+            chartScene()->addItem(plot->curves[i]);
+            if(!plot->real) {
+                chartScene()->addItem(plot->curvesPhase[i]);
             }
         }
-        else {
-            // The data is of type complex
-            double real = 0;
-            double imaginary = 0;
-            double magnitude = 0;
-            double phase = 0;
-
-            // Read the data values, converting the complex data into
-            // magnitude and phase data.
-            for(int i = 0; i < npoints; i++){
-                for(int j = 0; j < nvars; j++){
-                    QString line = file->readLine();
-                    QStringList tok = line.split("\t");
-                    line = tok.last();  // Get the complex numeric data
-                    tok = line.split(",");  // Split real and imaginary part
-
-                    real = tok.first().toDouble();  // Get the real part
-                    imaginary = tok.last().toDouble();  // Get the imaginary part
-
-                    magnitude = qSqrt(real*real + imaginary*imaginary);  // Calculate the magnitude part
-                    phase = qAtan(imaginary/real) * 180/M_PI;  // Calculate the phase part
-
-                    dataSamples[j][i] = magnitude;
-                    dataSamplesPhase[j][i] = phase;
+    }
+
+    /*!
+     * \brief Read the data in Ascii format implementation
+     *
+     * Read the data in Ascii format implementation. The values are read by a
+     * RawAsciiReader, which parses the numbers directly from a byte buffer
+     * without any per value allocation, and appended to one array per curve.
+     * The arrays are shared with the curves through ChartSeriesArray, so the
+     * time (or frequency) base is stored only once for all the curves, and
+     * appending the values of a follow update never copies the arrays.
+     *
+     * Reading stops at the end of the data of the plot (the number of points
+     * of the plot was reached, or the header of the next plot was found). If
+     * the end of the file is found before and the file is being followed,
+     * the plot is left incomplete and reading continues from the last
+     * complete point on the next call.
+     *
+     * \sa parseBinaryData(), parseFile(), RawAsciiReader
+     */
+    void FormatRawSimulation::parseAsciiData(RawPlot *plot)
+    {
+        const int nvars = plot->nvars;
+
+        if(plot->samples.isEmpty()) {
+            for(int j = 0; j < nvars; j++) {
+                plot->samples << ChartSeriesArray::Values(new QVector<double>);
+                if(!plot->real) {
+                    plot->samplesPhase << ChartSeriesArray::Values(new QVector<double>);
                 }
             }
+        }
 
-            // Convert the magnitude values into dB ( dB = 20*log10(V) ).
-            // Avoid the first var (var=0), as it is the frequency base
-            // for the rest of the curves.
-            for(int i = 0; i < npoints; i++){
-                for(int j = 1; j < nvars; j++){
-                    dataSamples[j][i] = 20*log10(dataSamples[j][i]);
+        m_file->seek(plot->resumeOffset);
+        RawAsciiReader reader(m_file, m_following);
+
+        // The number of points of the header may not be updated yet (while
+        // the simulator is still writing the file). In that case read until
+        // the next plot or the end of the file.
+        int npoints = (plot->npoints > 0) ? plot->npoints : INT_MAX;
+
+        QVector<double> values(nvars);
+        QVector<double> phases(nvars);
+
+        const bool appended = (plot->pointsRead > 0);  // Keep the levels of detail of the curves
+
+        while(plot->pointsRead < npoints) {
+            bool ok = true;
+
+            // Read the values of one point
+            if(plot->real) {
+                for(int j = 0; j < nvars && ok; j++){
+                    ok = reader.readValue(&values[j]);
+                }
+            }
+            else {
+                // Read the data values, converting the complex data into
+                // magnitude and phase data.
+                double real = 0;
+                double imaginary = 0;
+
+                for(int j = 0; j < nvars && ok; j++){
+                    ok = reader.readValue(&real, &imaginary);
+
+                    double magnitude = qSqrt(real*real + imaginary*imaginary);  // Calculate the magnitude part
+                    phases[j] = qAtan(imaginary/real) * 180/M_PI;  // Calculate the phase part
+
+                    // Convert the magnitude values into dB ( dB = 20*log10(V) ).
+                    // Avoid the first var (var=0), as it is the frequency base
+                    // for the rest of the curves.
+                    values[j] = (j == 0) ? magnitude : 20*log10(magnitude);
                 }
             }
 
-            // Avoid the first var, as it is the frequency base for the
-            // rest of the curves.
-            for(int i = 1; i < nvars; i++){
-                // Copy the data into the curves
-                plotCurves[i]->setSamples(dataSamples[0], dataSamples[i], npoints);
-                plotCurvesPhase[i]->setSamples(dataSamples[0], dataSamplesPhase[i], npoints);
-                // Add the curve to the scene
-                chartScene()->addItem(plotCurves[i]);
-                chartScene()->addItem(plotCurvesPhase[i]);
+            if(!ok) {
+                break;
+            }
+
+            for(int j = 0; j < nvars; j++) {
+                plot->samples[j]->append(values[j]);
+                if(!plot->real) {
+                    plot->samplesPhase[j]->append(phases[j]);
+                }
+            }
+
+            plot->pointsRead++;
+            plot->resumeOffset = reader.pos();  // Continue after the last complete point
+        }
+
+        // The plot is complete once all its points were read, or the next
+        // plot was found. Otherwise, only if the file is not being followed.
+        plot->complete = (plot->pointsRead >= npoints) || reader.atHeader() || !m_following;
+        if(plot->complete && plot->npoints > 0 && plot->pointsRead < plot->npoints) {
+            qDebug() << "Warning: raw file truncated, only" << plot->pointsRead << "of" << plot->npoints << "points available.";
+        }
+
+        // Avoid the first var, as it is the time/frequency base for the
+        // rest of the curves.
+        for(int i = 1; i < plot->curves.size() && i < nvars; i++){
+            // Share the data with the curves
+            plot->curves[i]->setSeriesData(new ChartSeriesArray(plot->samples[0], plot->samples[i]), appended);
+            if(!plot->real) {
+                plot->curvesPhase[i]->setSeriesData(new ChartSeriesArray(plot->samples[0], plot->samplesPhase[i]), appended);
             }
         }
 
-        // Delete the temporal data arrays
-        qDeleteAll(dataSamples);
-        qDeleteAll(dataSamplesPhase);
+        // Leave the file right after the last complete point
+        m_file->seek(plot->resumeOffset);
     }
 
     /*!
      * \brief Read the data in Binary format implementation
      *
-     * Read the data in Binary format implementation. Here we must use a
-     * QDataStream object to serially read raw data from the file. We cannot
-     * use a QTextStream object as it assumes text data and "translates it"
-     * to text using the default codec (utf-8, iso-8859-1, etc). The data to
-     * be read from the file is composed by float numbers of 64 bit precision,
-     * little endian format.
+     * Read the data in Binary format implementation. The data to be read from
+     * the file is composed by float numbers of 64 bit precision, little endian
+     * format, stored as one record per point with the values of all the
+     * variables.
+     *
+     * Instead of reading and copying the data, the data block is memory
+     * mapped and each curve is given a ChartSeriesData view into the mapping.
+     * In this way, opening a raw file is almost instantaneous and uses only
+     * the operating system page cache, regardless of the file size.
+     *
+     * While following the file, each call maps the complete records written
+     * so far. The previous mappings are released once no curve uses them.
      *
-     * \sa parseAsciiData(), parseFile()
+     * \sa parseAsciiData(), parseFile(), ChartSeriesData
      */
-    void FormatRawSimulation::parseBinaryData(QTextStream *file, const int nvars, const int npoints, const bool real)
+    void FormatRawSimulation::parseBinaryData(RawPlot *plot)
     {
-        // Create the arrays to deal with the data
-        QList<double*> dataSamples;               // List of curve's magnitude data. Once filled, used to set data in plotCurves.
-        QList<double*> dataSamplesPhase;          // List of curve's phase data. Used for complex numbers. Once filled, used to set data in plotCurves.
+        const int nvars = plot->nvars;
+        qint64 recordSize = qint64(nvars) * (plot->real ? 1 : 2) * sizeof(double);
+
+        if(recordSize <= 0) {
+            plot->complete = true;
+            return;
+        }
+
+        // The simulator may still be writing the file, or the file may be
+        // truncated. Use only the complete records available.
+        qint64 available = qMax(qint64(0), (m_file->size() - plot->dataOffset) / recordSize);
+        qint64 npoints = available;
+
+        if(plot->npoints > 0 && (available >= plot->npoints || !m_following)) {
+            npoints = qMin(available, qint64(plot->npoints));
+            plot->complete = true;
 
-        for(int i = 0; i < nvars; i++) {
-            if(real) {
-                // If dealing with real numbers, create an array only for the magnitude and use the provided curve types
-                double *data = new double[npoints];  // Create new dataset
-                dataSamples.append(data);  // Append new data set to the list
+            if(available < plot->npoints) {
+                qDebug() << "Warning: raw file truncated, only" << available << "of" << plot->npoints << "points available.";
+            }
+        }
+        else {
+            // The number of points of the header may not be updated yet
+            // (while the simulator is still writing the file), so the data
+            // is considered to extend until the next plot, or the end of the
+            // file.
+            qint64 nextPlot = findNextPlot(plot, recordSize, available);
+            if(nextPlot >= 0) {
+                npoints = nextPlot;
+                plot->complete = true;
             }
             else {
-                // If dealing with complex numbers, create an array for the magnitude and another one for the phase
-                double *data = new double[npoints];  // Create new dataset
-                double *dataPhase = new double[npoints];  // Create new dataset
-                dataSamples.append(data);  // Append new data set to the list
-                dataSamplesPhase.append(dataPhase);  // Append new data set to the list
-            }
-        }
-
-        // Construct a QDataStream object to serially read raw data.
-        // We cannot use QTextStream as it is locale aware, and will
-        // automatically decode the input using a codec.
-        QIODevice *device = file->device();
-        device->seek(file->pos());  // Seek the previous file position (where the QTextStream left off).
-
-        QDataStream out(device);  // Construct a QDataStream object to serially read raw data
-        out.setByteOrder(QDataStream::LittleEndian);  // Use little endian format.
-        out.setFloatingPointPrecision(QDataStream::DoublePrecision);  // Use 64 bit precision (this shouldn't be neccessary as it is the default).
-
-        // Read the data
-        if(real) {
-            // The data is of type real
-            for(int i = 0; i < npoints; i++){
-                for(int j = 0; j < nvars; j++){
-                    out >> dataSamples[j][i];
-                }
+                plot->complete = !m_following;
+            }
+        }
+
+        if(npoints > plot->pointsRead) {
+            // Use a new file object for each mapping, so that the mapping is
+            // released together with the last curve using it.
+            QSharedPointer<QFile> file(new QFile(m_file->fileName()));
+            const uchar *data = 0;
+            if(file->open(QIODevice::ReadOnly)) {
+                data = file->map(plot->dataOffset, npoints * recordSize);
+                file->close();  // Closing the file does not unmap the data
+            }
+
+            if(!data) {
+                qWarning() << "Cannot map raw data:" << file->errorString();
+                plot->complete = true;
+                return;
             }
 
+            // The new mapping holds the records already read, followed by
+            // the new ones, so the levels of detail of the curves are kept.
+            const bool appended = (plot->pointsRead > 0);
+
             // Avoid the first var, as it is the time/frequency base
             // for the rest of the curves.
-            for(int i = 1; i < nvars; i++){
-                // Copy the data into the curves
-                plotCurves[i]->setSamples(dataSamples[0], dataSamples[i], npoints);
-                // Add the curve to the scene
-                chartScene()->addItem(plotCurves[i]);
+            for(int i = 1; i < plot->curves.size() && i < nvars; i++){
+                if(plot->real) {
+                    plot->curves[i]->setSeriesData(new ChartSeriesData(file, data, npoints, nvars, i, ChartSeriesData::Real), appended);
+                }
+                else {
+                    plot->curves[i]->setSeriesData(new ChartSeriesData(file, data, npoints, nvars, i, ChartSeriesData::Magnitude), appended);
+                    plot->curvesPhase[i]->setSeriesData(new ChartSeriesData(file, data, npoints, nvars, i, ChartSeriesData::Phase), appended);
+                }
             }
+
+            plot->pointsRead = npoints;
         }
-        else {
-            // The data is of type complex
-            double real = 0;
-            double imaginary = 0;
-            double magnitude = 0;
-            double phase = 0;
-
-            // Read the data values, converting the complex data into
-            // magnitude and phase data.
-            for(int i = 0; i < npoints; i++){
-                for(int j = 0; j < nvars; j++){
-                    out >> real;  // Get the real part
-                    out >> imaginary;  // Get the imaginary part
-
-                    magnitude = qSqrt(real*real + imaginary*imaginary);  // Calculate the magnitude part
-                    phase = qAtan(imaginary/real) * 180/M_PI;  // Calculate the phase part
-
-                    dataSamples[j][i] = magnitude;
-                    dataSamplesPhase[j][i] = phase;
-                }
+
+        // Skip the data block, leaving the file ready to read the next plot
+        plot->resumeOffset = plot->dataOffset + plot->pointsRead * recordSize;
+        m_file->seek(plot->resumeOffset);
+    }
+
+    /*!
+     * \brief Searches the header of the plot following the binary data of
+     * \a plot.
+     *
+     * The header of the next plot starts right after the last record, with
+     * a "Title:" or "Plotname:" line. Only the records after those already
+     * read are searched, and only at record boundaries, so data values are
+     * very unlikely to be mistaken for a header.
+     *
+     * \return The number of records of \a plot before the next header, or
+     * -1 if there is no header in the \a available records.
+     *
+     * \sa parseBinaryData()
+     */
+    qint64 FormatRawSimulation::findNextPlot(const RawPlot *plot, qint64 recordSize,
+                                             qint64 available)
+    {
+        const qint64 chunkRecords = qMax(qint64(1), qint64(1 << 20) / recordSize);
+
+        qint64 record = plot->pointsRead;
+        m_file->seek(plot->dataOffset + record * recordSize);
+
+        while(record < available) {
+            qint64 count = qMin(chunkRecords, available - record);
+            QByteArray chunk = m_file->read(count * recordSize);
+            if(chunk.size() < count * recordSize) {
+                break;
             }
 
-            // Convert the magnitude values into dB ( dB = 20*log10(V) ).
-            // Avoid the first var (var=0), as it is the frequency base
-            // for the rest of the curves.
-            for(int i = 0; i < npoints; i++){
-                for(int j = 1; j < nvars; j++){
-                    dataSamples[j][i] = 20*log10(dataSamples[j][i]);
+            for(qint64 i = 0; i < count; ++i) {
+                const char *start = chunk.constData() + i * recordSize;
+                if(qstrnicmp(start, "title:", 6) == 0 ||
+                        (recordSize >= 9 && qstrnicmp(start, "plotname:", 9) == 0)) {
+                    return record + i;
                 }
             }
 
-            // Avoid the first var, as it is the time/frequency base
-            // for the rest of the curves.
-            for(int i = 1; i < nvars; i++){
-                // Copy the data into the curves
-                plotCurves[i]->setSamples(dataSamples[0], dataSamples[i], npoints);
-                plotCurvesPhase[i]->setSamples(dataSamples[0], dataSamplesPhase[i], npoints);
-                // Add the curve to the scene
-                chartScene()->addItem(plotCurves[i]);
-                chartScene()->addItem(plotCurvesPhase[i]);
-            }
+            record += count;
         }
 
-        // Delete the temporal data arrays
-        qDeleteAll(dataSamples);
-        qDeleteAll(dataSamplesPhase);
+        return -1;
     }
 
     ChartScene* FormatRawSimulation::chartScene() const
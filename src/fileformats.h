@@ -23,8 +23,17 @@
 
 #include "component.h"
 
+#include <QByteArray>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
 // Forward declarations
+class QFile;
+class QIODevice;
 class QString;
+class QTimer;
 
 namespace Caneda
 {
@@ -32,6 +41,7 @@ namespace Caneda
     class GraphicsScene;
     class ChartSeries;
     class ChartScene;
+    class IDocument;
     class LayoutDocument;
     class SchematicDocument;
     class SimulationDocument;
@@ -39,7 +49,8 @@ namespace Caneda
     class XmlReader;
     class XmlWriter;
 
-    typedef QList<QPair<Port *, QString> > PortsNetlist;
+    //! \brief Map from each port to the name of the net it belongs to.
+    typedef QHash<Port*, QString> PortsNetlist;
 
     /*!
      * \brief This class handles all the access to the schematic documents file
@@ -63,13 +74,13 @@ namespace Caneda
         bool load() const;
 
     private:
-        QString saveText() const;
+        bool saveToDevice(QIODevice *device) const;
         void saveComponents(Caneda::XmlWriter *writer) const;
         void savePorts(Caneda::XmlWriter *writer) const;
         void saveWires(Caneda::XmlWriter *writer) const;
         void savePaintings(Caneda::XmlWriter *writer) const;
 
-        bool loadFromText(const QString &text) const;
+        bool loadFromDevice(QIODevice *device) const;
         void loadComponents(Caneda::XmlReader *reader) const;
         void loadPorts(Caneda::XmlReader *reader) const;
         void loadWires(Caneda::XmlReader *reader) const;
@@ -103,19 +114,23 @@ namespace Caneda
         bool save() const;
         bool load() const;
 
+        void loadComponentSymbol() const;
+
     private:
-        QString saveText() const;
+        bool saveToDevice(QIODevice *device) const;
         void saveSymbol(Caneda::XmlWriter *writer) const;
         void savePorts(Caneda::XmlWriter *writer) const;
         void saveProperties(Caneda::XmlWriter *writer) const;
         void saveModels(Caneda::XmlWriter *writer) const;
 
-        bool loadFromText(const QString &text) const;
+        bool loadFromDevice(QIODevice *device) const;
         void loadSymbol(Caneda::XmlReader *reader) const;
         void loadPorts(Caneda::XmlReader *reader) const;
         void loadProperties(Caneda::XmlReader *reader) const;
         void loadModels(Caneda::XmlReader *reader) const;
 
+        static QString readElementXml(Caneda::XmlReader *reader);
+
         GraphicsScene* graphicsScene() const;
         ComponentData* component() const;
         QString fileName() const;
@@ -147,10 +162,10 @@ namespace Caneda
         bool load() const;
 
     private:
-        QString saveText() const;
+        bool saveToDevice(QIODevice *device) const;
         void savePaintings(Caneda::XmlWriter *writer) const;
 
-        bool loadFromText(const QString &text) const;
+        bool loadFromDevice(QIODevice *device) const;
         void loadPaintings(Caneda::XmlReader *reader) const;
 
         GraphicsScene* graphicsScene() const;
@@ -159,6 +174,125 @@ namespace Caneda
         LayoutDocument *m_layoutDocument;
     };
 
+    /*!
+     * \brief This class handles the binary format of schematic, symbol and
+     * layout documents.
+     *
+     * The binary format is a fast working format for large (typically
+     * generated) designs, holding the same data as the xml formats. Files in
+     * one format may be opened and saved in the other one without loss.
+     *
+     * A binary file starts with a header and a section table, followed by
+     * the data of each section. Each entry of the section table holds the
+     * offset and size of its section, so readers may load only the sections
+     * they need, skipping the rest.
+     *
+     * Strings repeated across the document (component, library and property
+     * names, common property values, etc) are stored only once in the
+     * strings section, and referenced by their index from the other
+     * sections. Components, properties, ports and wires are then stored as
+     * fixed width records of numbers, read with QDataStream without any text
+     * parsing. Paintings, which are few and of many different types, are
+     * stored as xml fragments written by GraphicsItem::saveData().
+     *
+     * The same encoding is used to copy items to the clipboard, through
+     * saveItems() and loadItems().
+     *
+     * \sa FormatXmlSchematic, FormatXmlSymbol, FormatXmlLayout,
+     * \ref DocumentFormats
+     */
+    class FormatBinary : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        //! \brief Sections of a binary document.
+        enum Section {
+            StringsSection    = 0x01,  // Interned strings
+            ComponentsSection = 0x02,  // Component records
+            PropertiesSection = 0x04,  // Component property records
+            PortsSection      = 0x08,  // Port symbol records
+            WiresSection      = 0x10,  // Wire records
+            PaintingsSection  = 0x20,  // Paintings, as xml fragments
+            SymbolSection     = 0x40,  // Symbol property records
+            AllSections       = 0xff
+        };
+
+        explicit FormatBinary(SchematicDocument *document);
+        explicit FormatBinary(SymbolDocument *document);
+        explicit FormatBinary(LayoutDocument *document);
+
+        bool save() const;
+        bool load(int sections = AllSections) const;
+
+        static QByteArray saveItems(const QList<GraphicsItem*> &items);
+        static QList<GraphicsItem*> loadItems(const QByteArray &data);
+
+    private:
+        FormatBinary();
+
+        enum {
+            //! Magic number identifying binary documents ("CBIN").
+            Magic = 0x4342494e,
+            //! Version of the binary format, to be increased on every change.
+            Version = 1
+        };
+
+        //! \brief Type of the document stored in a binary file.
+        enum DocumentType {
+            SchematicType = 1,
+            SymbolType,
+            LayoutType,
+            ItemsType  // Items copied to the clipboard
+        };
+
+        //! \brief Entry of the section table.
+        struct SectionEntry
+        {
+            quint32 section;
+            qint64 offset;
+            qint64 size;
+            quint32 count;
+        };
+
+        //! \brief Interned strings of a document.
+        class StringTable
+        {
+        public:
+            quint32 intern(const QString &string);
+            QString at(quint32 index) const;
+
+            QStringList strings;
+            QHash<QString, quint32> indexes;
+        };
+
+        bool write(QIODevice *device, QList<QGraphicsItem*> &items) const;
+        bool read(QIODevice *device, int sections, QList<GraphicsItem*> *items) const;
+
+        QByteArray saveComponents(QList<QGraphicsItem*> &items, StringTable *strings,
+                                  quint32 *count, QByteArray *properties) const;
+        QByteArray savePorts(QList<QGraphicsItem*> &items, StringTable *strings,
+                             quint32 *count) const;
+        QByteArray saveWires(QList<QGraphicsItem*> &items, quint32 *count) const;
+        QByteArray savePaintings(QList<QGraphicsItem*> &items, quint32 *count) const;
+        QByteArray saveSymbol(StringTable *strings, quint32 *count) const;
+
+        bool loadComponents(const QByteArray &data, quint32 count, const QByteArray &properties,
+                            const StringTable &strings, QList<GraphicsItem*> *items) const;
+        bool loadPorts(const QByteArray &data, quint32 count, const StringTable &strings,
+                       QList<GraphicsItem*> *items) const;
+        bool loadWires(const QByteArray &data, quint32 count, QList<GraphicsItem*> *items) const;
+        bool loadPaintings(const QByteArray &data, quint32 count, QList<GraphicsItem*> *items) const;
+        bool loadSymbol(const QByteArray &data, quint32 count, const StringTable &strings) const;
+
+        GraphicsScene* graphicsScene() const { return m_graphicsScene; }
+        QString fileName() const;
+
+        IDocument *m_document;
+        GraphicsScene *m_graphicsScene;
+        DocumentType m_documentType;
+    };
+
     /*!
      * \brief This class handles all the access to the raw spice simulation
      * documents file format.
@@ -185,13 +319,65 @@ namespace Caneda
 
     private:
         QString generateNetlist();
+        void appendModel(const ModelTemplate &model, int begin, int end,
+                         Component *component, QString *output);
         PortsNetlist generateNetlistTopology();
-        void replacePortNames(PortsNetlist *netlist);
+        void replacePortNames(const QHash<Port*, int> &netIds, QVector<QString> *netNames);
 
         GraphicsScene* graphicsScene() const;
         QString fileName() const;
 
         SchematicDocument *m_schematicDocument;
+
+        PortsNetlist m_netlist;  // Net names of the ports being exported
+        QString m_filePath;  // Directory of the schematic being exported
+        QStringList m_models;  // Device models to add at the end of the netlist
+        QStringList m_subcircuits;  // Subcircuits to add at the end of the netlist
+        QStringList m_directives;  // Directives to add at the end of the netlist
+        QStringList m_schematics;  // Schematics whose netlists must also be generated
+    };
+
+    /*!
+     * \brief This class reads the values section of ascii raw simulation
+     * files.
+     *
+     * The file is read in big chunks into a byte buffer, and the numbers are
+     * parsed directly from the buffer. This avoids creating QString objects
+     * (and their heap allocations) for every value read, which is otherwise
+     * the dominant cost when loading raw files with millions of samples.
+     *
+     * Each line of the values section holds one value (real, or real and
+     * imaginary parts separated by a comma) as its last tab separated field,
+     * optionally preceded by the point index. Blank lines are skipped, and
+     * reading stops at the first header line (a line starting with a letter,
+     * as the title of the next plot).
+     *
+     * \sa FormatRawSimulation
+     */
+    class RawAsciiReader
+    {
+    public:
+        explicit RawAsciiReader(QIODevice *device, bool completeLinesOnly = false);
+
+        bool readValue(double *real, double *imaginary = 0);
+        qint64 pos() const;
+
+        //! \brief Returns true if reading stopped at a header (non data) line
+        bool atHeader() const { return m_atHeader; }
+
+    private:
+        bool nextLine(const char **begin, const char **end);
+        bool fillBuffer();
+
+        static double parseDouble(const char *begin, const char *end);
+
+        QIODevice *m_device;  //! \brief Device being read
+        QByteArray m_buffer;  //! \brief Chunk of the device being parsed
+        int m_begin;          //! \brief Start of the unparsed data in the buffer
+        int m_end;            //! \brief End of the valid data in the buffer
+
+        bool m_completeLinesOnly;  //! \brief Ignore the last line if it has no terminator
+        bool m_atHeader;           //! \brief Reading stopped at a header line
     };
 
     /*!
@@ -215,20 +401,59 @@ namespace Caneda
 
     public:
         explicit FormatRawSimulation(SimulationDocument *document = 0);
+        ~FormatRawSimulation();
 
         bool load();
 
+        //! \brief Returns true if the file is being followed while it is written
+        bool isFollowing() const { return m_following; }
+        void setFollowing(bool following);
+
+    private Q_SLOTS:
+        void update();
+
     private:
-        void parseFile(QTextStream *file);
-        void parseAsciiData(QTextStream *file, const int nvars, const int npoints, const bool real);
-        void parseBinaryData(QTextStream *file, const int nvars, const int npoints, const bool real);
+        //! \brief Parsing state of one plot (set of waveforms) of the raw file.
+        struct RawPlot
+        {
+            QString name;         // Plot name (Transient Analysis, AC Analysis, etc)
+            int nvars;            // Number of variables
+            int npoints;          // Number of points declared in the header
+            int pointsRead;       // Number of points already read
+            bool real;            // Real (transient, dc) or complex (ac) data
+            qint64 dataOffset;    // Offset in the file where the data starts
+            qint64 resumeOffset;  // Offset in the file where reading continues
+            bool binary;          // Binary or ascii data
+            bool complete;        // True once all the data of the plot was read
+
+            QList<ChartSeries*> curves;       // List of magnitude curves
+            QList<ChartSeries*> curvesPhase;  // List of phase curves
+
+            QVector<QSharedPointer<QVector<double> > > samples;       // Magnitude data of ascii plots
+            QVector<QSharedPointer<QVector<double> > > samplesPhase;  // Phase data of ascii plots
+
+            RawPlot() :
+                nvars(0), npoints(0), pointsRead(0), real(true),
+                dataOffset(0), resumeOffset(0), binary(false), complete(false) {}
+        };
+
+        bool parseFile();
+        bool parseVariables(RawPlot *plot);
+        void addCurves(RawPlot *plot);
+        void parseAsciiData(RawPlot *plot);
+        void parseBinaryData(RawPlot *plot);
+        qint64 findNextPlot(const RawPlot *plot, qint64 recordSize, qint64 available);
 
         ChartScene* chartScene() const;
 
         SimulationDocument *m_simulationDocument;
 
-        QList<ChartSeries*> plotCurves;       // List of magnitude curves.
-        QList<ChartSeries*> plotCurvesPhase;  // List of phase curves.
+        QFile *m_file;           // Raw file being parsed
+        qint64 m_position;       // Position in the file while it is closed
+        QList<RawPlot*> m_plots; // Plots read from the file, in file order
+
+        bool m_following;        // True if the file is being followed
+        QTimer *m_followTimer;   // Timer used to poll the file while following
     };
 
 } // namespace Caneda
@@ -175,12 +175,56 @@ namespace Caneda
      */
     void GraphicsItem::copyDataTo(GraphicsItem *item) const
     {
-        item->setShapeAndBoundRect(m_shape, m_boundingRect);
+        // Use the virtual accessors, as subclasses may keep their own caches.
+        // The cached rect already includes the pen width.
+        item->setShapeAndBoundRect(shape(), boundingRect(), 0.0);
         item->setTransform(transform());
         item->setRotation(rotation());
         item->setPos(pos());
     }
 
+    /*!
+     * \brief Notifies the ports of the item entering, leaving or moving in
+     * the scene.
+     *
+     * Ports are not items of the scene, so they don't receive these
+     * notifications themselves. They are forwarded here to keep the ports
+     * registered in the NetDatabase and SpatialIndex of the scene.
+     *
+     * \sa Port::sceneAboutToChange(), Port::scenePositionChanged()
+     */
+    QVariant GraphicsItem::itemChange(GraphicsItemChange change, const QVariant &value)
+    {
+        if(change == ItemSceneChange) {
+            foreach(Port *port, m_ports) {
+                port->sceneAboutToChange();
+            }
+        }
+        else if(change == ItemSceneHasChanged || change == ItemScenePositionHasChanged) {
+            foreach(Port *port, m_ports) {
+                port->scenePositionChanged();
+            }
+        }
+
+        return QGraphicsItem::itemChange(change, value);
+    }
+
+    /*!
+     * \brief Draws the ports of the item.
+     *
+     * This must be called at the end of the paint() method of items with
+     * ports, as ports are not items of the scene and can't paint themselves.
+     * The bounding rect of the item must include the ports.
+     *
+     * \sa Port::paint()
+     */
+    void GraphicsItem::paintPorts(QPainter *painter) const
+    {
+        foreach(Port *port, m_ports) {
+            port->paint(painter);
+        }
+    }
+
     /*!
      * \brief Constructs and returns a context menu with the actions
      * corresponding to the selected object.
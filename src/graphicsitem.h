@@ -152,9 +152,12 @@ namespace Caneda
         virtual void launchPropertiesDialog() = 0;
 
     protected:
+        QVariant itemChange(GraphicsItemChange change, const QVariant &value);
         void contextMenuEvent(QGraphicsSceneContextMenuEvent *event);
         void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event);
 
+        void paintPorts(QPainter *painter) const;
+
         void setShapeAndBoundRect(const QPainterPath& path,
                 const QRectF& boundingRect,
                 qreal penWidth = 1.0);
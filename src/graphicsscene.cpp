@@ -29,14 +29,17 @@
 #include "idocument.h"
 #include "iview.h"
 #include "library.h"
+#include "netdatabase.h"
 #include "portsymbol.h"
 #include "property.h"
 #include "propertydialog.h"
 #include "settings.h"
+#include "spatialindex.h"
+#include "statehandler.h"
+#include "tiledrenderer.h"
 #include "wire.h"
 #include "xmlutilities.h"
 
-#include <QClipboard>
 #include <QGraphicsSceneEvent>
 #include <QKeySequence>
 #include <QMenu>
@@ -63,11 +66,20 @@ namespace Caneda
         m_properties->setUserPropertiesEnabled(true);
         addItem(m_properties);
 
-        // Setup undo stack
+        // Setup undo stack. See trimUndoHistory() for the limits of the
+        // history.
+        Settings *settings = Settings::instance();
         m_undoStack = new QUndoStack(this);
+        m_undoFloor = 0;
+        m_canUndo = false;
+
+        // Setup ports connections database
+        m_netDatabase = new NetDatabase();
+        m_spatialIndex = new SpatialIndex();
 
         // Setup grid
         m_backgroundVisible = true;
+        m_renderOptions = 0;
 
         m_areItemsMoving = false;
         m_shortcutsBlocked = false;
@@ -79,7 +91,6 @@ namespace Caneda
         m_paintingDrawItem = 0;
         m_paintingDrawClicks = 0;
 
-        Settings *settings = Settings::instance();
         QColor zoomBandColor =
             settings->currentValue("gui/foregroundColor").value<QColor>();
         m_zoomBand = new QGraphicsRectItem();
@@ -92,6 +103,23 @@ namespace Caneda
         m_zoomBandClicks = 0;
 
         connect(undoStack(), SIGNAL(cleanChanged(bool)), this, SIGNAL(changed()));
+        connect(undoStack(), SIGNAL(indexChanged(int)), this, SLOT(trimUndoHistory()));
+    }
+
+    /*!
+     * \brief Destructor.
+     *
+     * The items are deleted here, instead of in the QGraphicsScene destructor,
+     * because their ports must still be able to unregister from the
+     * NetDatabase and SpatialIndex while being destroyed.
+     */
+    GraphicsScene::~GraphicsScene()
+    {
+        // Delete the commands first, as they unregister from this scene
+        delete m_undoStack;
+        clear();
+        delete m_netDatabase;
+        delete m_spatialIndex;
     }
 
     /**********************************************************************
@@ -106,29 +134,10 @@ namespace Caneda
         deleteItems(items);
     }
 
-    //! \brief Copy items
+    //! \brief Copy items \sa StateHandler::copy()
     void GraphicsScene::copyItems(QList<GraphicsItem*> &items)
     {
-        if(items.isEmpty()) {
-            return;
-        }
-
-        QString clipText;
-        Caneda::XmlWriter *writer = new Caneda::XmlWriter(&clipText);
-        writer->setAutoFormatting(true);
-        writer->writeStartDocument();
-        writer->writeDTD(QString("<!DOCTYPE caneda>"));
-        writer->writeStartElement("caneda");
-        writer->writeAttribute("version", Caneda::version());
-
-        foreach(GraphicsItem *item, items) {
-            item->saveData(writer);
-        }
-
-        writer->writeEndDocument();
-
-        QClipboard *clipboard =  QApplication::clipboard();
-        clipboard->setText(clipText);
+        StateHandler::instance()->copy(items);
     }
 
     //! \brief Delete items
@@ -384,6 +393,11 @@ namespace Caneda
      * The device to print the scene on can be a physical printer,
      * a postscript (ps) file or a portable document format (pdf)
      * file.
+     *
+     * The grid is hidden through the render options, so the views of the
+     * scene are not repainted while printing.
+     *
+     * \sa renderArea()
      */
     void GraphicsScene::print(QPrinter *printer, bool fitInView)
     {
@@ -392,13 +406,15 @@ namespace Caneda
 
         const bool fullPage = printer->fullPage();
 
-        const bool viewGridStatus = Settings::instance()->currentValue("gui/gridVisible").value<bool>();
-        Settings::instance()->setCurrentValue("gui/gridVisible", false);
+        RenderOptions options;
+        options.backgroundVisible = isBackgroundVisible();
+        options.gridVisible = false;
 
         const QRectF diagramRect = itemsBoundingRect();
 
         if(fitInView) {
-            render(&p, QRectF(), diagramRect, Qt::KeepAspectRatio);
+            renderArea(&p, QRectF(0, 0, printer->width(), printer->height()),
+                       diagramRect, options);
         }
         else {
             //Printing on one or more pages
@@ -428,18 +444,33 @@ namespace Caneda
 
             for (int i = 0; i < pagesToPrint.size(); ++i) {
                 const QRectF rect = pagesToPrint.at(i);
-                render(&p,
-                       rect.translated(-rect.topLeft()), // dest - topleft at (0, 0)
-                       rect.translated(diagramRect.topLeft()), // src
-                       Qt::KeepAspectRatio);
+                renderArea(&p,
+                           rect.translated(-rect.topLeft()), // dest - topleft at (0, 0)
+                           rect.translated(diagramRect.topLeft()), // src
+                           options);
 
                 if(i != (pagesToPrint.size() - 1)) {
                     printer->newPage();
                 }
             }
         }
+    }
 
-        Settings::instance()->setCurrentValue("gui/gridVisible", viewGridStatus);
+    /*!
+     * \brief Renders the \a source area of the scene into the \a target area
+     * of \a painter, keeping the aspect ratio.
+     *
+     * Unlike QGraphicsScene::render(), the background is drawn according to
+     * \a options instead of the user settings.
+     *
+     * \sa RenderOptions, print()
+     */
+    void GraphicsScene::renderArea(QPainter *painter, const QRectF &target,
+                                   const QRectF &source, const RenderOptions &options)
+    {
+        m_renderOptions = &options;
+        render(painter, target, source, Qt::KeepAspectRatio);
+        m_renderOptions = 0;
     }
 
     /*!
@@ -454,11 +485,18 @@ namespace Caneda
      * the QPaintDevice where the image is to be rendered. This size can be a
      * 1:1 ratio or any other size.
      *
+     * Raster images are rendered by a TiledRenderer, which splits large
+     * images into tiles rendered concurrently.
+     *
+     * The background and grid are given as RenderOptions, so the views of
+     * the scene are not affected by the export.
+     *
      * \param pix QPaintDevice where the image is to be rendered
+     * \param gridVisible True to draw the grid in the image
      * \return bool True on success, false otherwise
-     * \sa ExportDialog, IDocument::exportImage()
+     * \sa ExportDialog, IDocument::exportImage(), TiledRenderer
      */
-    bool GraphicsScene::exportImage(QPaintDevice &pix)
+    bool GraphicsScene::exportImage(QPaintDevice &pix, bool gridVisible)
     {
         // Calculate the source area
         QRectF source_area = itemsBoundingRect();
@@ -473,8 +511,12 @@ namespace Caneda
         QRectF dest_area = QRectF(0, 0, pix.width(), pix.height());
 
         // Prepare the device
+        QImage *image = 0;
         QPainter p;
-        if(!p.begin(&pix)) {
+        if(pix.devType() == QInternal::Image) {
+            image = static_cast<QImage*>(&pix);
+        }
+        else if(!p.begin(&pix)) {
             return(false);
         }
 
@@ -488,10 +530,20 @@ namespace Caneda
         // As the size is specified, there is no need to keep the aspect ratio
         // (it will be kept if the dimensions of the source and destination areas
         // are proportional.
-        setBackgroundVisible(false);
-        render(&p, dest_area, source_area, Qt::IgnoreAspectRatio);
-        setBackgroundVisible(true);
-        p.end();
+        RenderOptions options;
+        options.backgroundVisible = false;
+        options.gridVisible = gridVisible;
+
+        m_renderOptions = &options;
+        if(image) {
+            TiledRenderer renderer(this, source_area, image);
+            renderer.render();
+        }
+        else {
+            render(&p, dest_area, source_area, Qt::IgnoreAspectRatio);
+            p.end();
+        }
+        m_renderOptions = 0;
 
         // Restore the selected items
         foreach(QGraphicsItem *qgi, selected_elmts) {
@@ -676,6 +728,35 @@ namespace Caneda
         }
     }
 
+    /*!
+     * \brief Adds several items to the scene at once, connecting their
+     * coinciding ports.
+     *
+     * This method is meant for adding a large number of items, for example
+     * when loading a document. Adding items one by one updates the scene
+     * index after every insertion, so the index is instead disabled while
+     * adding the items and rebuilt once at the end. Once all items are in
+     * the scene, their coinciding ports are connected in a single pass, each
+     * port being looked up by position in the SpatialIndex.
+     *
+     * \param items: items to add
+     *
+     * \sa connectItems()
+     */
+    void GraphicsScene::addItems(const QList<GraphicsItem*> &items)
+    {
+        ItemIndexMethod indexMethod = itemIndexMethod();
+        setItemIndexMethod(NoIndex);
+        foreach(GraphicsItem *item, items) {
+            addItem(item);
+        }
+        setItemIndexMethod(indexMethod);
+
+        foreach(GraphicsItem *item, items) {
+            connectItems(item);
+        }
+    }
+
     /*!
      * \brief Disconnect an item from any wire or other components
      *
@@ -719,13 +800,12 @@ namespace Caneda
             // List of wires to delete after collision and creation of new wires
             QList<Wire*> markedForDeletion;
 
-            // Detect all colliding items
-            QList<QGraphicsItem*> collisions = port->collidingItems(Qt::IntersectsItemBoundingRect);
+            // Detect all colliding wires
+            QRectF portRect = port->sceneBoundingRect();
+            QList<Wire*> collisions = m_spatialIndex->wires(portRect);
 
-            // Filter colliding wires only
-            foreach(QGraphicsItem *collidingItem, collisions) {
-                Wire* collidingWire = canedaitem_cast<Wire*>(collidingItem);
-                if(collidingWire) {
+            foreach(Wire *collidingWire, collisions) {
+                if(collidingWire->sceneBoundingRect().intersects(portRect)) {
 
                     // If already connected, the collision is the result of the connection,
                     // otherwise there is a potential new node.
@@ -788,6 +868,146 @@ namespace Caneda
         }
     }
 
+    /**********************************************************************
+     *
+     *                            Undo history
+     *
+     **********************************************************************/
+    /*!
+     * \brief Returns true if the last command of the undo stack can be
+     * undone.
+     *
+     * Besides QUndoStack::canUndo(), the history can't be undone past the
+     * undo floor, nor more steps than the "gui/undoLimit" setting.
+     *
+     * \sa undo(), canUndoChanged(), trimUndoHistory()
+     */
+    bool GraphicsScene::canUndo() const
+    {
+        if(!m_undoStack->canUndo()) {
+            return false;
+        }
+
+        int lowest = m_undoFloor ? m_undoFloor->undoIndex() + 1 : 0;
+
+        const int limit = Settings::instance()->currentValue("gui/undoLimit").toInt();
+        if(limit > 0) {
+            lowest = qMax(lowest, m_undoStack->count() - limit);
+        }
+
+        return m_undoStack->index() > lowest;
+    }
+
+    //! \brief Undoes the last command, if allowed by canUndo().
+    void GraphicsScene::undo()
+    {
+        if(canUndo()) {
+            m_undoStack->undo();
+        }
+    }
+
+    /*!
+     * \brief Registers a new remove \a command, called by RemoveItemsCmd.
+     *
+     * Commands are created right before being pushed, so they are
+     * registered in undo stack order.
+     */
+    void GraphicsScene::addRemoveCommand(RemoveItemsCmd *command)
+    {
+        m_removeCommands << command;
+    }
+
+    //! \brief Unregisters a deleted remove \a command, called by RemoveItemsCmd.
+    void GraphicsScene::removeRemoveCommand(RemoveItemsCmd *command)
+    {
+        m_removeCommands.removeOne(command);
+        if(m_undoFloor == command) {
+            m_undoFloor = 0;
+        }
+    }
+
+    /*!
+     * \brief Keeps the memory used by the undo history within the user
+     * settings.
+     *
+     * This is called every time the undo stack index changes. The removed
+     * items kept by remove commands make up most of the memory of the
+     * history, so their estimated size is added up (see
+     * RemoveItemsCmd::cost()). While it exceeds the "gui/undoMemory"
+     * setting, the items of the oldest remove commands are released, and the
+     * history can no longer be undone past them. The items of the commands
+     * past the "gui/undoLimit" setting are released too, as they can't be
+     * undone anymore. Both settings are unlimited by default, and then
+     * nothing is ever released.
+     *
+     * The undo limit is enforced by the scene instead of
+     * QUndoStack::setUndoLimit(), because the stack silently shifts the
+     * indexes of its commands when dropping the oldest ones, and the remove
+     * commands record their index when created.
+     *
+     * \sa canUndo(), RemoveItemsCmd::release()
+     */
+    void GraphicsScene::trimUndoHistory()
+    {
+        Settings *settings = Settings::instance();
+        const int limit = qMax(0, settings->currentValue("gui/undoLimit").toInt());
+        const qint64 budget = qint64(settings->currentValue("gui/undoMemory").toInt()) * 1024 * 1024;
+
+        if(limit == 0 && budget <= 0) {
+            updateCanUndo();
+            return;
+        }
+
+        qint64 cost = 0;
+        if(budget > 0) {
+            foreach(const RemoveItemsCmd *command, m_removeCommands) {
+                cost += command->cost();
+            }
+        }
+
+        const int lowest = limit > 0 ? m_undoStack->count() - limit : 0;
+        // The last command is always kept, to be able to undo it
+        const int newest = m_undoStack->index() - 1;
+
+        RemoveItemsCmd *floor = m_undoFloor;
+        foreach(RemoveItemsCmd *command, m_removeCommands) {
+            if(command->cost() == 0) {
+                continue;
+            }
+
+            const int index = command->undoIndex();
+            if(index >= newest) {
+                break;
+            }
+
+            bool release = index < lowest || (budget > 0 && cost > budget);
+            if(!release) {
+                break;
+            }
+
+            cost -= command->cost();
+            command->release();
+            floor = command;
+        }
+
+        if(floor != m_undoFloor) {
+            m_undoFloor = floor;
+            emit changed();
+        }
+
+        updateCanUndo();
+    }
+
+    //! \brief Emits canUndoChanged() if canUndo() changed since last call.
+    void GraphicsScene::updateCanUndo()
+    {
+        const bool undoable = canUndo();
+        if(undoable != m_canUndo) {
+            m_canUndo = undoable;
+            emit canUndoChanged(m_canUndo);
+        }
+    }
+
     /**********************************************************************
      *
      *               Spice/electric related scene properties
@@ -818,22 +1038,25 @@ namespace Caneda
     void GraphicsScene::drawBackground(QPainter *painter, const QRectF& rect)
     {
         QPen savedpen = painter->pen();
+        const RenderSettings &settings = Settings::instance()->renderSettings();
+
+        // Options of a print or export override the settings of the views
+        const bool backgroundVisible =
+            m_renderOptions ? m_renderOptions->backgroundVisible : isBackgroundVisible();
+        const bool gridVisible =
+            m_renderOptions ? m_renderOptions->gridVisible : settings.gridVisible;
 
         // Disable anti aliasing
         painter->setRenderHint(QPainter::Antialiasing, false);
 
-        if(isBackgroundVisible()) {
-            const QColor backgroundColor =
-                Settings::instance()->currentValue("gui/backgroundColor").value<QColor>();
+        if(backgroundVisible) {
             painter->setPen(Qt::NoPen);
-            painter->setBrush(QBrush(backgroundColor));
+            painter->setBrush(QBrush(settings.backgroundColor));
             painter->drawRect(rect);
         }
 
         // Configure pen
-        const QColor foregroundColor =
-            Settings::instance()->currentValue("gui/foregroundColor").value<QColor>();
-        painter->setPen(QPen(foregroundColor, 0));
+        painter->setPen(QPen(settings.foregroundColor, 0));
         painter->setBrush(Qt::NoBrush);
 
         // Draw origin (if visible in the view)
@@ -843,27 +1066,24 @@ namespace Caneda
         }
 
         // Draw grid
-        if(Settings::instance()->currentValue("gui/gridVisible").value<bool>()) {
+        if(gridVisible) {
 
             int drawingGridWidth = Caneda::DefaultGridSpace;
             int drawingGridHeight = Caneda::DefaultGridSpace;
 
-            //Make grid size display dinamic, depending on zoom level
-            DocumentViewManager *manager = DocumentViewManager::instance();
-            IView *v = manager->currentView();
-            GraphicsView *sv = qobject_cast<GraphicsView*>(v->toWidget());
-
-            if(sv) {
-                if(sv->currentZoom() < 1) {
-                    // While drawing, choose spacing to be multiple times the actual grid size.
-                    if(sv->currentZoom() > 0.5) {
-                        drawingGridWidth *= 4;
-                        drawingGridHeight *= 4;
-                    }
-                    else {
-                        drawingGridWidth *= 16;
-                        drawingGridHeight *= 16;
-                    }
+            // Make grid size display dinamic, depending on zoom level. The
+            // zoom is taken from the painter, as the scene may be shown in
+            // several views with different zoom levels at the same time.
+            const qreal zoom = painter->worldTransform().m11();
+            if(zoom < 1) {
+                // While drawing, choose spacing to be multiple times the actual grid size.
+                if(zoom > 0.5) {
+                    drawingGridWidth *= 4;
+                    drawingGridHeight *= 4;
+                }
+                else {
+                    drawingGridWidth *= 16;
+                    drawingGridHeight *= 16;
                 }
             }
 
@@ -874,13 +1094,20 @@ namespace Caneda
             qreal bottom = int(rect.bottom()) - (int(rect.bottom()) % drawingGridHeight);
             qreal x, y;
 
-            // Draw grid
-            painter->setBrush(Qt::NoBrush);
+            // Draw all the grid points in a single call
+            int columns = int((right - left) / drawingGridWidth) + 1;
+            int rows = int((bottom - top) / drawingGridHeight) + 1;
+            m_gridPoints.clear();
+            m_gridPoints.reserve(columns * rows);
+
             for(x = left; x <= right; x += drawingGridWidth) {
                 for(y = top; y <=bottom; y += drawingGridHeight) {
-                    painter->drawPoint(QPointF(x, y));
+                    m_gridPoints.append(QPointF(x, y));
                 }
             }
+
+            painter->setBrush(Qt::NoBrush);
+            painter->drawPoints(m_gridPoints.constData(), m_gridPoints.size());
         }
 
         // Restore painter
@@ -1134,7 +1361,7 @@ namespace Caneda
      * to accomodate item movements.
      *
      * \sa disconnectDisconnectibles(), processForSpecialMove(),
-     * specialMove(), endSpecialMove()
+     * beginSpecialMove(), specialMove(), endSpecialMove()
      */
     void GraphicsScene::normalEvent(QGraphicsSceneMouseEvent *event)
     {
@@ -1155,6 +1382,7 @@ namespace Caneda
                             m_undoStack->beginMacro(tr("Move items"));
 
                             disconnectDisconnectibles();
+                            beginSpecialMove();
                             QGraphicsScene::mouseMoveEvent(event);
                             specialMove();
                         }
@@ -1765,10 +1993,11 @@ namespace Caneda
      * This method decides which tipe of movement each item must perform. In
      * general, moving wires should disconnect from unselected components, and
      * unselected wires should change their geometry to accomodate item
-     * movements. This is acomplished by generating two lists:
+     * movements. This is acomplished in two steps:
      *
-     * \li A list of items to disconnect
-     * \li A list of wires whose geometry must be updated
+     * \li On mouse press, this method generates a list of items to disconnect
+     * \li Once the drag begins and those items are disconnected,
+     * beginSpecialMove() generates a list of wire ends to be moved
      *
      * The action of this function is observed, for example, when moving an
      * item (a wire, a component, etc) connected to other components. By
@@ -1778,12 +2007,12 @@ namespace Caneda
      * (when moving a wire away from a component), expected movements are
      * performed.
      *
-     * \sa normalEvent(), specialMove()
+     * \sa normalEvent(), beginSpecialMove(), specialMove()
      */
     void GraphicsScene::processForSpecialMove()
     {
         disconnectibles.clear();
-        specialMoveItems.clear();
+        specialMovePorts.clear();
 
         foreach(QGraphicsItem *qItem, selectedItems()) {
             GraphicsItem *item = canedaitem_cast<GraphicsItem*>(qItem);
@@ -1792,30 +2021,66 @@ namespace Caneda
                 // Save item's position for later use in undo/redo.
                 item->storePos();
 
-                // Check for disconnections and wire resizing
+                // Check for disconnections. If the item is connected to an
+                // unselected component, it must be disconnected from it.
+                bool disconnectible = false;
                 foreach(Port *port, item->ports()) {
-
-                    foreach(Port *other, *(port->connections())) {
-                        // If the item connected is a component, determine whether it should
-                        // be disconnected or not.
+                    foreach(Port *other, port->connections()) {
                         if(other->parentItem()->type() == GraphicsItem::ComponentType &&
                                 !other->parentItem()->isSelected()) {
-                            disconnectibles << item;
-                        }
-                        // If the item connected is a wire, determine whether it should be
-                        // resized or moved.
-                        if(other->parentItem()->type() == GraphicsItem::WireType &&
-                                !other->parentItem()->isSelected()) {
-                            specialMoveItems << other->parentItem();
-                        }
-                        // If the item connected is a port, determine whether it should be
-                        // moved or not.
-                        if(other->parentItem()->type() == GraphicsItem::PortSymbolType &&
-                                !other->parentItem()->isSelected()) {
-                            specialMoveItems << other->parentItem();
+                            disconnectible = true;
+                            break;
                         }
                     }
+                }
 
+                if(disconnectible) {
+                    disconnectibles << item;
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Generate the list of ports to move along with the selected items.
+     *
+     * This method is called once, when the items begin to move, and finds
+     * the ports of unselected wires and port symbols connected to the
+     * selected items. Each such port is stored along with the port it must
+     * follow, so that specialMove() does not need to search the connections
+     * again on every mouse move. Each port is stored only once, even if it
+     * is connected to several moving ports.
+     *
+     * \sa processForSpecialMove(), specialMove()
+     */
+    void GraphicsScene::beginSpecialMove()
+    {
+        specialMovePorts.clear();
+        QSet<Port*> followers;
+
+        foreach(QGraphicsItem *qItem, selectedItems()) {
+            GraphicsItem *item = canedaitem_cast<GraphicsItem*>(qItem);
+            if(!item) {
+                continue;
+            }
+
+            foreach(Port *port, item->ports()) {
+                foreach(Port *other, port->connections()) {
+                    GraphicsItem *otherItem = other->parentItem();
+                    if(otherItem->isSelected() || followers.contains(other)) {
+                        continue;
+                    }
+
+                    // Unselected wires are resized and port symbols moved
+                    if(otherItem->type() == GraphicsItem::WireType ||
+                            otherItem->type() == GraphicsItem::PortSymbolType) {
+                        SpecialMovePort specialMovePort;
+                        specialMovePort.port = other;
+                        specialMovePort.leader = port;
+                        specialMovePorts << specialMovePort;
+
+                        followers << other;
+                    }
                 }
             }
         }
@@ -1837,59 +2102,42 @@ namespace Caneda
      * a gap would appear between the moved wire and the connected wires (which
      * would remain in their original place).
      *
-     * \sa normalEvent(), processForSpecialMove()
+     * Only the positions of the ports found by beginSpecialMove() are
+     * updated here. The shape of the resized wires is rebuilt once needed,
+     * not on every mouse move (see Wire::updateGeometry()).
+     *
+     * \sa normalEvent(), beginSpecialMove()
      */
     void GraphicsScene::specialMove()
     {
-        foreach(GraphicsItem *item, specialMoveItems) {
+        foreach(const SpecialMovePort &specialMovePort, specialMovePorts) {
+            Port *port = specialMovePort.port;
+            QPointF newPos = specialMovePort.leader->scenePos();
 
-            // The wires in specialMoveItems are those wires that are not selected
-            // but whose geometry must acommodate to the current moving wire.
-            if(item->type() == GraphicsItem::WireType) {
+            // Only ports whose leader has moved must copy its position
+            if(port->scenePos() == newPos) {
+                continue;
+            }
 
-                // Check both ports (port1 and port2) of the unselected wire for
-                // possible ports movement.
-                Wire *wire = canedaitem_cast<Wire*>(item);
+            GraphicsItem *item = port->parentItem();
 
-                // First check port1
-                foreach(Port *other, *(wire->port1()->connections())) {
-                    // If some of the connected ports has moved, we have found the
-                    // moving wire and this port must copy that port position.
-                    if(other->scenePos() != wire->port1()->scenePos()) {
-                        wire->movePort1(other->scenePos());
-                        break;
-                    }
+            // The wires are those wires that are not selected but whose
+            // geometry must acommodate to the current moving items.
+            if(item->type() == GraphicsItem::WireType) {
+                Wire *wire = static_cast<Wire*>(item);
+                if(port == wire->port1()) {
+                    wire->movePort1(newPos);
                 }
-
-                // Then check port2
-                foreach(Port *other, *(wire->port2()->connections())) {
-                    // If some of the connected ports has moved, we have found the
-                    // moving wire and this port must copy that port position.
-                    if(other->scenePos() != wire->port2()->scenePos()) {
-                        wire->movePort2(other->scenePos());
-                        break;
-                    }
+                else {
+                    wire->movePort2(newPos);
                 }
-
             }
 
-            // The ports in specialMoveItems must be moved along the selected
-            // (and moving) wires.
+            // The port symbols must be moved along the selected (and moving)
+            // items.
             if(item->type() == GraphicsItem::PortSymbolType) {
-
-                PortSymbol *portSymbol = canedaitem_cast<PortSymbol*>(item);
-
-                foreach(Port *other, *(portSymbol->port()->connections())) {
-                    // If some of the connected ports has moved, we have found the
-                    // moving item and this port must copy that port position.
-                    if(other->scenePos() != portSymbol->scenePos()) {
-                        portSymbol->setPos(other->scenePos());
-                        break;
-                    }
-                }
-
+                item->setPos(newPos);
             }
-
         }
     }
 
@@ -1916,7 +2164,7 @@ namespace Caneda
             }
         }
 
-        specialMoveItems.clear();
+        specialMovePorts.clear();
         disconnectibles.clear();
     }
 
@@ -1939,7 +2187,7 @@ namespace Caneda
             int disconnections = 0;
             foreach(Port *port, item->ports()) {
 
-                foreach(Port *other, *(port->connections())) {
+                foreach(Port *other, port->connections()) {
                     if(other->parentItem()->type() == GraphicsItem::ComponentType &&
                             other->parentItem() != item &&
                             !other->parentItem()->isSelected()) {
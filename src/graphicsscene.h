@@ -27,6 +27,7 @@
 #include <QGraphicsItem>
 #include <QGraphicsScene>
 #include <QList>
+#include <QVector>
 
 #include <QtPrintSupport/QPrinter>
 
@@ -38,6 +39,8 @@ namespace Caneda
     // Forward declarations
     class Component;
     class GraphicsItem;
+    class NetDatabase;
+    class SpatialIndex;
     class Painting;
     class Wire;
 
@@ -67,7 +70,23 @@ namespace Caneda
         Q_OBJECT
 
     public:
+        /*!
+         * \brief Options to render the scene outside of its views.
+         *
+         * They replace the user settings while rendering, so that printing
+         * or exporting doesn't need to change the settings shared with the
+         * views.
+         *
+         * \sa renderArea()
+         */
+        struct RenderOptions
+        {
+            bool backgroundVisible;  // Draw the background color
+            bool gridVisible;  // Draw the grid
+        };
+
         explicit GraphicsScene(QObject *parent = 0);
+        ~GraphicsScene();
 
         // Edit actions
         void cutItems(QList<GraphicsItem*> &items);
@@ -91,7 +110,10 @@ namespace Caneda
         void setBackgroundVisible(bool visible);
 
         void print(QPrinter *printer, bool fitInView);
-        bool exportImage(QPaintDevice &);
+        bool exportImage(QPaintDevice &pix, bool gridVisible = false);
+
+        void renderArea(QPainter *painter, const QRectF &target, const QRectF &source,
+                        const RenderOptions &options);
 
         // Mouse actions
         void setMouseAction(const Caneda::MouseAction ma);
@@ -102,6 +124,8 @@ namespace Caneda
         // Connect/disconnect methods
         QPointF centerOfItems(const QList<GraphicsItem*> &items);
 
+        void addItems(const QList<GraphicsItem*> &items);
+
         void connectItems(GraphicsItem *item);
         void connectItems(QList<GraphicsItem *> &items);
         void disconnectItems(GraphicsItem *item);
@@ -112,14 +136,32 @@ namespace Caneda
 
         //! \brief Return current undo stack
         QUndoStack* undoStack() { return m_undoStack; }
+        bool canUndo() const;
+        void undo();
+
+        void addRemoveCommand(RemoveItemsCmd *command);
+        void removeRemoveCommand(RemoveItemsCmd *command);
+
+        //! \brief Return the database holding the ports connections
+        NetDatabase* netDatabase() const { return m_netDatabase; }
+        //! \brief Return the index of the ports and wires positions
+        SpatialIndex* spatialIndex() const { return m_spatialIndex; }
 
         // Spice/electric related scene properties
         PropertyGroup* properties() { return m_properties; }
         void addProperty(Property property);
 
     Q_SIGNALS:
-        //! \brief This signal is emitted whenever the undostack enters or leaves the clean state.
+        /*!
+         * \brief This signal is emitted whenever the undostack enters or
+         * leaves the clean state, or part of its history is released.
+         */
         void changed();
+        /*!
+         * \brief This signal is emitted whenever canUndo() changes, taking
+         * the undo floor and limit into account.
+         */
+        void canUndoChanged(bool canUndo);
         void mouseActionChanged(Caneda::MouseAction);
 
     protected:
@@ -136,7 +178,13 @@ namespace Caneda
         void wheelEvent(QGraphicsSceneWheelEvent *event);
         void contextMenuEvent(QGraphicsSceneContextMenuEvent *event);
 
+    private Q_SLOTS:
+        void trimUndoHistory();
+
     private:
+        // Undo history
+        void updateCanUndo();
+
         // Custom event handlers
         void sendMouseActionEvent(QGraphicsSceneMouseEvent *event);
         void normalEvent(QGraphicsSceneMouseEvent *event);
@@ -167,6 +215,7 @@ namespace Caneda
         int componentLabelSuffix(const QString& labelPrefix) const;
 
         void processForSpecialMove();
+        void beginSpecialMove();
         void specialMove();
         void endSpecialMove();
         void disconnectDisconnectibles();
@@ -215,21 +264,28 @@ namespace Caneda
          */
         QList<GraphicsItem*> disconnectibles;
 
+        //! \brief Port of an unselected item following a moving port.
+        struct SpecialMovePort
+        {
+            Port *port;  // Unselected wire or port symbol port
+            Port *leader;  // Port of a moving item
+        };
+
         /*!
-         * \brief List of items requiring special movements due to mouse event
+         * \brief List of ports requiring special movements due to mouse event
          *
          * When an item is moved (click + drag) and one of the connected wires
          * is't selected, the latter's geometry needs to be altered to retain
-         * its connection. Hence the last wires must be selected in
-         * processForSpecialMove() and resized in specialMove().
+         * its connection. Hence the ends of the last wires must be selected in
+         * beginSpecialMove() and moved in specialMove().
          *
          * In a similar manner, some while some items must be disconnected (for
          * example normal components) others must be moved along with the wire
          * (for example net labels or port symbols).
          *
-         * \sa processForSpecialMove(), specialMove()
+         * \sa beginSpecialMove(), specialMove()
          */
-        QList<GraphicsItem*> specialMoveItems;
+        QList<SpecialMovePort> specialMovePorts;
 
         /*!
          * \brief State variable for the current wire state.
@@ -257,6 +313,19 @@ namespace Caneda
          */
         bool m_backgroundVisible;
 
+        /*!
+         * \brief Options of the render in progress, or null when the scene
+         * is being painted by its views
+         * \sa renderArea
+         */
+        const RenderOptions *m_renderOptions;
+
+        /*!
+         * \brief Grid points buffer, reused by drawBackground() to avoid
+         * an allocation on every repaint.
+         */
+        QVector<QPointF> m_gridPoints;
+
         /*!
          * \brief Rectangular widget to show feedback of an area being
          * selected for zooming
@@ -268,6 +337,30 @@ namespace Caneda
         //! \brief GraphicsScene undo stack
         QUndoStack *m_undoStack;
 
+        /*!
+         * \brief Remove commands of the undo stack, oldest first
+         *
+         * The items they remove are kept alive to be restored on undo, and
+         * make up most of the memory used by the undo history.
+         *
+         * \sa trimUndoHistory
+         */
+        QList<RemoveItemsCmd*> m_removeCommands;
+
+        /*!
+         * \brief Newest remove command whose items were released, or null.
+         * The undo history can't be undone past it.
+         */
+        RemoveItemsCmd *m_undoFloor;
+        //! \brief Last value of canUndo() notified by canUndoChanged()
+        bool m_canUndo;
+
+        //! \brief Connections between the ports of the scene items
+        NetDatabase *m_netDatabase;
+
+        //! \brief Positions of the ports and wires of the scene items
+        SpatialIndex *m_spatialIndex;
+
         //! \brief Spice/electric related scene properties
         PropertyGroup *m_properties;
     };
@@ -239,6 +239,7 @@ namespace Caneda
     {
         QStringList nameFilters;
         nameFilters << QObject::tr("Layout-xml (*.xlay)");
+        nameFilters << QObject::tr("Layout-binary (*.blay)");
 
         return nameFilters;
     }
@@ -249,6 +250,7 @@ namespace Caneda
         // provided by defaultSuffix() for all dialogs.
         QStringList supportedSuffixes;
         supportedSuffixes << "xlay";
+        supportedSuffixes << "blay";
 
         return supportedSuffixes;
     }
@@ -362,6 +364,7 @@ namespace Caneda
     {
         QStringList nameFilters;
         nameFilters << QObject::tr("Schematic-xml (*.xsch)");
+        nameFilters << QObject::tr("Schematic-binary (*.bsch)");
 
         return nameFilters;
     }
@@ -372,6 +375,7 @@ namespace Caneda
         // provided by defaultSuffix() for all dialogs.
         QStringList supportedSuffixes;
         supportedSuffixes << "xsch";
+        supportedSuffixes << "bsch";
 
         return supportedSuffixes;
     }
@@ -529,6 +533,7 @@ namespace Caneda
     {
         QStringList nameFilters;
         nameFilters << QObject::tr("Symbol-xml (*.xsym)");
+        nameFilters << QObject::tr("Symbol-binary (*.bsym)");
 
         return nameFilters;
     }
@@ -539,6 +544,7 @@ namespace Caneda
         // provided by defaultSuffix() for all dialogs.
         QStringList supportedSuffixes;
         supportedSuffixes << "xsym";
+        supportedSuffixes << "bsym";
 
         return supportedSuffixes;
     }
@@ -32,6 +32,7 @@
 #include "messagewidget.h"
 #include "portsymbol.h"
 #include "settings.h"
+#include "simulationjobmanager.h"
 #include "statehandler.h"
 #include "syntaxhighlighters.h"
 #include "textedit.h"
@@ -47,6 +48,7 @@
 #include <QTextCodec>
 #include <QTextDocument>
 #include <QTextStream>
+#include <QTimer>
 
 namespace Caneda
 {
@@ -242,6 +244,9 @@ namespace Caneda
      * This method is called directly by the ExportDialog class,
      * upon user input. Not all document types can be exported to
      * images.
+     *
+     * \param device Paint device receiving the image.
+     * \param gridVisible True to draw the grid, in the documents having one.
      */
 
     /*!
@@ -359,7 +364,7 @@ namespace Caneda
         m_graphicsScene = new GraphicsScene(this);
         connect(m_graphicsScene, SIGNAL(changed()), this,
                 SLOT(emitDocumentChanged()));
-        connect(m_graphicsScene->undoStack(), SIGNAL(canUndoChanged(bool)),
+        connect(m_graphicsScene, SIGNAL(canUndoChanged(bool)),
                 this, SLOT(emitDocumentChanged()));
         connect(m_graphicsScene->undoStack(), SIGNAL(canRedoChanged(bool)),
                 this, SLOT(emitDocumentChanged()));
@@ -385,7 +390,7 @@ namespace Caneda
 
     bool LayoutDocument::canUndo() const
     {
-        return m_graphicsScene->undoStack()->canUndo();
+        return m_graphicsScene->canUndo();
     }
 
     bool LayoutDocument::canRedo() const
@@ -395,7 +400,7 @@ namespace Caneda
 
     void LayoutDocument::undo()
     {
-        m_graphicsScene->undoStack()->undo();
+        m_graphicsScene->undo();
     }
 
     void LayoutDocument::redo()
@@ -514,9 +519,9 @@ namespace Caneda
         m_graphicsScene->print(printer, fitInView);
     }
 
-    void LayoutDocument::exportImage(QPaintDevice &device)
+    void LayoutDocument::exportImage(QPaintDevice &device, bool gridVisible)
     {
-        m_graphicsScene->exportImage(device);
+        m_graphicsScene->exportImage(device, gridVisible);
     }
 
     QSizeF LayoutDocument::documentSize()
@@ -532,6 +537,10 @@ namespace Caneda
             FormatXmlLayout *format = new FormatXmlLayout(this);
             return format->load();
         }
+        else if(info.suffix() == "blay") {
+            FormatBinary *format = new FormatBinary(this);
+            return format->load();
+        }
 
         if (errorMessage) {
             *errorMessage = tr("Unknown file format!");
@@ -560,6 +569,15 @@ namespace Caneda
             m_graphicsScene->undoStack()->clear();
             return true;
         }
+        else if(info.suffix() == "blay") {
+            FormatBinary *format = new FormatBinary(this);
+            if(!format->save()) {
+                return false;
+            }
+
+            m_graphicsScene->undoStack()->clear();
+            return true;
+        }
 
         if(errorMessage) {
             *errorMessage = tr("Unknown file format!");
@@ -621,22 +639,32 @@ namespace Caneda
      *                          SchematicDocument                            *
      *************************************************************************/
     //! \brief Constructor.
-    SchematicDocument::SchematicDocument(QObject *parent) : IDocument(parent)
+    SchematicDocument::SchematicDocument(QObject *parent) :
+        IDocument(parent),
+        m_simulationJob(-1)
     {
         m_graphicsScene = new GraphicsScene(this);
         connect(m_graphicsScene, SIGNAL(changed()), this,
                 SLOT(emitDocumentChanged()));
-        connect(m_graphicsScene->undoStack(), SIGNAL(canUndoChanged(bool)),
+        connect(m_graphicsScene, SIGNAL(canUndoChanged(bool)),
                 this, SLOT(emitDocumentChanged()));
         connect(m_graphicsScene->undoStack(), SIGNAL(canRedoChanged(bool)),
                 this, SLOT(emitDocumentChanged()));
         connect(m_graphicsScene, SIGNAL(selectionChanged()), this,
                 SLOT(emitDocumentChanged()));
+
+        m_followTimer = new QTimer(this);
+        m_followTimer->setInterval(500);
+        connect(m_followTimer, SIGNAL(timeout()), this, SLOT(followSimulation()));
+
+        connect(SimulationJobManager::instance(), SIGNAL(jobFinished(int)),
+                this, SLOT(simulationFinished(int)));
     }
 
     //! \brief Destructor.
     SchematicDocument::~SchematicDocument()
     {
+        SimulationJobManager::instance()->cancel(m_simulationJob);
         delete m_graphicsScene;
     }
 
@@ -652,7 +680,7 @@ namespace Caneda
 
     bool SchematicDocument::canUndo() const
     {
-        return m_graphicsScene->undoStack()->canUndo();
+        return m_graphicsScene->canUndo();
     }
 
     bool SchematicDocument::canRedo() const
@@ -662,7 +690,7 @@ namespace Caneda
 
     void SchematicDocument::undo()
     {
-        m_graphicsScene->undoStack()->undo();
+        m_graphicsScene->undo();
     }
 
     void SchematicDocument::redo()
@@ -778,45 +806,72 @@ namespace Caneda
      * opening the waveform viewer (could be internal or external acording to
      * the user settings).
      *
-     * \sa simulationReady(), simulationError(), performBasicChecks()
+     * The simulation is run as a job of the SimulationJobManager, to avoid
+     * blocking the interface while simulating. If a previous simulation of
+     * this document is still running, it is canceled.
+     *
+     * \sa simulationFinished(), simulationReady(), performBasicChecks()
      */
     void SchematicDocument::simulate()
     {
-        /*! \todo In the future (after Qt5.6 is released), instead of this
-         * first check, simply connect the simulation process with the slot
-         * simulationError, in a way similar to the following:
-         * connect(simulationProcess, SIGNAL(errorOccurred(QProcess::ProcessError)), this, SLOT(simulationError(QProcess::ProcessError)));
-         * This will check against any simulator, instead of the current
-         * check that only verifies the ngspice installation.
-         * \sa simulationError()
-         */
-        if(!simulationError()) {
-            return;
-        }
-
         if(!performBasicChecks()) {
             return;
         }
 
         QFileInfo info(fileName());
-        QString baseName = info.completeBaseName();
-        QString path = info.path();
 
         // First export the schematic to a spice netlist
-        if(info.suffix() == "xsch") {
+        if(info.suffix() == "xsch" || info.suffix() == "bsch") {
             FormatSpice *format = new FormatSpice(this);
             format->save();
         }
 
+        // Queue the simulation. The simulation results are opened in the
+        // simulationFinished slot, to avoid blocking the interface while simulating
+        SimulationJob job = simulationJob();
+        SimulationJobManager *jobManager = SimulationJobManager::instance();
+        jobManager->cancel(m_simulationJob);
+        m_simulationJob = jobManager->addJob(job);
+
+        // Optionally show the waveforms while simulating, once the simulator
+        // creates the raw file. The start time is truncated to seconds, as
+        // some file systems only store the modification time in seconds.
+        if(Settings::instance()->currentValue("sim/followSimulation").toBool()) {
+            m_simulationStart = QDateTime::fromTime_t(QDateTime::currentDateTime().toTime_t());
+            m_followTimer->start();
+        }
+    }
+
+    /*!
+     * \brief Returns the job running the spice simulator on the netlist of
+     * this document.
+     *
+     * The simulator command is taken from the user settings, and the netlist
+     * is expected to be already generated with FormatSpice.
+     *
+     * \param expandFileName If false, the %filename placeholder is kept in
+     * the commands, for the job to be used as the template of a parameter
+     * sweep.
+     *
+     * \sa simulate(), SimulationJobManager::addSweep()
+     */
+    SimulationJob SchematicDocument::simulationJob(bool expandFileName) const
+    {
+        QFileInfo info(fileName());
+        QString baseName = info.completeBaseName();
+        QString path = info.path();
+
         // Invoke a spice simulator in batch mode
         Settings *settings = Settings::instance();
         QString simulationCommand = settings->currentValue("sim/simulationCommand").toString();
-        simulationCommand.replace("%filename", baseName);  // Replace all ocurrencies of %filename by the actual filename
+        if(expandFileName) {
+            simulationCommand.replace("%filename", baseName);  // Replace all ocurrencies of %filename by the actual filename
+        }
 
-        QProcess *simulationProcess = new QProcess(this);
-        simulationProcess->setWorkingDirectory(path);
-        simulationProcess->setProcessChannelMode(QProcess::MergedChannels);  // Output std:error and std:output together into the same file
-        simulationProcess->setStandardOutputFile(path + "/" + baseName + ".log", QIODevice::WriteOnly);  // Create a log file
+        SimulationJob job;
+        job.commands << simulationCommand;
+        job.workingDirectory = path;
+        job.logFile = path + "/" + baseName + ".log";  // Create a log file
 
         // Set the environment variable to get a binary or an ascii raw file.
         QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
@@ -826,13 +881,9 @@ namespace Caneda
         else if(settings->currentValue("sim/outputFormat").toString() == "ascii") {
             env.insert("SPICE_ASCIIRAWFILE", "1"); // Add an environment variable
         }
-        simulationProcess->setProcessEnvironment(env);
-
-        // Start the simulation
-        simulationProcess->start(simulationCommand);
+        job.environment = env;
 
-        // The simulation results are opened in the simulationReady slot, to avoid blocking the interface while simulating
-        connect(simulationProcess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(simulationReady(int)));
+        return job;
     }
 
     void SchematicDocument::print(QPrinter *printer, bool fitInView)
@@ -840,9 +891,9 @@ namespace Caneda
         m_graphicsScene->print(printer, fitInView);
     }
 
-    void SchematicDocument::exportImage(QPaintDevice &device)
+    void SchematicDocument::exportImage(QPaintDevice &device, bool gridVisible)
     {
-        m_graphicsScene->exportImage(device);
+        m_graphicsScene->exportImage(device, gridVisible);
     }
 
     QSizeF SchematicDocument::documentSize()
@@ -858,6 +909,10 @@ namespace Caneda
             FormatXmlSchematic *format = new FormatXmlSchematic(this);
             return format->load();
         }
+        else if(info.suffix() == "bsch") {
+            FormatBinary *format = new FormatBinary(this);
+            return format->load();
+        }
 
         if (errorMessage) {
             *errorMessage = tr("Unknown file format!");
@@ -886,6 +941,15 @@ namespace Caneda
             m_graphicsScene->undoStack()->clear();
             return true;
         }
+        else if(info.suffix() == "bsch") {
+            FormatBinary *format = new FormatBinary(this);
+            if(!format->save()) {
+                return false;
+            }
+
+            m_graphicsScene->undoStack()->clear();
+            return true;
+        }
 
         if(errorMessage) {
             *errorMessage = tr("Unknown file format!");
@@ -940,25 +1004,66 @@ namespace Caneda
     }
 
     /*!
-     * \brief Open simulation results.
+     * \brief Handle the end of a simulation job.
+     *
+     * This slot is invoked by the SimulationJobManager every time a job
+     * finishes. Jobs not belonging to this document are ignored. Depending
+     * on the job status, the simulation results or an error are shown.
      *
-     * Once a simulation is started, the simulation process is connected to
-     * this slot, to achive non-modal simulations (ie, the gui is responsive
-     * during simulations).
+     * \sa simulate(), simulationReady(), simulationError()
+     */
+    void SchematicDocument::simulationFinished(int job)
+    {
+        if(job != m_simulationJob) {
+            return;
+        }
+
+        SimulationJobManager *jobManager = SimulationJobManager::instance();
+        SimulationJobManager::JobStatus status = jobManager->status(job);
+        jobManager->removeJob(job);
+        m_simulationJob = -1;
+
+        if(status == SimulationJobManager::Canceled) {
+            m_followTimer->stop();
+        }
+        else if(status == SimulationJobManager::FailedToStart) {
+            m_followTimer->stop();
+            simulationError();
+        }
+        else {
+            simulationReady(status != SimulationJobManager::Finished);
+        }
+    }
+
+    /*!
+     * \brief Open simulation results.
      *
      * Once the simulation has finished, this slot is invoked and if no error
      * ocurred, simulation results are shown to the user. The waveform viewer
      * can be internal or external acording to the user settings.
      *
-     * \sa simulate()
+     * \sa simulate(), simulationFinished()
      */
     void SchematicDocument::simulationReady(int error)
     {
+        QFileInfo info(fileName());
+        QString path = info.path();
+        QString baseName = info.completeBaseName();
+        QString rawFileName = QDir::toNativeSeparators(path + "/" + baseName + ".raw");
+
+        // Stop following the simulation in progress, if any
+        m_followTimer->stop();
+
+        DocumentViewManager *manager = DocumentViewManager::instance();
+        SimulationDocument *rawDocument = qobject_cast<SimulationDocument*>(manager->documentForFileName(rawFileName));
+        if(rawDocument) {
+            rawDocument->setFollowing(false);
+        }
+
         // Test for errors, and open log file (in case something went wrong).
         // If there was an error, do not display the waveforms
         if(error) {
 
-            DocumentViewManager *manager = DocumentViewManager::instance();
             IView *view = manager->currentView();
 
             MessageWidget *dialog = new MessageWidget("There was an error during the simulation...", view->toWidget());
@@ -977,84 +1082,69 @@ namespace Caneda
             return;
         }
 
-        // Open the resulting waveforms
-        DocumentViewManager *manager = DocumentViewManager::instance();
+        // Open the resulting waveforms. If the waveforms were already open
+        // (for example, while following the simulation), they are reloaded.
+        manager->openFile(rawFileName);
+    }
 
+    /*!
+     * \brief Open the simulation results while the simulation is running.
+     *
+     * This slot is periodically invoked after starting a simulation, until
+     * the simulator creates the raw file. Then, the raw file is opened and
+     * followed, displaying the waveforms as they are being written. Once the
+     * simulation finishes, the waveforms are reloaded in simulationReady().
+     *
+     * \sa simulate(), simulationReady(), SimulationDocument::setFollowing()
+     */
+    void SchematicDocument::followSimulation()
+    {
         QFileInfo info(fileName());
         QString path = info.path();
         QString baseName = info.completeBaseName();
+        QString rawFileName = QDir::toNativeSeparators(path + "/" + baseName + ".raw");
+
+        // Wait until the simulator creates (or rewrites) the raw file
+        QFileInfo rawInfo(rawFileName);
+        if(!rawInfo.exists() || rawInfo.lastModified() < m_simulationStart) {
+            return;
+        }
+
+        m_followTimer->stop();
 
-        manager->openFile(QDir::toNativeSeparators(path + "/" + baseName + ".raw"));
+        DocumentViewManager *manager = DocumentViewManager::instance();
+        if(manager->openFile(rawFileName)) {
+            SimulationDocument *rawDocument = qobject_cast<SimulationDocument*>(manager->documentForFileName(rawFileName));
+            if(rawDocument) {
+                rawDocument->setFollowing(true);
+            }
+        }
     }
 
     /*!
-     * \brief Check what error has occured and show a message to the user.
-     *
-     * This method checks the kind of error present on the process and shows a
-     * message to the user. Basically, this method is called when the process
-     * could not start due to a missing or incorrect installation of the
-     * simulation backend. Other checks are performed in the performBasicChecks()
-     * method.
-     *
-     * \todo In the future, when Qt5.6 is out, use this method to connect to
-     * the QProcess::errorOccurred(QProcess::ProcessError) signal in the
-     * simulate method. That would allow to check against a generic simulator,
-     * without needing to use a predefined simulation command. As in Qt
-     * previous versions to 5.6 that signal was not present, this method was
-     * used with a return value and called before calling the simulator. As
-     * beforehand we do not know what simulator is to be used and what commands
-     * are available we only check for the default simulator, ie, ngspice. The
-     * ngspice simulator has the -v parameter which is used to check if
-     * it is installed without needing to call the entire simulation just to
-     * check if the binary is present. When the signal is available (after
-     * Qt5.6 is released and available in the most common distributions) we
-     * can call this method in the form of a slot connected to the previous
-     * signal. In that way, we do not need to know the simulation command and
-     * instead this method is called if there's any problem.
-     * In that time, this method should be declared as:
-     * void SchematicDocument::simulationError(QProcess::ProcessError).
-     * In the implementation, instead of using all the presently involved checks,
-     * simply we should check the passed argument QProcess::ProcessError and
-     * checked against QProcess::FailedToStart, triggering a message similar to
-     * the currently present.
-     *
-     * \sa simulate(), performBasicChecks()
+     * \brief Show a message to the user when the simulator can't be started.
+     *
+     * This method is called when the simulation process could not start due
+     * to a missing or incorrect installation of the simulation backend (or
+     * insufficient permissions to invoke it). Other checks are performed in
+     * the performBasicChecks() method.
+     *
+     * \sa simulationFinished(), performBasicChecks()
      */
-    bool SchematicDocument::simulationError()
+    void SchematicDocument::simulationError()
     {
-        // Get the current spice command
-        Settings *settings = Settings::instance();
-        QString simulationCommand = settings->currentValue("sim/simulationCommand").toString();
-
-        // If using ngspice (the default spice backend) check if its installed.
-        if(simulationCommand.startsWith("ngspice")) {
-
-            simulationCommand = QString("ngspice -v");
-            QProcess *simulationProcess = new QProcess(this);
-            simulationProcess->start(simulationCommand);
-            simulationProcess->waitForFinished();
-
-            if(simulationProcess->error() == QProcess::FailedToStart) {
-                // If FailedToStart either ngspice is missing, the user has
-                // insufficient permissions to invoke the program.
-                DocumentViewManager *manager = DocumentViewManager::instance();
-                IView *view = manager->currentView();
-
-                MessageWidget *dialog = new MessageWidget(tr("Missing simulator backend..."), view->toWidget());
-                dialog->setMessageType(MessageWidget::Error);
-                dialog->setIcon(Caneda::icon("dialog-error"));
-
-                QAction *action = new QAction(Caneda::icon("help-contents"), tr("More info..."), this);
-                connect(action, SIGNAL(triggered()), SLOT(showSimulationHelp()));
+        DocumentViewManager *manager = DocumentViewManager::instance();
+        IView *view = manager->currentView();
 
-                dialog->addAction(action);
-                dialog->show();
+        MessageWidget *dialog = new MessageWidget(tr("Missing simulator backend..."), view->toWidget());
+        dialog->setMessageType(MessageWidget::Error);
+        dialog->setIcon(Caneda::icon("dialog-error"));
 
-                return false;
-            }
-        }
+        QAction *action = new QAction(Caneda::icon("help-contents"), tr("More info..."), this);
+        connect(action, SIGNAL(triggered()), SLOT(showSimulationHelp()));
 
-        return true;
+        dialog->addAction(action);
+        dialog->show();
     }
 
     //! \brief Opens the simulation help.
@@ -1185,7 +1275,9 @@ namespace Caneda
      *                         SimulationDocument                            *
      *************************************************************************/
     //! \brief Constructor.
-    SimulationDocument::SimulationDocument(QObject *parent) : IDocument(parent)
+    SimulationDocument::SimulationDocument(QObject *parent) :
+        IDocument(parent),
+        m_rawFormat(0)
     {
         m_chartScene = new ChartScene;
     }
@@ -1242,7 +1334,7 @@ namespace Caneda
         cv->print(printer, fitInView);
     }
 
-    void SimulationDocument::exportImage(QPaintDevice &device)
+    void SimulationDocument::exportImage(QPaintDevice &device, bool gridVisible)
     {
         /*!
          * Get current view, and print it. This method differs from
@@ -1250,6 +1342,8 @@ namespace Caneda
          * way to know the actual curves being displayed on the current
          * view.
          */
+        Q_UNUSED(gridVisible);
+
         DocumentViewManager *manager = DocumentViewManager::instance();
         IView *v = manager->currentView();
         ChartView *cv = qobject_cast<ChartView*>(v->toWidget());
@@ -1269,8 +1363,8 @@ namespace Caneda
         QFileInfo info(fileName());
 
         if(info.suffix() == "raw") {
-            FormatRawSimulation *format = new FormatRawSimulation(this);
-            return format->load();
+            m_rawFormat = new FormatRawSimulation(this);
+            return m_rawFormat->load();
         }
 
         if (errorMessage) {
@@ -1285,6 +1379,21 @@ namespace Caneda
         return new SimulationView(this);
     }
 
+    /*!
+     * \brief Sets the following state of the document waveform file.
+     *
+     * While following, new data written to the waveform file (for example,
+     * by a simulation in progress) is periodically read and displayed.
+     *
+     * \sa FormatRawSimulation::setFollowing()
+     */
+    void SimulationDocument::setFollowing(bool following)
+    {
+        if(m_rawFormat) {
+            m_rawFormat->setFollowing(following);
+        }
+    }
+
     void SimulationDocument::launchPropertiesDialog()
     {
         DocumentViewManager *manager = DocumentViewManager::instance();
@@ -1306,7 +1415,7 @@ namespace Caneda
         m_graphicsScene = new GraphicsScene(this);
         connect(m_graphicsScene, SIGNAL(changed()), this,
                 SLOT(emitDocumentChanged()));
-        connect(m_graphicsScene->undoStack(), SIGNAL(canUndoChanged(bool)),
+        connect(m_graphicsScene, SIGNAL(canUndoChanged(bool)),
                 this, SLOT(emitDocumentChanged()));
         connect(m_graphicsScene->undoStack(), SIGNAL(canRedoChanged(bool)),
                 this, SLOT(emitDocumentChanged()));
@@ -1332,7 +1441,7 @@ namespace Caneda
 
     bool SymbolDocument::canUndo() const
     {
-        return m_graphicsScene->undoStack()->canUndo();
+        return m_graphicsScene->canUndo();
     }
 
     bool SymbolDocument::canRedo() const
@@ -1342,7 +1451,7 @@ namespace Caneda
 
     void SymbolDocument::undo()
     {
-        m_graphicsScene->undoStack()->undo();
+        m_graphicsScene->undo();
     }
 
     void SymbolDocument::redo()
@@ -1456,9 +1565,9 @@ namespace Caneda
         m_graphicsScene->print(printer, fitInView);
     }
 
-    void SymbolDocument::exportImage(QPaintDevice &device)
+    void SymbolDocument::exportImage(QPaintDevice &device, bool gridVisible)
     {
-        m_graphicsScene->exportImage(device);
+        m_graphicsScene->exportImage(device, gridVisible);
     }
 
     QSizeF SymbolDocument::documentSize()
@@ -1474,6 +1583,10 @@ namespace Caneda
             FormatXmlSymbol *format = new FormatXmlSymbol(this);
             return format->load();
         }
+        else if(info.suffix() == "bsym") {
+            FormatBinary *format = new FormatBinary(this);
+            return format->load();
+        }
 
         if (errorMessage) {
             *errorMessage = tr("Unknown file format!");
@@ -1502,6 +1615,15 @@ namespace Caneda
             m_graphicsScene->undoStack()->clear();
             return true;
         }
+        else if(info.suffix() == "bsym") {
+            FormatBinary *format = new FormatBinary(this);
+            if(!format->save()) {
+                return false;
+            }
+
+            m_graphicsScene->undoStack()->clear();
+            return true;
+        }
 
         if(errorMessage) {
             *errorMessage = tr("Unknown file format!");
@@ -1568,7 +1690,9 @@ namespace Caneda
      *                            TextDocument                               *
      *************************************************************************/
     //! \brief Constructor.
-    TextDocument::TextDocument(QObject *parent) : IDocument(parent)
+    TextDocument::TextDocument(QObject *parent) :
+        IDocument(parent),
+        m_simulationJob(-1)
     {
         m_textDocument = new QTextDocument;
         m_textDocument->setModified(false);
@@ -1581,11 +1705,15 @@ namespace Caneda
                 this, SLOT(emitDocumentChanged()));
         connect(m_textDocument, SIGNAL(contentsChanged()),
                 this, SLOT(onContentsChanged()));
+
+        connect(SimulationJobManager::instance(), SIGNAL(jobFinished(int)),
+                this, SLOT(simulationFinished(int)));
     }
 
     //! \brief Destructor.
     TextDocument::~TextDocument()
     {
+        SimulationJobManager::instance()->cancel(m_simulationJob);
         delete m_textDocument;
     }
 
@@ -1672,24 +1800,23 @@ namespace Caneda
      * file extension, and then open the waveform viewer (could be internal
      * or external acording to the user settings).
      *
-     * \sa simulationReady()
+     * Multistep simulations (for example, vhdl analysis, elaboration and
+     * run) are queued as a single job of the SimulationJobManager, so that
+     * each step starts once the previous one finishes without blocking the
+     * interface.
+     *
+     * \sa simulationFinished(), simulationReady()
      */
     void TextDocument::simulate()
     {
-        simulationErrorStatus = false;
-
         QFileInfo info(fileName());
         QString baseName = info.completeBaseName();
         QString suffix = info.suffix();
         QString path = info.path();
 
-        QProcess *simulationProcess = new QProcess(this);
-        simulationProcess->setWorkingDirectory(path);
-        simulationProcess->setProcessChannelMode(QProcess::MergedChannels);  // Output std:error and std:output together into the same file
-        simulationProcess->setStandardOutputFile(path + "/" + baseName + ".log", QIODevice::WriteOnly);  // Create a log file
-
-        connect(simulationProcess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(simulationLog(int)));
-
+        SimulationJob job;
+        job.workingDirectory = path;
+        job.logFile = path + "/" + baseName + ".log";  // Create a log file
 
         if (suffix == "net" || suffix == "cir" || suffix == "spc" || suffix == "sp") {
             // It is a netlist file, we should invoke a spice simulator in batch mode
@@ -1705,10 +1832,9 @@ namespace Caneda
             else if(settings->currentValue("sim/outputFormat").toString() == "ascii") {
                 env.insert("SPICE_ASCIIRAWFILE", "1"); // Add an environment variable
             }
-            simulationProcess->setProcessEnvironment(env);
+            job.environment = env;
 
-            // Start the simulation
-            simulationProcess->start(simulationCommand);
+            job.commands << simulationCommand;
         }
         else if (suffix == "vhd" || suffix == "vhdl") {
             // It is a vhdl file, we should invoke ghdl simulator
@@ -1720,21 +1846,24 @@ namespace Caneda
              *  compile.
              */
 
-            simulationProcess->start(QString("ghdl -a ") + fileName());  // Analize the files
-            simulationProcess->waitForFinished();
-            simulationProcess->start(QString("ghdl -e ") + baseName);  // Create the simulation
-            simulationProcess->waitForFinished();
-            simulationProcess->start(QString("./") + baseName + " --wave=waveforms.ghw");  // Run the simulation
+            job.commands << QString("ghdl -a ") + fileName();  // Analize the files
+            job.commands << QString("ghdl -e ") + baseName;  // Create the simulation
+            job.commands << QString("./") + baseName + " --wave=waveforms.ghw";  // Run the simulation
         }
         else if (suffix == "v") {
             // Is is a verilog file, we should invoke iverilog
-            simulationProcess->start(QString("iverilog ") + fileName());  // Analize the files
-            simulationProcess->waitForFinished();
-            simulationProcess->start(QString("./a.out"));  // Run the simulation
+            job.commands << QString("iverilog ") + fileName();  // Analize the files
+            job.commands << QString("./a.out");  // Run the simulation
         }
 
-        // The simulation results are opened in the simulationReady slot, to achieve non-modal simulations
-        connect(simulationProcess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(simulationReady(int)));
+        if(job.commands.isEmpty()) {
+            return;
+        }
+
+        // The simulation results are opened in the simulationFinished slot, to achieve non-modal simulations
+        SimulationJobManager *jobManager = SimulationJobManager::instance();
+        jobManager->cancel(m_simulationJob);
+        m_simulationJob = jobManager->addJob(job);
     }
 
     void TextDocument::print(QPrinter *printer, bool fitInView)
@@ -1854,22 +1983,47 @@ namespace Caneda
     }
 
     /*!
-     * \brief Open simulation results.
+     * \brief Handle the end of a simulation job.
+     *
+     * This slot is invoked by the SimulationJobManager every time a job
+     * finishes. Jobs not belonging to this document are ignored. If the
+     * simulation failed the log is opened, otherwise the waveforms are shown.
      *
-     * Once a simulation is started, the simulation process is connected to
-     * this slot, to achive non-modal simulations (ie, the gui is responsive
-     * during simulations).
+     * \sa simulate(), simulationReady(), simulationLog()
+     */
+    void TextDocument::simulationFinished(int job)
+    {
+        if(job != m_simulationJob) {
+            return;
+        }
+
+        SimulationJobManager *jobManager = SimulationJobManager::instance();
+        SimulationJobManager::JobStatus status = jobManager->status(job);
+        jobManager->removeJob(job);
+        m_simulationJob = -1;
+
+        if(status == SimulationJobManager::Canceled) {
+            return;
+        }
+
+        bool error = status != SimulationJobManager::Finished;
+        simulationLog(error);
+        simulationReady(error);
+    }
+
+    /*!
+     * \brief Open simulation results.
      *
      * Once the simulation has finished, this slot is invoked and if no error
      * ocurred, simulation results are shown to the user. The waveform viewer
      * can be internal or external acording to the user settings.
      *
-     * \sa simulate()
+     * \sa simulate(), simulationFinished()
      */
     void TextDocument::simulationReady(int error)
     {
         // If there was any error during the process, do not display the waveforms
-        if(error || simulationErrorStatus) {
+        if(error) {
             return;
         }
 
@@ -1914,8 +2068,6 @@ namespace Caneda
 
         // If there was any error during the process, open the log
         if(error) {
-            simulationErrorStatus = true;
-
             DocumentViewManager *manager = DocumentViewManager::instance();
             manager->openFile(QDir::toNativeSeparators(path + "/" + baseName + ".log"));
         }
@@ -24,10 +24,13 @@
 #include <QObject>
 #include <QGraphicsSceneEvent>
 
+#include <QDateTime>
+
 // Forward declarations
 class QPaintDevice;
 class QPrinter;
 class QTextDocument;
+class QTimer;
 
 namespace Caneda
 {
@@ -35,10 +38,13 @@ namespace Caneda
     class GraphicsScene;
     class ChartScene;
     class DocumentViewManager;
+    class FormatRawSimulation;
     class IContext;
     class IView;
     class TextEdit;
 
+    struct SimulationJob;
+
     /*************************************************************************
      *                    General IDocument Structure                        *
      *************************************************************************/
@@ -102,7 +108,7 @@ namespace Caneda
 
         virtual bool printSupportsFitInPage() const = 0;
         virtual void print(QPrinter *printer, bool fitInPage) = 0;
-        virtual void exportImage(QPaintDevice &device) = 0;
+        virtual void exportImage(QPaintDevice &device, bool gridVisible = false) = 0;
         virtual QSizeF documentSize() = 0;
 
         virtual bool load(QString *errorMessage = 0) = 0;
@@ -191,7 +197,7 @@ namespace Caneda
 
         virtual bool printSupportsFitInPage() const  { return true; }
         virtual void print(QPrinter *printer, bool fitInView);
-        virtual void exportImage(QPaintDevice &device);
+        virtual void exportImage(QPaintDevice &device, bool gridVisible = false);
         virtual QSizeF documentSize();
 
         virtual bool load(QString *errorMessage = 0);
@@ -271,7 +277,7 @@ namespace Caneda
 
         virtual bool printSupportsFitInPage() const { return true; }
         virtual void print(QPrinter *printer, bool fitInView);
-        virtual void exportImage(QPaintDevice &device);
+        virtual void exportImage(QPaintDevice &device, bool gridVisible = false);
         virtual QSizeF documentSize();
 
         virtual bool load(QString *errorMessage = 0);
@@ -285,14 +291,22 @@ namespace Caneda
 
         GraphicsScene* graphicsScene() const { return m_graphicsScene; }
 
+        SimulationJob simulationJob(bool expandFileName = true) const;
+
     private Q_SLOTS:
+        void simulationFinished(int job);
         void simulationReady(int error);
-        bool simulationError();
+        void simulationError();
         void showSimulationHelp();
+        void followSimulation();
 
     private:
         GraphicsScene *m_graphicsScene;
 
+        int m_simulationJob;  // Id of the running simulation job, or -1
+        QTimer *m_followTimer;  // Timer used to wait for the raw file to be created
+        QDateTime m_simulationStart;  // Start time of the last simulation
+
         void alignElements(Qt::Alignment alignment);
         bool performBasicChecks();
     };
@@ -357,7 +371,7 @@ namespace Caneda
 
         virtual bool printSupportsFitInPage() const { return false; }
         virtual void print(QPrinter *printer, bool fitInView);
-        virtual void exportImage(QPaintDevice &device);
+        virtual void exportImage(QPaintDevice &device, bool gridVisible = false);
         virtual QSizeF documentSize();
 
         virtual bool load(QString *errorMessage = 0);
@@ -371,8 +385,11 @@ namespace Caneda
 
         ChartScene* chartScene() const { return m_chartScene; }
 
+        void setFollowing(bool following);
+
     private:
         ChartScene *m_chartScene;
+        FormatRawSimulation *m_rawFormat;  // Raw file parser, kept to follow the file
     };
 
     /*!
@@ -435,7 +452,7 @@ namespace Caneda
 
         virtual bool printSupportsFitInPage() const { return true; }
         virtual void print(QPrinter *printer, bool fitInView);
-        virtual void exportImage(QPaintDevice &device);
+        virtual void exportImage(QPaintDevice &device, bool gridVisible = false);
         virtual QSizeF documentSize();
 
         virtual bool load(QString *errorMessage = 0);
@@ -515,7 +532,7 @@ namespace Caneda
 
         virtual bool printSupportsFitInPage() const { return false; }
         virtual void print(QPrinter *printer, bool fitInView);
-        virtual void exportImage(QPaintDevice &device) {}
+        virtual void exportImage(QPaintDevice &device, bool gridVisible = false) {}
         virtual QSizeF documentSize();
 
         virtual bool load(QString *errorMessage = 0);
@@ -533,11 +550,12 @@ namespace Caneda
 
     private Q_SLOTS:
         void onContentsChanged();
+        void simulationFinished(int job);
         void simulationReady(int error);
         void simulationLog(int error);
 
     private:
-        bool simulationErrorStatus; //! This variable is used in multistep simulations (eg. verilog) to avoid opening previously generated waveforms
+        int m_simulationJob;  // Id of the running simulation job, or -1
         TextEdit* activeTextEdit();
         QTextDocument *m_textDocument;
     };
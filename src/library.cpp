@@ -22,6 +22,7 @@
 
 #include "fileformats.h"
 #include "global.h"
+#include "librarycache.h"
 #include "settings.h"
 #include "xmlutilities.h"
 
@@ -32,7 +33,7 @@
 #include <QPainter>
 #include <QPixmapCache>
 #include <QString>
-#include <QTextStream>
+#include <QtConcurrentMap>
 
 namespace Caneda
 {
@@ -54,29 +55,28 @@ namespace Caneda
             m_componentHash[name] : ComponentDataPtr();
     }
 
-    //! \brief Loads the library's components and its translated name.
-    bool Library::loadLibrary()
+    /*!
+     * \brief Loads the library translated name.
+     *
+     * Checks if the translations file exists and can be opened. This file is
+     * necessary to hold the library names in different languages. If this
+     * file isn't present, the default library name is chosen (base dir).
+     *
+     * \return False if the library directory doesn't exist or the
+     * translations file is invalid, true otherwise.
+     */
+    bool Library::loadTranslations()
     {
-        // Go to base library dir
-        QString current = QDir::currentPath();
-        if(!QDir::setCurrent(m_libraryPath)) {
-            QDir::setCurrent(current);
+        QDir libraryDir(m_libraryPath);
+        if(!libraryDir.exists()) {
             return false;
         }
 
         bool readOk = true;
-        // Check if translations file exists and can be opened.
-        // This file is necessary to hold the library names in
-        // different languages. In this file isn't present, the
-        // default library name is chosen (base dir).
-        QFile file("translations.xml");
+        QFile file(libraryDir.absoluteFilePath("translations.xml"));
         if(file.open(QIODevice::ReadOnly)) {
             // Read the translations file
-            QTextStream in(&file);
-            in.setCodec("UTF-8");
-            QByteArray data = in.readAll().toUtf8();
-
-            Caneda::XmlReader reader(data);
+            Caneda::XmlReader reader(&file);
             while(!reader.atEnd()) {
                 reader.readNext();
 
@@ -117,32 +117,100 @@ namespace Caneda
 
         }
 
-        QDir libraryPath(m_libraryPath);
-        QStringList componentsList = libraryPath.entryList(QStringList("*.xsym"));  // Filter only component files
-        foreach (const QString &componentPath, componentsList) {
-            // Read all components in the library path
-            ComponentData *component = new ComponentData();
-            component->library = libraryName();
-            component->filename = componentPath;
+        return readOk;
+    }
 
-            FormatXmlSymbol format(component, this);
-            readOk = readOk & format.load();
+    /*!
+     * \brief Returns the absolute paths of the component files in the
+     * library directory.
+     *
+     * Absolute paths are used so that components can be loaded without
+     * changing the application current directory.
+     */
+    QStringList Library::componentFiles() const
+    {
+        QDir libraryDir(m_libraryPath);
+        QStringList componentsList = libraryDir.entryList(QStringList("*.xsym"));  // Filter only component files
+
+        QStringList files;
+        foreach(const QString &componentPath, componentsList) {
+            files << libraryDir.absoluteFilePath(componentPath);
+        }
 
-            if(!readOk) {
+        return files;
+    }
+
+    /*!
+     * \brief Reads a component from the file \a filePath.
+     *
+     * This method is reentrant and doesn't access the library, so that
+     * several components can be read at the same time from different
+     * threads. Only plain data is created: the symbol paintings, which are
+     * graphics items, are kept as xml and drawn later from the gui thread by
+     * FormatXmlSymbol::loadComponentSymbol().
+     *
+     * \return The new component data on success, or a null pointer if the
+     * file could not be parsed.
+     *
+     * \sa addComponents()
+     */
+    ComponentData* Library::loadComponent(const QString &filePath)
+    {
+        ComponentData *component = new ComponentData();
+        component->filename = filePath;
+
+        FormatXmlSymbol format(component);
+        if(!format.load()) {
+            delete component;
+            return 0;
+        }
+
+        return component;
+    }
+
+    /*!
+     * \brief Adds the components read by loadComponent() to the library.
+     *
+     * Each component in \a components corresponds to the file in \a files
+     * at the same position, being a null pointer if the file failed to load.
+     * Only the first component with a given name is added, and its symbol is
+     * registered in the LibraryManager. This method must be called from the
+     * gui thread.
+     *
+     * \return False if any of the components failed to load.
+     *
+     * \sa loadComponent()
+     */
+    bool Library::addComponents(const QStringList &files, const QList<ComponentData*> &components)
+    {
+        bool readOk = true;
+        LibraryManager *libraryManager = LibraryManager::instance();
+
+        for(int i = 0; i < components.size(); ++i) {
+            ComponentData *component = components.at(i);
+
+            if(!component) {
                 QMessageBox::warning(0, QObject::tr("Error"),
                                      QObject::tr("Parsing component data file %1 failed")
-                                     .arg(QFileInfo(componentPath).absoluteFilePath()));
+                                     .arg(files.at(i)));
+                readOk = false;
+                continue;
             }
-            else {
-                // Register component's data
-                if(!m_componentHash.contains(component->name)) {
-                    ComponentDataPtr componentDataPtr(component);
-                    m_componentHash.insert(component->name, componentDataPtr);
-                }
+
+            // Register component's data
+            if(m_componentHash.contains(component->name)) {
+                delete component;
+                continue;
             }
+
+            component->library = libraryName();
+            component->compileModels();
+            libraryManager->registerComponent(component->name, component->library, component->symbol);
+
+            ComponentDataPtr componentDataPtr(component);
+            m_componentHash.insert(component->name, componentDataPtr);
         }
 
-        QDir::setCurrent(current);
         return readOk;
     }
 
@@ -179,11 +247,8 @@ namespace Caneda
     //! \brief Create library indicated by path \a libPath.
     bool LibraryManager::newLibrary(const QString& libPath)
     {
-        // Go to base dir
-        QString libParentPath = QFileInfo(libPath).dir().absolutePath();
-        QString current = QDir::currentPath();
-        if(!QDir::setCurrent(libParentPath)) {
-            (void) QDir::setCurrent(current);
+        // Check the base dir exists
+        if(!QFileInfo(libPath).dir().exists()) {
             return false;
         }
 
@@ -195,24 +260,7 @@ namespace Caneda
     //! \brief Load library indicated by path \a libPath.
     bool LibraryManager::load(const QString& libPath)
     {
-        Library *info = new Library(libPath);
-        bool loaded = info->loadLibrary();
-
-        if(!loaded) {
-            delete info;
-            return false;
-        }
-
-        if(library(info->libraryName())) {
-            QMessageBox::critical(0, QObject::tr("Error"),
-                                  QObject::tr("Only one library %1 can be opened at the same time. Please remove one of the "
-                                              "libraries named %1 from the library tree first.").arg(info->libraryName()));
-            delete info;
-            return false;
-        }
-
-        m_libraryHash.insert(info->libraryName(), info);
-        return true;
+        return loadLibraries(QStringList(libPath));
     }
 
     //! \brief Unloads given library freeing memory pool.
@@ -229,18 +277,134 @@ namespace Caneda
     //! \brief Load the library tree
     bool LibraryManager::loadLibraryTree()
     {
-        bool status = true;
-
         Settings *settings = Settings::instance();
         QStringList libraries;
         libraries << settings->currentValue("libraries/schematic").toStringList();
-        foreach (const QString &str, libraries) {
-            status = status && load(str);
+
+        return loadLibraries(libraries);
+    }
+
+    /*!
+     * \brief Loads the libraries indicated by the paths \a libPaths.
+     *
+     * Components whose symbol files didn't change since the last run are
+     * taken from each library LibraryCache. The remaining component files of
+     * all libraries are parsed at once on the global thread pool, instead of
+     * one library after the other, and stored back in the caches. The
+     * resulting components are then added to their libraries in order, so
+     * that the outcome doesn't depend on the order the files were parsed in.
+     *
+     * \return True if all libraries were successfully loaded.
+     *
+     * \sa Library::loadComponent(), Library::addComponents(), LibraryCache
+     */
+    bool LibraryManager::loadLibraries(const QStringList &libPaths)
+    {
+        bool status = true;
+
+        QList<Library*> libraries;
+        QList<LibraryCache*> caches;
+        QList<bool> translationsOk;
+        QList<int> fileCounts;
+        QStringList files;
+
+        QList<ComponentData*> components;
+        QStringList pendingFiles;
+        QList<int> pendingIndexes;
+
+        foreach(const QString &libPath, libPaths) {
+            Library *info = new Library(libPath);
+            translationsOk << info->loadTranslations();
+
+            LibraryCache *cache = new LibraryCache(libPath);
+            cache->load();
+
+            QStringList libraryFiles = info->componentFiles();
+            foreach(const QString &file, libraryFiles) {
+                ComponentData *component = cache->component(file);
+                if(!component) {
+                    pendingFiles << file;
+                    pendingIndexes << components.size();
+                }
+                components << component;
+            }
+
+            fileCounts << libraryFiles.size();
+            files << libraryFiles;
+
+            libraries << info;
+            caches << cache;
+        }
+
+        // Parse only the files missing from the caches
+        QList<ComponentData*> parsed =
+            QtConcurrent::blockingMapped<QList<ComponentData*> >(pendingFiles, &Library::loadComponent);
+
+        for(int i = 0; i < parsed.size(); ++i) {
+            // Draw the symbols in the gui thread, before they are cached
+            if(parsed.at(i)) {
+                FormatXmlSymbol format(parsed.at(i));
+                format.loadComponentSymbol();
+            }
+
+            components[pendingIndexes.at(i)] = parsed.at(i);
+        }
+
+        int first = 0;
+        int pending = 0;
+        for(int i = 0; i < libraries.size(); ++i) {
+            Library *info = libraries.at(i);
+            LibraryCache *cache = caches.at(i);
+            int count = fileCounts.at(i);
+
+            // Update the cache before the components are handed to the library
+            while(pending < pendingIndexes.size() && pendingIndexes.at(pending) < first + count) {
+                cache->setComponent(pendingFiles.at(pending), parsed.at(pending));
+                ++pending;
+            }
+
+            cache->removeMissing(files.mid(first, count));
+            if(cache->isModified()) {
+                cache->save();
+            }
+            delete cache;
+
+            bool loaded = info->addComponents(files.mid(first, count), components.mid(first, count));
+            loaded = loaded && translationsOk.at(i);
+            first += count;
+
+            if(!loaded) {
+                delete info;
+                status = false;
+                continue;
+            }
+
+            status = addLibrary(info) && status;
         }
 
         return status;
     }
 
+    /*!
+     * \brief Adds the loaded library \a info to the libraries list.
+     *
+     * Only one library with a given name can be opened at the same time. If
+     * a library with the same name is already present, \a info is deleted.
+     */
+    bool LibraryManager::addLibrary(Library *info)
+    {
+        if(library(info->libraryName())) {
+            QMessageBox::critical(0, QObject::tr("Error"),
+                                  QObject::tr("Only one library %1 can be opened at the same time. Please remove one of the "
+                                              "libraries named %1 from the library tree first.").arg(info->libraryName()));
+            delete info;
+            return false;
+        }
+
+        m_libraryHash.insert(info->libraryName(), info);
+        return true;
+    }
+
     /*!
      * \brief Returns library item corresponding to name.
      *
@@ -334,9 +498,7 @@ namespace Caneda
             QPainter painter(&pix);
             painter.setRenderHints(Caneda::DefaulRenderHints);
 
-            Settings *settings = Settings::instance();
-            painter.setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                settings->currentValue("gui/lineWidth").toInt()));
+            painter.setPen(Settings::instance()->renderSettings().linePen);
 
             QPointF offset = -rect.topLeft(); // (0,0)-topLeft()
             painter.translate(offset);
@@ -36,6 +36,11 @@ namespace Caneda
      * component referencing, etc.). This class also handles the loading of all
      * components in a library at once.
      *
+     * Component files are parsed in parallel on the global thread pool by
+     * the reentrant loadComponent() method, into plain data. The results are
+     * then added to the library from the gui thread by addComponents(), which
+     * also reports errors and registers the components symbols.
+     *
      * \sa LibraryManager, Component
      */
     class Library : public QObject
@@ -54,9 +59,14 @@ namespace Caneda
         //! Returns the components list.
         const QList<QString> componentsList() const { return m_componentHash.uniqueKeys(); }
 
-        bool loadLibrary();
         bool removeComponent(QString componentName);
 
+        bool loadTranslations();
+        QStringList componentFiles() const;
+        bool addComponents(const QStringList &files, const QList<ComponentData*> &components);
+
+        static ComponentData* loadComponent(const QString &filePath);
+
     private:
         //! Library name. If not specified in "translations.xml", it is the base dir name.
         QString m_libraryName;
@@ -114,6 +124,9 @@ namespace Caneda
     private:
         explicit LibraryManager(QObject *parent = 0);
 
+        bool loadLibraries(const QStringList &libPaths);
+        bool addLibrary(Library *info);
+
         //! Hash table to hold libraries.
         QHash<QString, Library*> m_libraryHash;
 
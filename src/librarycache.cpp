@@ -0,0 +1,272 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "librarycache.h"
+
+#include "component.h"
+#include "global.h"
+#include "port.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+
+namespace Caneda
+{
+    /*!
+     * \brief Constructs an empty cache for the library in \a libraryPath.
+     *
+     * The cache file name is derived from the library absolute path, so that
+     * libraries with the same name in different directories (for example,
+     * user libraries added to the library tree) don't share the same cache.
+     */
+    LibraryCache::LibraryCache(const QString &libraryPath) :
+        m_modified(false)
+    {
+        QByteArray path = QDir(libraryPath).absolutePath().toUtf8();
+        QString key = QCryptographicHash::hash(path, QCryptographicHash::Sha1).toHex();
+
+        QString cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        m_fileName = QDir(cachePath).filePath("libraries/" + key + ".cache");
+    }
+
+    /*!
+     * \brief Reads the cache file.
+     *
+     * \return True if the cache was read, false if it doesn't exist or was
+     * discarded. In the latter case, the cache is left empty.
+     */
+    bool LibraryCache::load()
+    {
+        m_entries.clear();
+        m_modified = false;
+
+        QFile file(m_fileName);
+        if(!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        quint32 magic, version;
+        QString canedaVersion, locale;
+        stream >> magic >> version >> canedaVersion >> locale;
+
+        if(magic != quint32(Magic) || version != quint32(Version) ||
+                canedaVersion != Caneda::version() || locale != Caneda::localePrefix()) {
+            return false;
+        }
+
+        quint32 count;
+        stream >> count;
+
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QString filePath;
+            CacheEntry entry;
+            stream >> filePath >> entry.modified >> entry.size >> entry.data;
+            m_entries.insert(filePath, entry);
+        }
+
+        if(stream.status() != QDataStream::Ok) {
+            qWarning() << "\nWarning: Discarding corrupt library cache" << m_fileName;
+            m_entries.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Writes the cache file, creating the cache directory if needed.
+     *
+     * The file is written atomically, so an interrupted write never leaves a
+     * truncated cache behind.
+     */
+    bool LibraryCache::save()
+    {
+        if(!QFileInfo(m_fileName).dir().mkpath(".")) {
+            return false;
+        }
+
+        QSaveFile file(m_fileName);
+        if(!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        stream << quint32(Magic) << quint32(Version);
+        stream << Caneda::version() << Caneda::localePrefix();
+        stream << quint32(m_entries.size());
+
+        QHash<QString, CacheEntry>::const_iterator it;
+        for(it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            stream << it.key() << it->modified << it->size << it->data;
+        }
+
+        if(stream.status() != QDataStream::Ok || !file.commit()) {
+            qWarning() << "\nWarning: Cannot write library cache" << m_fileName;
+            return false;
+        }
+
+        m_modified = false;
+        return true;
+    }
+
+    /*!
+     * \brief Returns the cached component of the symbol file \a filePath.
+     *
+     * \return A new component data, or a null pointer if the file is not
+     * cached or was modified after being cached.
+     */
+    ComponentData* LibraryCache::component(const QString &filePath) const
+    {
+        QHash<QString, CacheEntry>::const_iterator it = m_entries.constFind(filePath);
+        if(it == m_entries.constEnd()) {
+            return 0;
+        }
+
+        QFileInfo info(filePath);
+        if(info.lastModified().toMSecsSinceEpoch() != it->modified || info.size() != it->size) {
+            return 0;
+        }
+
+        QDataStream stream(it->data);
+        stream.setVersion(QDataStream::Qt_5_3);
+
+        ComponentData *component = readComponent(stream);
+        if(stream.status() != QDataStream::Ok) {
+            delete component;
+            return 0;
+        }
+
+        component->filename = filePath;
+        return component;
+    }
+
+    /*!
+     * \brief Stores \a component as the contents of the symbol file
+     * \a filePath.
+     *
+     * If \a component is a null pointer (the file couldn't be parsed), the
+     * file is removed from the cache instead.
+     */
+    void LibraryCache::setComponent(const QString &filePath, const ComponentData *component)
+    {
+        m_modified = true;
+
+        if(!component) {
+            m_entries.remove(filePath);
+            return;
+        }
+
+        QFileInfo info(filePath);
+
+        CacheEntry entry;
+        entry.modified = info.lastModified().toMSecsSinceEpoch();
+        entry.size = info.size();
+
+        QDataStream stream(&entry.data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_3);
+        writeComponent(stream, component);
+
+        m_entries.insert(filePath, entry);
+    }
+
+    //! \brief Discards the cached components whose files are not in \a files.
+    void LibraryCache::removeMissing(const QStringList &files)
+    {
+        QSet<QString> existing = files.toSet();
+
+        QHash<QString, CacheEntry>::iterator it = m_entries.begin();
+        while(it != m_entries.end()) {
+            if(!existing.contains(it.key())) {
+                it = m_entries.erase(it);
+                m_modified = true;
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    //! \brief Serializes the data of \a component into \a stream.
+    void LibraryCache::writeComponent(QDataStream &stream, const ComponentData *component)
+    {
+        stream << component->name << component->displayText
+               << component->labelPrefix << component->description;
+
+        stream << quint32(component->ports.size());
+        foreach(const PortData *port, component->ports) {
+            stream << port->pos << port->name;
+        }
+
+        stream << quint32(component->properties.size());
+        foreach(const Property &property, component->properties) {
+            stream << property.name() << property.value()
+                   << property.description() << property.isVisible();
+        }
+
+        stream << component->models << component->symbol;
+    }
+
+    /*!
+     * \brief Creates a new component from the data in \a stream.
+     *
+     * \sa writeComponent()
+     */
+    ComponentData* LibraryCache::readComponent(QDataStream &stream)
+    {
+        ComponentData *component = new ComponentData();
+
+        stream >> component->name >> component->displayText
+               >> component->labelPrefix >> component->description;
+
+        quint32 count;
+        stream >> count;
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QPointF pos;
+            QString name;
+            stream >> pos >> name;
+            component->ports << new PortData(pos, name);
+        }
+
+        stream >> count;
+        for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QString name, value, description;
+            bool visible;
+            stream >> name >> value >> description >> visible;
+            component->properties.insert(name, Property(name, value, description, visible));
+        }
+
+        stream >> component->models >> component->symbol;
+
+        return component;
+    }
+
+} // namespace Caneda
@@ -0,0 +1,99 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef LIBRARY_CACHE_H
+#define LIBRARY_CACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Forward declarations
+class QDataStream;
+
+namespace Caneda
+{
+    // Forward declarations
+    struct ComponentData;
+
+    /*!
+     * \brief The LibraryCache class keeps a binary copy of the components of
+     * a library on disk.
+     *
+     * Parsing the xml symbol files of all libraries is the most expensive
+     * part of Caneda's startup. To avoid it, once a component is read its
+     * data (ports, properties, models and symbol drawing) is serialized with
+     * QDataStream, and stored in a cache file specific to its library under
+     * the user cache directory (XDG_CACHE_HOME on unix systems).
+     *
+     * Each cached component is tagged with the modification time and size of
+     * its symbol file. A component is only taken from the cache if its file
+     * is unchanged, otherwise the file must be parsed again and the cache
+     * updated with setComponent(). The whole cache is discarded if it was
+     * written by a different Caneda version or for a different locale, as
+     * the component descriptions are localized.
+     *
+     * \sa Library, LibraryManager
+     */
+    class LibraryCache
+    {
+    public:
+        explicit LibraryCache(const QString &libraryPath);
+
+        bool load();
+        bool save();
+
+        ComponentData* component(const QString &filePath) const;
+        void setComponent(const QString &filePath, const ComponentData *component);
+        void removeMissing(const QStringList &files);
+
+        //! Returns true if the cache changed since it was loaded.
+        bool isModified() const { return m_modified; }
+
+    private:
+        enum {
+            //! Magic number identifying library cache files ("CLIB").
+            Magic = 0x434c4942,
+            //! Version of the cache format, to be increased on every change.
+            Version = 1
+        };
+
+        //! \brief Cached data of one symbol file.
+        struct CacheEntry
+        {
+            qint64 modified;
+            qint64 size;
+            QByteArray data;
+        };
+
+        static void writeComponent(QDataStream &stream, const ComponentData *component);
+        static ComponentData* readComponent(QDataStream &stream);
+
+        //! Cache file of this library.
+        QString m_fileName;
+        //! Cached components, indexed by their symbol file absolute path.
+        QHash<QString, CacheEntry> m_entries;
+        //! Set when the entries differ from the cache file contents.
+        bool m_modified;
+    };
+
+} // namespace Caneda
+
+#endif //LIBRARY_CACHE_H
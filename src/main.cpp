@@ -20,6 +20,7 @@
 
 #include "mainwindow.h"
 
+#include "batchprocessor.h"
 #include "global.h"
 
 #include <QApplication>
@@ -28,6 +29,14 @@
 
 int main(int argc,char *argv[])
 {
+    // In batch mode no window is shown, so use the offscreen platform to be
+    // able to run without a display. A QApplication is still needed, as the
+    // schematic scenes and waveform plots are made of gui classes.
+    bool batchMode = argc > 1 && Caneda::BatchProcessor::isBatchCommand(argv[1]);
+    if(batchMode && qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     // Configure the application
     QApplication app(argc,argv);
     app.setOrganizationName("Caneda");
@@ -39,9 +48,17 @@ int main(int argc,char *argv[])
     translator.load(QLocale::system(), "caneda", "_", Caneda::langDirectory(), ".qm");
     app.installTranslator(&translator);
 
+    // Run the batch command, if any
+    if(batchMode) {
+        Caneda::BatchProcessor processor;
+        return processor.exec(app.arguments());
+    }
+
     // Parse the command line options
     QCommandLineParser parser;
-    parser.setApplicationDescription(app.applicationName());
+    parser.setApplicationDescription(app.applicationName() + "\n\n"
+            "Batch mode: caneda netlist|simulate|export [options] files\n"
+            "Run caneda <command> --help for the batch mode options.");
     parser.addHelpOption();
     parser.addVersionOption();
     parser.addPositionalArgument("[files]", "Files to open.");
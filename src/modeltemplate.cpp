@@ -0,0 +1,206 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "modeltemplate.h"
+
+namespace Caneda
+{
+    //! \brief Compiles \a model into a new template.
+    ModelTemplate::ModelTemplate(const QString &model)
+    {
+        compile(model, 0, model.size());
+    }
+
+    /*!
+     * \brief Appends the instructions of the model text between \a begin and
+     * \a end to the program.
+     *
+     * Escape sequences are recognized by their keyword alone, so "%labelA"
+     * is the label followed by the text "A". Unknown
+     * escape sequences and sequences missing their closing brace are copied
+     * as literal text.
+     */
+    void ModelTemplate::compile(const QString &model, int begin, int end)
+    {
+        QString text;
+        int i = begin;
+
+        while(i < end) {
+            if(model.at(i) != '%') {
+                text += model.at(i++);
+                continue;
+            }
+
+            QStringRef rest = model.midRef(i + 1, end - i - 1);
+
+            // Simple escape sequences, without arguments
+            Opcode opcode = Text;
+            int length = 0;
+            if(rest.startsWith("librarypath")) {
+                opcode = LibraryPath;
+                length = 11;
+            }
+            else if(rest.startsWith("label")) {
+                opcode = Label;
+                length = 5;
+            }
+            else if(rest.startsWith("filepath")) {
+                opcode = FilePath;
+                length = 8;
+            }
+            else if(rest.startsWith("generateNetlist")) {
+                opcode = GenerateNetlist;
+                length = 15;
+            }
+            else if(rest.startsWith("n")) {
+                // New line, copied as text
+                text += '\n';
+                i += 2;
+                continue;
+            }
+
+            if(opcode != Text) {
+                if(!text.isEmpty()) {
+                    appendInstruction(Text, text);
+                    text.clear();
+                }
+                appendInstruction(opcode);
+                i += 1 + length;
+                continue;
+            }
+
+            // Escape sequences with arguments
+            if(rest.startsWith("property{")) {
+                opcode = Property;
+                length = 9;
+            }
+            else if(rest.startsWith("port{")) {
+                opcode = Port;
+                length = 5;
+            }
+            else if(rest.startsWith("if{")) {
+                opcode = If;
+                length = 3;
+            }
+            else if(rest.startsWith("model{")) {
+                opcode = Model;
+                length = 6;
+            }
+            else if(rest.startsWith("subcircuit{")) {
+                opcode = Subcircuit;
+                length = 11;
+            }
+            else if(rest.startsWith("directive{")) {
+                opcode = Directive;
+                length = 10;
+            }
+
+            int argumentsBegin = i + 1 + length;
+            int argumentsEnd = opcode != Text ? closingBrace(model, argumentsBegin, end) : -1;
+
+            if(argumentsEnd < 0) {
+                text += model.at(i++);
+                continue;
+            }
+
+            if(!text.isEmpty()) {
+                appendInstruction(Text, text);
+                text.clear();
+            }
+
+            if(opcode == Port || opcode == Property) {
+                appendInstruction(opcode, model.mid(argumentsBegin, argumentsEnd - argumentsBegin));
+            }
+            else {
+                int index = m_program.size();
+                appendInstruction(opcode);
+
+                // The condition of an %if ends at the first comma not
+                // enclosed in braces
+                int conditionEnd = argumentsEnd;
+                if(opcode == If) {
+                    int depth = 0;
+                    for(int j = argumentsBegin; j < argumentsEnd; ++j) {
+                        QChar c = model.at(j);
+                        if(c == '{') {
+                            ++depth;
+                        }
+                        else if(c == '}') {
+                            --depth;
+                        }
+                        else if(c == ',' && depth == 0) {
+                            conditionEnd = j;
+                            break;
+                        }
+                    }
+                }
+
+                compile(model, argumentsBegin, conditionEnd);
+                m_program[index].condition = m_program.size() - index - 1;
+
+                if(conditionEnd < argumentsEnd) {
+                    compile(model, conditionEnd + 1, argumentsEnd);
+                }
+                m_program[index].size = m_program.size() - index - 1;
+            }
+
+            i = argumentsEnd + 1;
+        }
+
+        if(!text.isEmpty()) {
+            appendInstruction(Text, text);
+        }
+    }
+
+    //! \brief Appends a new instruction to the program.
+    void ModelTemplate::appendInstruction(Opcode opcode, const QString &text)
+    {
+        Instruction instruction;
+        instruction.opcode = opcode;
+        instruction.text = text;
+        instruction.size = 0;
+        instruction.condition = 0;
+
+        m_program.append(instruction);
+    }
+
+    /*!
+     * \brief Returns the index of the brace closing the arguments starting
+     * at \a begin, or -1 if there is none before \a end.
+     */
+    int ModelTemplate::closingBrace(const QString &model, int begin, int end)
+    {
+        int depth = 0;
+        for(int i = begin; i < end; ++i) {
+            QChar c = model.at(i);
+            if(c == '{') {
+                ++depth;
+            }
+            else if(c == '}') {
+                if(depth == 0) {
+                    return i;
+                }
+                --depth;
+            }
+        }
+
+        return -1;
+    }
+
+} // namespace Caneda
@@ -0,0 +1,103 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef MODEL_TEMPLATE_H
+#define MODEL_TEMPLATE_H
+
+#include <QString>
+#include <QVector>
+
+namespace Caneda
+{
+    /*!
+     * \brief The ModelTemplate class holds a component model compiled into a
+     * list of instructions.
+     *
+     * Component models are strings with escape sequences (for example
+     * "R%label %port{1} %port{2} %property{R}"), as described in
+     * \ref ModelsFormat. Instead of searching the escape sequences with
+     * regular expressions every time a component instance is exported, the
+     * model is parsed once into a flat program of instructions, which is
+     * then evaluated for each instance.
+     *
+     * Each instruction is either a literal text or an escape sequence.
+     * Escape sequences with arguments that may contain other escape
+     * sequences (%if, %model, %subcircuit and %directive) are followed in the
+     * program by the instructions of their arguments, and store the number of
+     * those instructions in Instruction::size. In the case of %if, the first
+     * Instruction::condition instructions are the condition, and the
+     * remaining ones the true value.
+     *
+     * The program is stored in an implicitly shared QVector, so copying a
+     * template (for example, along with the ComponentData of a library
+     * component) is cheap.
+     *
+     * \sa ComponentData, FormatSpice::generateNetlist(), \ref ModelsFormat
+     */
+    class ModelTemplate
+    {
+    public:
+        //! \brief Type of an instruction.
+        enum Opcode {
+            Text,            // Literal text
+            Label,           // %label
+            LibraryPath,     // %librarypath
+            FilePath,        // %filepath
+            Port,            // %port{name}
+            Property,        // %property{name}
+            If,              // %if{condition,value}
+            Model,           // %model{arguments}
+            Subcircuit,      // %subcircuit{arguments}
+            Directive,       // %directive{arguments}
+            GenerateNetlist  // %generateNetlist
+        };
+
+        //! \brief Single instruction of a compiled model.
+        struct Instruction
+        {
+            Opcode opcode;
+            //! Literal text, or port or property name.
+            QString text;
+            //! Number of argument instructions following this one.
+            int size;
+            //! Number of argument instructions forming the %if condition.
+            int condition;
+        };
+
+        ModelTemplate() {}
+        explicit ModelTemplate(const QString &model);
+
+        //! Returns true if the model has no instructions.
+        bool isEmpty() const { return m_program.isEmpty(); }
+        //! Returns the number of instructions of the model.
+        int size() const { return m_program.size(); }
+        //! Returns the instruction at index \a i.
+        const Instruction& at(int i) const { return m_program.at(i); }
+
+    private:
+        void compile(const QString &model, int begin, int end);
+        void appendInstruction(Opcode opcode, const QString &text = QString());
+        static int closingBrace(const QString &model, int begin, int end);
+
+        QVector<Instruction> m_program;
+    };
+
+} // namespace Caneda
+
+#endif //MODEL_TEMPLATE_H
@@ -0,0 +1,257 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "netdatabase.h"
+
+#include "port.h"
+
+namespace Caneda
+{
+    //! \brief Constructs an empty net database.
+    NetDatabase::NetDatabase() :
+        m_portCount(0)
+    {
+    }
+
+    /*!
+     * \brief Destructor.
+     *
+     * Ports still registered in the database are detached from it, so that
+     * they do not keep a dangling reference to the destroyed database.
+     */
+    NetDatabase::~NetDatabase()
+    {
+        for(int i = 0; i < m_members.size(); ++i) {
+            foreach(Port *port, m_members.at(i)) {
+                port->m_netDatabase = 0;
+                port->m_netId = -1;
+                port->m_netIndex = -1;
+            }
+        }
+    }
+
+    /*!
+     * \brief Joins the nodes of \a port and \a other into only one node.
+     *
+     * The members of the smaller node are appended to the bigger one, and
+     * the root of the smaller node is linked to the root of the bigger one.
+     * If both ports already belong to the same node, nothing is done.
+     */
+    void NetDatabase::connect(Port *port, Port *other)
+    {
+        int root = find(handle(port));
+        int otherRoot = find(handle(other));
+
+        if(root == otherRoot) {
+            return;
+        }
+
+        // Union by size: always merge the smaller node into the bigger one
+        if(m_members.at(root).size() < m_members.at(otherRoot).size()) {
+            qSwap(root, otherRoot);
+        }
+
+        QList<Port*> &members = m_members[root];
+        foreach(Port *p, m_members.at(otherRoot)) {
+            p->m_netIndex = members.size();
+            members.append(p);
+        }
+
+        m_members[otherRoot].clear();
+        m_parents[otherRoot] = root;
+    }
+
+    /*!
+     * \brief Removes \a port from its node.
+     *
+     * The remaining members of the node stay connected among themselves. The
+     * port is moved to a new singleton element, leaving its previous element
+     * as a dead internal node of the old tree.
+     */
+    void NetDatabase::disconnect(Port *port)
+    {
+        if(port->m_netDatabase != this) {
+            return;
+        }
+
+        int root = find(port->m_netId);
+        QList<Port*> &members = m_members[root];
+        if(members.size() <= 1) {
+            return;
+        }
+
+        // Swap-remove the port from the members list
+        int index = port->m_netIndex;
+        Port *last = members.last();
+        members[index] = last;
+        last->m_netIndex = index;
+        members.removeLast();
+
+        newElement(port);
+
+        if(m_parents.size() > 2*m_portCount + 64) {
+            compact();
+        }
+    }
+
+    /*!
+     * \brief Unregisters \a port from the database.
+     *
+     * This must be called when the port is destroyed or leaves the scene
+     * owning this database.
+     */
+    void NetDatabase::removePort(Port *port)
+    {
+        if(port->m_netDatabase != this) {
+            return;
+        }
+
+        disconnect(port);
+
+        // After the disconnection the port is the only member of its node
+        m_members[find(port->m_netId)].clear();
+
+        port->m_netDatabase = 0;
+        port->m_netId = -1;
+        port->m_netIndex = -1;
+        --m_portCount;
+    }
+
+    //! \brief Returns true if \a port and \a other belong to the same node.
+    bool NetDatabase::isConnected(const Port *port, const Port *other) const
+    {
+        if(port == other) {
+            return true;
+        }
+
+        if(port->m_netDatabase != this || other->m_netDatabase != this) {
+            return false;
+        }
+
+        return find(port->m_netId) == find(other->m_netId);
+    }
+
+    /*!
+     * \brief Returns the ports belonging to the node of \a port, including
+     * \a port itself.
+     *
+     * The returned list is implicitly shared with the database, so no copy
+     * of the node members is made unless the caller modifies the list.
+     */
+    QList<Port*> NetDatabase::connections(const Port *port) const
+    {
+        if(port->m_netDatabase != this) {
+            return QList<Port*>() << const_cast<Port*>(port);
+        }
+
+        return m_members.at(find(port->m_netId));
+    }
+
+    //! \brief Returns the number of ports in the node of \a port.
+    int NetDatabase::connectionCount(const Port *port) const
+    {
+        if(port->m_netDatabase != this) {
+            return 1;
+        }
+
+        return m_members.at(find(port->m_netId)).size();
+    }
+
+    /*!
+     * \brief Returns the element of \a port, registering the port in the
+     * database if needed.
+     */
+    int NetDatabase::handle(Port *port)
+    {
+        if(port->m_netDatabase == this) {
+            return port->m_netId;
+        }
+
+        if(port->m_netDatabase) {
+            port->m_netDatabase->removePort(port);
+        }
+
+        port->m_netDatabase = this;
+        ++m_portCount;
+
+        return newElement(port);
+    }
+
+    //! \brief Creates a new singleton element for \a port.
+    int NetDatabase::newElement(Port *port)
+    {
+        int id = m_parents.size();
+        m_parents.append(id);
+        m_members.append(QList<Port*>() << port);
+
+        port->m_netId = id;
+        port->m_netIndex = 0;
+
+        return id;
+    }
+
+    /*!
+     * \brief Returns the root element of \a id.
+     *
+     * Path halving is used as the path compression strategy, making every
+     * visited element point to its grandparent.
+     */
+    int NetDatabase::find(int id) const
+    {
+        while(m_parents.at(id) != id) {
+            m_parents[id] = m_parents.at(m_parents.at(id));
+            id = m_parents.at(id);
+        }
+
+        return id;
+    }
+
+    /*!
+     * \brief Discards dead elements, renumbering the remaining nodes.
+     *
+     * Every live node is stored again as a single root element holding all
+     * its members. This takes time proportional to the number of elements,
+     * but as it is only performed once the dead elements outnumber the
+     * registered ports, its amortized cost is constant.
+     */
+    void NetDatabase::compact()
+    {
+        QVector<int> parents;
+        QVector<QList<Port*> > members;
+
+        for(int i = 0; i < m_members.size(); ++i) {
+            const QList<Port*> &node = m_members.at(i);
+            if(node.isEmpty()) {
+                continue;
+            }
+
+            int id = parents.size();
+            parents.append(id);
+            members.append(node);
+
+            foreach(Port *port, node) {
+                port->m_netId = id;
+            }
+        }
+
+        m_parents = parents;
+        m_members = members;
+    }
+
+} // namespace Caneda
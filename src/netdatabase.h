@@ -0,0 +1,86 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef NET_DATABASE_H
+#define NET_DATABASE_H
+
+#include <QList>
+#include <QVector>
+
+namespace Caneda
+{
+    // Forward declarations
+    class Port;
+
+    /*!
+     * \brief The NetDatabase class keeps track of which ports of a scene are
+     * connected together.
+     *
+     * Each GraphicsScene owns one NetDatabase. Ports connected to each other
+     * (that is, ports sharing the same scene position and joined by
+     * Port::connectTo()) form a node, and every node is stored as a set of a
+     * disjoint-set forest (union-find) with path compression and union by
+     * size. This way, joining two big nodes costs time proportional to the
+     * smaller of the two, instead of copying the whole list of connections
+     * into every connected port.
+     *
+     * Union-find structures do not support removing elements. A disconnected
+     * port is therefore given a new singleton element, while its previous
+     * element is kept as an internal (dead) node of the tree it belonged to.
+     * Dead elements are periodically discarded by compact().
+     *
+     * Ports register themselves lazily, the first time they are connected.
+     * Ports which were never connected are not stored in the database at all,
+     * and are considered as nodes with only one member (the port itself).
+     *
+     * \sa Port, GraphicsScene
+     */
+    class NetDatabase
+    {
+    public:
+        NetDatabase();
+        ~NetDatabase();
+
+        void connect(Port *port, Port *other);
+        void disconnect(Port *port);
+        void removePort(Port *port);
+
+        bool isConnected(const Port *port, const Port *other) const;
+
+        QList<Port*> connections(const Port *port) const;
+        int connectionCount(const Port *port) const;
+
+    private:
+        int handle(Port *port);
+        int newElement(Port *port);
+        int find(int id) const;
+        void compact();
+
+        //! \brief Parent of each element. Roots are their own parents.
+        mutable QVector<int> m_parents;
+        //! \brief Members of each node, stored only at the root element.
+        QVector<QList<Port*> > m_members;
+
+        //! \brief Number of ports currently registered in the database.
+        int m_portCount;
+    };
+
+} // namespace Caneda
+
+#endif //NET_DATABASE_H
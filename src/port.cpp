@@ -20,45 +20,94 @@
 
 #include "port.h"
 
+#include "graphicsscene.h"
+#include "netdatabase.h"
 #include "settings.h"
+#include "spatialindex.h"
 #include "wire.h"
 
-#include <QGraphicsItem>
 #include <QPainter>
-#include <QStyleOptionGraphicsItem>
+#include <QSet>
 
 namespace Caneda
 {
+    //! \brief Constructs a port owned by the item \a parent.
+    Port::Port(GraphicsItem *parent) :
+        m_parent(parent),
+        m_netDatabase(0),
+        m_netId(-1),
+        m_netIndex(-1)
+    {
+    }
+
+    //! \brief Destroys the port object, removing all connections from the item
+    Port::~Port()
+    {
+        if(m_netDatabase) {
+            disconnect();
+            m_netDatabase->removePort(this);
+        }
+
+        SpatialIndex *index = spatialIndex();
+        if(index) {
+            index->removePort(this);
+        }
+    }
+
+    //! \brief Returns the scene of the parent item, or 0 if it has none.
+    QGraphicsScene* Port::scene() const
+    {
+        return m_parent->scene();
+    }
+
     /*!
-     * \brief Constructs a Port item with a GraphicsItem as \a parent and
-     * port's name \a portName.
+     * \brief Sets the position of the port, in parent coordinates, to \a pos.
+     *
+     * The parent is responsible for updating its geometry afterwards.
      */
-    Port::Port(GraphicsItem *parent) : QGraphicsItem(parent)
+    void Port::setPos(const QPointF &pos)
     {
-        // Set component flags
-        setFlag(ItemSendsGeometryChanges, true);
-        setFlag(ItemSendsScenePositionChanges, true);
+        if(m_pos == pos) {
+            return;
+        }
 
-        m_connections.append(this);
+        m_pos = pos;
+        scenePositionChanged();
     }
 
-    //! \brief Destroys the port object, removing all connections from the item
-    Port::~Port()
+    //! \brief Returns the position of the port in scene coordinates.
+    QPointF Port::scenePos() const
     {
-        disconnect();
+        return m_parent->mapToScene(m_pos);
+    }
+
+    //! \brief Returns the bounding rect of the port in scene coordinates.
+    QRectF Port::sceneBoundingRect() const
+    {
+        return m_parent->mapRectToScene(boundingRect());
     }
 
     /*!
-     *  \brief Returns a pointer to this item's parent item. If this item does
-     *  not have a parent, 0 is returned.
+     * \brief Returns the list of ports directly connected to this port.
+     *
+     * The list includes this port too, so a disconnected port returns a list
+     * with only one member.
+     *
+     * \sa connectionCount(), NetDatabase::connections()
      */
-    GraphicsItem* Port::parentItem() const
+    QList<Port*> Port::connections() const
     {
-        GraphicsItem *item = canedaitem_cast<GraphicsItem*>(QGraphicsItem::parentItem());
-        if(item) {
-            return item;
+        if(!m_netDatabase) {
+            return QList<Port*>() << const_cast<Port*>(this);
         }
-        return 0;
+
+        return m_netDatabase->connections(this);
+    }
+
+    //! \brief Returns the number of ports in connections(), without building the list.
+    int Port::connectionCount() const
+    {
+        return m_netDatabase ? m_netDatabase->connectionCount(this) : 1;
     }
 
     /*!
@@ -71,9 +120,10 @@ namespace Caneda
      *  netlist creation to determine each unique net and group all components
      *  connected ports under only one name.
      *
-     *  This method works in a recursive way, filling a list with the port
-     *  direct connections (contained in m_connections) and searching for
-     *  the connections of those ports connected to this one by a wire.
+     *  This method performs a breadth first search, filling a list with the
+     *  port direct connections (returned by connections()) and following
+     *  the wires connected to those ports. A hash of already visited ports is
+     *  used, so each port is only processed once.
      *
      *  \param connectedPorts List to fill with the connections of this port.
      *
@@ -81,17 +131,32 @@ namespace Caneda
      */
     void Port::getEquipotentialPorts(QList<Port*> &connectedPorts)
     {
-        if(connectedPorts.contains(this)) {
+        QSet<Port*> visited = connectedPorts.toSet();
+        if(visited.contains(this)) {
             return;
         }
 
-        connectedPorts << m_connections;
+        int head = connectedPorts.size();
+        foreach(Port *member, connections()) {
+            visited.insert(member);
+            connectedPorts << member;
+        }
+
+        while(head < connectedPorts.size()) {
+            Port *port = connectedPorts.at(head++);
+            if(port->parentItem()->type() != GraphicsItem::WireType) {
+                continue;
+            }
+
+            Wire *_wire = static_cast<Wire*>(port->parentItem());
+            Port *opposite = (port == _wire->port1()) ? _wire->port2() : _wire->port1();
+            if(visited.contains(opposite)) {
+                continue;
+            }
 
-        foreach(Port *port, connectedPorts) {
-            if(port->parentItem()->type() == GraphicsItem::WireType) {
-                Wire *_wire = static_cast<Wire*>(port->parentItem());
-                _wire->port1()->getEquipotentialPorts(connectedPorts);
-                _wire->port2()->getEquipotentialPorts(connectedPorts);
+            foreach(Port *member, opposite->connections()) {
+                visited.insert(member);
+                connectedPorts << member;
             }
         }
     }
@@ -122,23 +187,31 @@ namespace Caneda
             return;
         }
 
-        // If the connections are same, they are already connected.
-        if(m_connections == other->m_connections) {
-            qWarning() << "Port::connectTo() : The ports are already connected";
+        NetDatabase *database = netDatabase();
+        if(!database) {
+            qWarning() << "Cannot connect ports outside a schematic scene";
+            return;
         }
-        else {
-            // Create a list of connections by merging both lists of connections
-            // and replicating the list in all connected ports.
-            m_connections += other->m_connections;
-            foreach(Port *p, m_connections) {
-                p->m_connections = m_connections;
-            }
+
+        // If the ports share the node, they are already connected.
+        if(isConnectedTo(other)) {
+            qWarning() << "Port::connectTo() : The ports are already connected";
+            return;
         }
 
-        // Update all ports parents.
-        foreach(Port *p, m_connections) {
-            p->parentItem()->update();
+        // Only nodes with less than three ports change their appearance when
+        // joined, so only their members need to be repainted.
+        QList<Port*> changed;
+        if(connectionCount() < 3) {
+            changed << connections();
+        }
+        if(other->connectionCount() < 3) {
+            changed << other->connections();
         }
+
+        database->connect(this, other);
+
+        updateParents(changed);
     }
 
     /*!
@@ -152,60 +225,62 @@ namespace Caneda
     void Port::disconnect()
     {
         // Check if there is any connection
-        if(m_connections.size() <= 1) {
+        int count = connectionCount();
+        if(count <= 1) {
             return;
         }
 
-        // Disconnect this port from every connected port
-        foreach(Port *p, m_connections) {
-            p->m_connections.removeAll(this);
-            p->parentItem()->update();
+        // As in connectTo(), only small nodes change their appearance.
+        QList<Port*> changed;
+        if(count <= 3) {
+            changed << connections();
+        }
+        else {
+            changed << this;
         }
 
-        m_connections.clear();
-        m_connections.append(this);
+        m_netDatabase->disconnect(this);
 
-        // Update parent item.
-        parentItem()->update();
+        updateParents(changed);
     }
 
     //! \brief Check if port \a other is connected to this port.
-    bool Port::isConnectedTo(Port *other)
+    bool Port::isConnectedTo(const Port *other) const
     {
-        bool retVal = m_connections == other->m_connections &&
-            m_connections.contains(other);
-        return retVal;
+        if(!m_netDatabase) {
+            return this == other;
+        }
+
+        return m_netDatabase->isConnected(this, other);
     }
 
     //! \brief Returns true if this port is connected to any other port
     bool Port::hasAnyConnection() const
     {
-        bool retVal = (m_connections.size() > 1);
-        return retVal;
+        return connectionCount() > 1;
     }
 
-    //! \brief Finds a coinciding port on schematic.
+    /*!
+     * \brief Finds a coinciding port on schematic.
+     *
+     * The candidates are looked up by position in the scene's SpatialIndex.
+     *
+     * \return A port of another item at the same scene position, not yet
+     * connected to this one, or 0 if there is none.
+     */
     Port* Port::findCoincidingPort() const
     {
-        if(!scene()) {
+        SpatialIndex *index = spatialIndex();
+        if(!index) {
             return 0;
         }
 
-        QList<QGraphicsItem*> collisions =
-            parentItem()->collidingItems(Qt::IntersectsItemBoundingRect);
-
-        foreach(QGraphicsItem *item, collisions) {
-            if(canedaitem_cast<GraphicsItem*>(item)) {
-
-                QList<Port*> ports = canedaitem_cast<GraphicsItem*>(item)->ports();
-                foreach(Port *p, ports) {
-                    if(p->scenePos() == scenePos() &&
-                            p->parentItem() != parentItem() &&
-                            !m_connections.contains(p)) {
-                        return p;
-                    }
-                }
-
+        QPointF pos = scenePos();
+        foreach(Port *p, index->ports(pos)) {
+            if(p->scenePos() == pos &&
+                    p->parentItem() != parentItem() &&
+                    !isConnectedTo(p)) {
+                return p;
             }
         }
 
@@ -219,34 +294,106 @@ namespace Caneda
      *    \li the port is not connected
      *    \li there are more than two connections to the port
      */
-    void Port::paint(QPainter *painter, const QStyleOptionGraphicsItem* option, QWidget*)
+    void Port::paint(QPainter *painter) const
     {
-        // Save pen
+        // Save pen and brush
         QPen savedPen = painter->pen();
+        QBrush savedBrush = painter->brush();
 
         // Set global pen settings
-        Settings *settings = Settings::instance();
-        if(m_connections.size() <= 1) {
+        const RenderSettings &settings = Settings::instance()->renderSettings();
+        const int count = connectionCount();
+        if(count <= 1) {
             painter->setPen(QPen(Qt::darkRed));
             painter->setBrush(Qt::NoBrush);
-            painter->drawEllipse(portEllipse);
+            painter->drawEllipse(boundingRect());
         }
-        else if(m_connections.size() > 2 && parentItem()->isSelected()) {
-            painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
-            painter->setBrush(QBrush(settings->currentValue("gui/selectionColor").value<QColor>()));
-            painter->drawEllipse(portEllipse.adjusted(1,1,-1,-1));  // Adjust the ellipse to be just a little smaller than the open port
+        else if(count > 2 && m_parent->isSelected()) {
+            painter->setPen(settings.selectionPen);
+            painter->setBrush(QBrush(settings.selectionColor));
+            painter->drawEllipse(boundingRect().adjusted(1,1,-1,-1));  // Adjust the ellipse to be just a little smaller than the open port
         }
-        else if(m_connections.size() > 2) {
-            painter->setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
-            painter->setBrush(QBrush(settings->currentValue("gui/lineColor").value<QColor>()));
-            painter->drawEllipse(portEllipse.adjusted(1,1,-1,-1));  // Adjust the ellipse to be just a little smaller than the open port
+        else if(count > 2) {
+            painter->setPen(settings.linePen);
+            painter->setBrush(QBrush(settings.lineColor));
+            painter->drawEllipse(boundingRect().adjusted(1,1,-1,-1));  // Adjust the ellipse to be just a little smaller than the open port
         }
 
-        // Restore pen
+        // Restore pen and brush
         painter->setPen(savedPen);
+        painter->setBrush(savedBrush);
+    }
+
+    /*!
+     * \brief Handles the parent item about to enter or leave a scene.
+     *
+     * Connections are stored in the scene's NetDatabase, so when the port
+     * (usually along with its parent) is removed from the scene it must be
+     * disconnected and unregistered from that database. The port, and its
+     * wire if it belongs to one, are also removed from the scene's
+     * SpatialIndex.
+     *
+     * \sa GraphicsItem::itemChange()
+     */
+    void Port::sceneAboutToChange()
+    {
+        if(m_netDatabase) {
+            disconnect();
+            m_netDatabase->removePort(this);
+        }
+
+        SpatialIndex *index = spatialIndex();
+        if(index) {
+            index->removePort(this);
+
+            Wire *wire = canedaitem_cast<Wire*>(m_parent);
+            if(wire) {
+                index->removeWire(wire);
+            }
+        }
+    }
+
+    /*!
+     * \brief Handles the port entering a scene or moving in it.
+     *
+     * The port keeps its position, and that of its wire if it belongs to
+     * one, up to date in the scene's SpatialIndex.
+     *
+     * \sa GraphicsItem::itemChange()
+     */
+    void Port::scenePositionChanged()
+    {
+        SpatialIndex *index = spatialIndex();
+        if(index) {
+            index->updatePort(this);
+
+            Wire *wire = canedaitem_cast<Wire*>(m_parent);
+            if(wire) {
+                index->updateWire(wire);
+            }
+        }
+    }
+
+    //! \brief Returns the NetDatabase of the scene this port belongs to.
+    NetDatabase* Port::netDatabase() const
+    {
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        return graphicsScene ? graphicsScene->netDatabase() : 0;
+    }
 
+    //! \brief Returns the SpatialIndex of the scene this port belongs to.
+    SpatialIndex* Port::spatialIndex() const
+    {
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        return graphicsScene ? graphicsScene->spatialIndex() : 0;
+    }
+
+    //! \brief Schedules a repaint of the parents of \a ports.
+    void Port::updateParents(const QList<Port*> &ports)
+    {
+        foreach(Port *p, ports) {
+            p->parentItem()->update();
+        }
     }
 
 } // namespace Caneda
@@ -28,6 +28,10 @@
 
 namespace Caneda
 {
+    // Forward declarations
+    class NetDatabase;
+    class SpatialIndex;
+
     //! \brief Style constants definitions
     static const qreal portRadius(3.0);
     //! \brief Style constants definitions
@@ -49,7 +53,14 @@ namespace Caneda
      *
      * This class always has a parent item (GraphicsItem) and cannot be moved
      * on its own. The port position on a scene is determined from the parent's
-     * position, moving along with it. A Port class has only one parent, but
+     * position, moving along with it.
+     *
+     * Ports are not items of the scene themselves, but plain data owned by
+     * their parent: an item with many ports adds a single node to the scene
+     * and its index, and moving it sends no notifications to the ports. The
+     * parent paints its ports (see GraphicsItem::paintPorts()), its shape is
+     * used for hit-testing, and it tells its ports when it enters, leaves or
+     * moves in a scene (see GraphicsItem::itemChange()). A Port class has only one parent, but
      * can be connected to multiple ports, thus allowing interconnection of
      * electric components such as wires, pasive and active components, etc.
      *
@@ -58,39 +69,69 @@ namespace Caneda
      * drawn. When multiple connections are made into one port, a filled circle
      * with the foreground color is drawn.
      *
-     * \sa Component, Wire
+     * Connections are not stored in the port itself, but in the NetDatabase
+     * of the scene the port belongs to. Hence, ports can only be connected
+     * while they are in a GraphicsScene, and they are automatically
+     * disconnected when they leave it.
+     *
+     * \sa Component, Wire, NetDatabase
      */
-    class Port : public QGraphicsItem
+    class Port
     {
     public:
-        explicit Port(GraphicsItem *parent = 0);
+        explicit Port(GraphicsItem *parent);
         ~Port();
 
         //! Returns the port's name.
         QString name() const { return m_name; }
         void setName(const QString &newName) { m_name = newName; }
 
-        GraphicsItem* parentItem() const;
+        //! Returns the item this port belongs to.
+        GraphicsItem* parentItem() const { return m_parent; }
+        QGraphicsScene* scene() const;
+
+        //! Returns the position of the port in parent coordinates.
+        QPointF pos() const { return m_pos; }
+        void setPos(const QPointF &pos);
+        QPointF scenePos() const;
 
-        //! Returns a pointer to list of connected ports
-        QList<Port*> *connections() { return &(m_connections); }
+        QList<Port*> connections() const;
+        int connectionCount() const;
         void getEquipotentialPorts(QList<Caneda::Port *> &connectedPorts);
 
         void connectTo(Port *other);
         void disconnect();
 
-        bool isConnectedTo(Port *other);
+        bool isConnectedTo(const Port *other) const;
         bool hasAnyConnection() const;
 
         Port* findCoincidingPort() const;
 
-        //! Return bounding box
-        QRectF boundingRect() const { return portEllipse; }
-        void paint(QPainter *painter, const QStyleOptionGraphicsItem* option, QWidget*);
+        //! Return bounding box, in parent coordinates
+        QRectF boundingRect() const { return portEllipse.translated(m_pos); }
+        QRectF sceneBoundingRect() const;
+        void paint(QPainter *painter) const;
+
+        void sceneAboutToChange();
+        void scenePositionChanged();
 
     private:
+        NetDatabase* netDatabase() const;
+        SpatialIndex* spatialIndex() const;
+        static void updateParents(const QList<Port*> &ports);
+
+        GraphicsItem *const m_parent;
+        QPointF m_pos;
         QString m_name;
-        QList<Port*> m_connections;
+
+        //! \brief Database holding this port's connections (0 if not connected yet).
+        NetDatabase *m_netDatabase;
+        //! \brief Element of this port in the NetDatabase.
+        int m_netId;
+        //! \brief Position of this port in the members list of its node.
+        int m_netIndex;
+
+        friend class NetDatabase;
     };
 
 } // namespace Caneda
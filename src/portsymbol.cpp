@@ -101,12 +101,13 @@ namespace Caneda
         QPointF labelPos = m_symbol.boundingRect().bottomLeft();
         m_label->setPos(labelPos);
 
-        // Set the bounding rect to contain both the m_symbol shape and the
-        // label. Use a rectangular shape (path) in setShapeAndBoundRect
+        // Set the bounding rect to contain the m_symbol shape, the label and
+        // the port. Use a rectangular shape (path) in setShapeAndBoundRect
         // to allow easy selection of the item. Otherwise, the ground symbol
         // would be very difficult to select (the selection would only work
         // when picking the lines).
-        QRectF _boundRect = m_symbol.boundingRect() | m_label->boundingRect().translated(labelPos);
+        QRectF _boundRect = m_symbol.boundingRect() | m_label->boundingRect().translated(labelPos) |
+                portEllipse;
         QPainterPath _path = QPainterPath();
         _path.addRect(_boundRect);
 
@@ -121,31 +122,31 @@ namespace Caneda
         QPen savedPen = painter->pen();
 
         // Set global pen settings
-        Settings *settings = Settings::instance();
+        const RenderSettings &settings = Settings::instance()->renderSettings();
         if(option->state & QStyle::State_Selected) {
-            painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(settings.selectionPen);
 
             // Set the label font settings
-            m_label->setBrush(QBrush(settings->currentValue("gui/selectionColor").value<QColor>()));
+            m_label->setBrush(QBrush(settings.selectionColor));
         }
         else {
-            painter->setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(settings.linePen);
 
             // Set the label font settings
-            m_label->setBrush(QBrush(settings->currentValue("gui/foregroundColor").value<QColor>()));
+            m_label->setBrush(QBrush(settings.foregroundColor));
         }
 
         // Draw the port symbol if it is a termination point or ground
         if(m_label->text().toLower() == "ground" ||
                 m_label->text().toLower() == "gnd" ||
-                port()->connections()->size() <= 2) {
+                port()->connectionCount() <= 2) {
             painter->drawPath(m_symbol);
         }
 
         // Restore pen
         painter->setPen(savedPen);
+
+        paintPorts(painter);
     }
 
     //! \copydoc GraphicsItem::copy()
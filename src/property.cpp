@@ -152,6 +152,16 @@ namespace Caneda
         writer->writeEndElement(); // </property>
     }
 
+    //! \brief Returns true if this property has the same data as \a other.
+    bool Property::operator==(const Property &other) const
+    {
+        return d == other.d ||
+               (d->name == other.d->name &&
+                d->value == other.d->value &&
+                d->description == other.d->description &&
+                d->visible == other.d->visible);
+    }
+
 
     /*************************************************************************
      *                            PropertyGroup                              *
@@ -162,9 +172,11 @@ namespace Caneda
      * \param parent Parent of the item.
      */
     PropertyGroup::PropertyGroup(QGraphicsItem *parent) :
-        QGraphicsSimpleTextItem(parent)
+        QGraphicsItem(parent),
+        m_displayOutdated(false)
     {
         m_userPropertiesEnabled = false;
+        m_staticText.setTextFormat(Qt::PlainText);
 
         // Set items flags
         setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
@@ -175,19 +187,47 @@ namespace Caneda
     //! \brief Adds a new property to the PropertyMap.
     void PropertyGroup::addProperty(const QString& key, const Property &prop)
     {
-        m_propertyMap.insert(key, prop);
+        storeProperty(key, prop);
         updatePropertyDisplay();  // This is necessary to update the properties display on a scene
     }
 
     //! \brief Sets property \a key to \a value in the PropertyMap.
     void PropertyGroup::setPropertyValue(const QString& key, const QString& value)
     {
-        if(m_propertyMap.contains(key)) {
-            m_propertyMap[key].setValue(value);
+        if(contains(key)) {
+            Property prop = property(key);
+            prop.setValue(value);
+            storeProperty(key, prop);
             updatePropertyDisplay();  // This is necessary to update the properties display on a scene
         }
     }
 
+    /*!
+     * \brief Returns the property map (actually a copy of property map).
+     *
+     * The returned map holds the default properties, replaced by the ones
+     * set in this group.
+     *
+     * \sa setDefaultPropertyMap()
+     */
+    PropertyMap PropertyGroup::propertyMap() const
+    {
+        if(m_propertyMap.isEmpty()) {
+            return m_defaultPropertyMap;
+        }
+        if(m_defaultPropertyMap.isEmpty()) {
+            return m_propertyMap;
+        }
+
+        PropertyMap propMap = m_defaultPropertyMap;
+        PropertyMap::const_iterator it;
+        for(it = m_propertyMap.constBegin(); it != m_propertyMap.constEnd(); ++it) {
+            propMap.insert(it.key(), it.value());
+        }
+
+        return propMap;
+    }
+
     /*!
      * \brief Set all the properties values through a PropertyMap.
      *
@@ -201,10 +241,72 @@ namespace Caneda
      */
     void PropertyGroup::setPropertyMap(const PropertyMap& propMap)
     {
-        m_propertyMap = propMap;
+        if(m_defaultPropertyMap.isEmpty()) {
+            m_propertyMap = propMap;
+        }
+        else {
+            m_propertyMap.clear();
+
+            PropertyMap::const_iterator it;
+            for(it = propMap.constBegin(); it != propMap.constEnd(); ++it) {
+                storeProperty(it.key(), it.value());
+            }
+        }
+
         updatePropertyDisplay();  // This is necessary to update the properties display on a scene
     }
 
+    /*!
+     * \brief Sets the default properties of the group.
+     *
+     * The default properties are not copied, but implicitly shared with
+     * \a defaults. Only the properties later set to a different value are
+     * stored in this group, making the groups sharing the same defaults (for
+     * example, the instances of a library component) much lighter.
+     *
+     * Properties can't be removed from the defaults: properties missing from
+     * the map given to setPropertyMap() keep their default value.
+     *
+     * \sa propertyMap(), setPropertyMap()
+     */
+    void PropertyGroup::setDefaultPropertyMap(const PropertyMap& defaults)
+    {
+        m_defaultPropertyMap = defaults;
+        updatePropertyDisplay();  // This is necessary to update the properties display on a scene
+    }
+
+    //! \brief Returns property \a key, either from this group or the defaults.
+    Property PropertyGroup::property(const QString& key) const
+    {
+        PropertyMap::const_iterator it = m_propertyMap.constFind(key);
+        if(it != m_propertyMap.constEnd()) {
+            return it.value();
+        }
+
+        return m_defaultPropertyMap.value(key);
+    }
+
+    //! \brief Returns true if the group or its defaults have property \a key.
+    bool PropertyGroup::contains(const QString& key) const
+    {
+        return m_propertyMap.contains(key) || m_defaultPropertyMap.contains(key);
+    }
+
+    /*!
+     * \brief Stores \a prop as property \a key, unless it is equal to the
+     * default one.
+     */
+    void PropertyGroup::storeProperty(const QString& key, const Property& prop)
+    {
+        PropertyMap::const_iterator it = m_defaultPropertyMap.constFind(key);
+        if(it != m_defaultPropertyMap.constEnd() && it.value() == prop) {
+            m_propertyMap.remove(key);
+        }
+        else {
+            m_propertyMap.insert(key, prop);
+        }
+    }
+
     /*!
      * \brief Sets the userPropertiesEnabled status.
      *
@@ -223,37 +325,59 @@ namespace Caneda
     /*!
      * \brief Updates the visual display of all the properties in the PropertyGroup.
      *
-     * This method is key to alter the visual display text of given properties. It
-     * should be called wherever a property changes.
+     * This method should be called wherever a property changes. The display
+     * is only invalidated here, and rebuilt by updateLayout() before it is
+     * next needed. Hence, setting several properties in a row (for example,
+     * while loading a document) lays out the text only once.
      *
-     * To update the visual display, it recreates all individual properties display
-     * from the group and then adds them to the plaintext property of this item (if
-     * the given property is visible). This method also updates the visible value of
-     * the property.
+     * The group is hidden if none of its properties are visible.
      */
     void PropertyGroup::updatePropertyDisplay()
     {
-        bool itemsVisible = false;
+        if(!m_displayOutdated) {
+            prepareGeometryChange();
+            m_displayOutdated = true;
+        }
 
-        // Determine if any item is visible.
-        foreach(const Property property, m_propertyMap) {
-            if(property.isVisible()) {
-                 itemsVisible = true;
-                 break;
+        setVisible(hasVisibleProperties());
+        update();
+    }
+
+    //! \brief Returns true if any of the properties is visible.
+    bool PropertyGroup::hasVisibleProperties() const
+    {
+        PropertyMap::const_iterator it;
+        for(it = m_propertyMap.constBegin(); it != m_propertyMap.constEnd(); ++it) {
+            if(it.value().isVisible()) {
+                return true;
+            }
+        }
+
+        for(it = m_defaultPropertyMap.constBegin(); it != m_defaultPropertyMap.constEnd(); ++it) {
+            if(it.value().isVisible() && !m_propertyMap.contains(it.key())) {
+                return true;
             }
         }
 
-        // Hide the display if none of the properties are visible.
-        if(!itemsVisible) {
-            hide();
+        return false;
+    }
+
+    /*!
+     * \brief Rebuilds the display text, if outdated.
+     *
+     * The display text holds a line for each visible property, and is laid
+     * out once into a QStaticText, which is then painted as is.
+     */
+    void PropertyGroup::updateLayout() const
+    {
+        if(!m_displayOutdated) {
             return;
         }
 
-        // Else update its value, and make visible (show()).
         QString newValue;  // New value to set
 
         // Iterate through all properties to add its values
-        foreach(const Property property, m_propertyMap) {
+        foreach(const Property property, propertyMap()) {
             if(property.isVisible()) {
 
                 QString propertyText = QString();  // Current property text
@@ -266,19 +390,27 @@ namespace Caneda
                 // Add property value
                 propertyText.append(property.value());
 
-                // Add the property to the group
+                // Add the property to the group. Line separators are used,
+                // as QStaticText lays out plain text in a single paragraph.
                 if(!newValue.isEmpty()) {
-                    newValue.append("\n");  // If already has properties, add newline
+                    newValue.append(QChar::LineSeparator);
                 }
                 newValue.append(propertyText);
             }
         }
 
-        // Set new properties values
-        setText(newValue);
+        m_staticText.setText(newValue);
+        m_staticText.prepare(QTransform(), QFont());
+        m_boundingRect = QRectF(QPointF(0, 0), m_staticText.size());
 
-        // Make item visible
-        show();
+        m_displayOutdated = false;
+    }
+
+    //! \brief Returns the bounding rect of the display text.
+    QRectF PropertyGroup::boundingRect() const
+    {
+        updateLayout();
+        return m_boundingRect;
     }
 
     /*!
@@ -298,34 +430,36 @@ namespace Caneda
     void PropertyGroup::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
             QWidget *widget)
     {
-        // Save pen
+        // Save pen and font
         QPen savedPen = painter->pen();
+        QFont savedFont = painter->font();
 
         // Set global pen settings
-        Settings *settings = Settings::instance();
+        const RenderSettings &settings = Settings::instance()->renderSettings();
         if(isSelected()) {
-            painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(settings.selectionPen);
         }
         else {
-            painter->setPen(QPen(settings->currentValue("gui/foregroundColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(settings.foregroundPen);
         }
 
         // Paint the property text
-        painter->drawText(boundingRect(), text());
+        updateLayout();
+        painter->setFont(QFont());
+        painter->drawStaticText(QPointF(0, 0), m_staticText);
 
-        // Restore pen
+        // Restore pen and font
         painter->setPen(savedPen);
+        painter->setFont(savedFont);
     }
 
-    //! \brief Helper method to write all properties in \a m_propertyMap to xml.
+    //! \brief Helper method to write all properties in propertyMap() to xml.
     void PropertyGroup::writeProperties(Caneda::XmlWriter *writer)
     {
         writer->writeStartElement("properties");
         writer->writePointAttribute(pos(), "pos");
 
-        foreach(const Property p, m_propertyMap) {
+        foreach(const Property p, propertyMap()) {
             writer->writeEmptyElement("property");
             writer->writeAttribute("name", p.name());
             writer->writeAttribute("value", p.value());
@@ -335,7 +469,7 @@ namespace Caneda
         writer->writeEndElement(); // </properties>
     }
 
-    //! \brief Helper method to read xml saved properties into \a m_propertyMap.
+    //! \brief Helper method to read xml saved properties into propertyMap().
     void PropertyGroup::readProperties(Caneda::XmlReader *reader)
     {
         Q_ASSERT(reader->isStartElement() && reader->name() == "properties");
@@ -352,14 +486,15 @@ namespace Caneda
                 if(reader->name() == "property") {
                     QXmlStreamAttributes attribs(reader->attributes());
                     QString propName = attribs.value("name").toString();
-                    if(!m_propertyMap.contains(propName)) {
+                    if(!contains(propName)) {
                         qWarning() << "readProperties() : " << "Property " << propName
                                    << "not found in map!";
                     }
                     else {
-                        Property &prop = m_propertyMap[propName];
+                        Property prop = property(propName);
                         prop.setValue(attribs.value("value").toString());
                         prop.setVisible(attribs.value("visible") == "true");
+                        storeProperty(propName, prop);
                     }
                     // Read till end element
                     reader->readUnknownElement();
@@ -391,7 +526,7 @@ namespace Caneda
             }
         }
 
-        QGraphicsSimpleTextItem::mousePressEvent(event);
+        QGraphicsItem::mousePressEvent(event);
     }
 
     //! \brief Launches property dialog on double click.
@@ -21,7 +21,8 @@
 #ifndef PROPERTY_H
 #define PROPERTY_H
 
-#include <QGraphicsSimpleTextItem>
+#include <QGraphicsItem>
+#include <QStaticText>
 
 namespace Caneda
 {
@@ -93,6 +94,10 @@ namespace Caneda
         //! Sets the visibility of property to \a visible .
         void setVisible(bool visible) { d->visible = visible; }
 
+        bool operator==(const Property &other) const;
+        //! Returns true if this property differs from \a other.
+        bool operator!=(const Property &other) const { return !(*this == other); }
+
         static Property loadProperty(Caneda::XmlReader *reader);
         void saveProperty(Caneda::XmlWriter *writer) const;
 
@@ -118,27 +123,42 @@ namespace Caneda
      * groups them all together and renders them on a scene, allowing
      * selection and moving of all properties at once.
      *
-     * \sa PropertyData, Property
+     * A group may be given a map of default properties, shared with other
+     * groups (for example, the properties of a library component, shared by
+     * all its instances). In that case, the group only stores the properties
+     * that differ from the defaults, while propertyMap() and propertyValue()
+     * still return the resulting properties.
+     *
+     * The display text of the group is laid out lazily: changing the
+     * properties only invalidates it (see updatePropertyDisplay()), and the
+     * text is rebuilt once, the next time the group is painted or its
+     * geometry is needed. The laid out text is cached in a QStaticText.
+     *
+     * \sa PropertyData, Property, setDefaultPropertyMap()
      */
-    class PropertyGroup : public QGraphicsSimpleTextItem
+    class PropertyGroup : public QGraphicsItem
     {
     public:
         explicit PropertyGroup(QGraphicsItem *parent = 0);
 
         void addProperty(const QString& key, const Property& prop);
         //! Returns selected property from property map.
-        QString propertyValue(const QString& key) const { return m_propertyMap[key].value(); }
+        QString propertyValue(const QString& key) const { return property(key).value(); }
         void setPropertyValue(const QString& key, const QString& value);
 
-        //! Returns the property map (actually a copy of property map).
-        PropertyMap propertyMap() const { return m_propertyMap; }
+        PropertyMap propertyMap() const;
         void setPropertyMap(const PropertyMap& propMap);
 
+        //! Returns the default properties of the group.
+        PropertyMap defaultPropertyMap() const { return m_defaultPropertyMap; }
+        void setDefaultPropertyMap(const PropertyMap& defaults);
+
         //! Returns if the user is enabled to add or remove properties.
         bool userPropertiesEnabled() const { return m_userPropertiesEnabled; }
         void setUserPropertiesEnabled(const bool enable);
 
         void updatePropertyDisplay();
+        QRectF boundingRect() const;
         void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                 QWidget *widget = 0 );
 
@@ -152,8 +172,17 @@ namespace Caneda
         void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event);
 
     private:
-        //! QMap holding actual properties.
+        Property property(const QString& key) const;
+        bool contains(const QString& key) const;
+        void storeProperty(const QString& key, const Property& prop);
+
+        bool hasVisibleProperties() const;
+        void updateLayout() const;
+
+        //! QMap holding the properties differing from the defaults.
         PropertyMap m_propertyMap;
+        //! QMap holding the default properties, implicitly shared.
+        PropertyMap m_defaultPropertyMap;
 
         /*!
          * \brief Holds the user created properties enable status.
@@ -166,6 +195,13 @@ namespace Caneda
          * \sa userPropertiesEnabled(), setUserPropertiesEnabled()
          */
         bool m_userPropertiesEnabled;
+
+        //! Display text of the visible properties, laid out by updateLayout().
+        mutable QStaticText m_staticText;
+        //! Bounding rect of the display text.
+        mutable QRectF m_boundingRect;
+        //! True if the display text must be laid out again.
+        mutable bool m_displayOutdated;
     };
 
 } // namespace Caneda
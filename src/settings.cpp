@@ -32,7 +32,9 @@
 namespace Caneda
 {
     //! \brief Constructor.
-    Settings::Settings(QObject *parent) : QObject(parent)
+    Settings::Settings(QObject *parent) :
+        QObject(parent),
+        m_renderSettingsValid(false)
     {
         QStringList libraries;
         libraries << Caneda::libDirectory() + "components/active";
@@ -63,6 +65,8 @@ namespace Caneda
         defaultSettings["gui/lineColor"] = QVariant(QColor(Qt::blue));
         defaultSettings["gui/selectionColor"] = QVariant(QColor(255, 128, 0)); // Dark orange
         defaultSettings["gui/lineWidth"] = QVariant(int(1));
+        defaultSettings["gui/undoLimit"] = QVariant(int(0));  // Zero keeps an unlimited undo history
+        defaultSettings["gui/undoMemory"] = QVariant(int(0));  // Megabytes of removed items kept for undo, zero is unlimited
 
         defaultSettings["gui/hdl/keyword"]= QVariant(QVariant(QColor(Qt::black)));
         defaultSettings["gui/hdl/type"]= QVariant(QVariant(QColor(Qt::blue)));
@@ -85,6 +89,8 @@ namespace Caneda
         defaultSettings["sim/simulationEngine"] = QVariant(QString("ngspice"));  //! \todo In the future this could be replaced by an enum, to avoid problems
         defaultSettings["sim/simulationCommand"] = QVariant(QString("ngspice -b -r %filename.raw %filename.net"));
         defaultSettings["sim/outputFormat"] = QVariant(QString("binary"));  //! \todo In the future this could be replaced by an enum, to avoid problems
+        defaultSettings["sim/followSimulation"] = QVariant(bool(true));
+        defaultSettings["sim/maximumJobs"] = QVariant(int(0));  // Zero runs as many simultaneous simulations as processor cores
 
         defaultSettings["shortcuts/fileNew"] = QVariant(QKeySequence(QKeySequence::New));
         defaultSettings["shortcuts/fileOpen"] = QVariant(QKeySequence(QKeySequence::Open));
@@ -191,6 +197,38 @@ namespace Caneda
     void Settings::setCurrentValue(const QString& key, const QVariant& value)
     {
         currentSettings[key] = value.isValid() ? value : defaultSettings[key];
+        m_renderSettingsValid = false;
+    }
+
+    /*!
+     * \brief Get the current values of the settings used while painting.
+     *
+     * The returned struct is built on the first call after any setting
+     * changes, and then reused. The reference is only valid until the next
+     * call to setCurrentValue(), so it must not be kept by the caller.
+     *
+     * \sa RenderSettings, setCurrentValue
+     */
+    const RenderSettings& Settings::renderSettings() const
+    {
+        if(!m_renderSettingsValid) {
+            RenderSettings &r = m_renderSettings;
+
+            r.gridVisible = currentValue("gui/gridVisible").toBool();
+            r.foregroundColor = currentValue("gui/foregroundColor").value<QColor>();
+            r.backgroundColor = currentValue("gui/backgroundColor").value<QColor>();
+            r.lineColor = currentValue("gui/lineColor").value<QColor>();
+            r.selectionColor = currentValue("gui/selectionColor").value<QColor>();
+            r.lineWidth = currentValue("gui/lineWidth").toInt();
+
+            r.linePen = QPen(r.lineColor, r.lineWidth);
+            r.selectionPen = QPen(r.selectionColor, r.lineWidth);
+            r.foregroundPen = QPen(r.foregroundColor, r.lineWidth);
+
+            m_renderSettingsValid = true;
+        }
+
+        return m_renderSettings;
     }
 
     /*!
@@ -21,14 +21,51 @@
 #ifndef SETTINGS_H
 #define SETTINGS_H
 
+#include <QColor>
 #include <QMap>
 #include <QObject>
+#include <QPen>
 
 //Forward declarations
 class QVariant;
 
 namespace Caneda
 {
+    /*!
+     * \brief Typed snapshot of the settings used while painting.
+     *
+     * Paint methods are called for every visible item on every frame, and
+     * looking up each setting by its string key (with the corresponding
+     * QVariant conversion) is too expensive there. Instead, paint methods
+     * read the fields of this struct, which is built once by Settings and
+     * rebuilt only after a setting changes.
+     *
+     * \sa Settings::renderSettings()
+     */
+    struct RenderSettings
+    {
+        //! Value of "gui/gridVisible".
+        bool gridVisible;
+
+        //! Value of "gui/foregroundColor".
+        QColor foregroundColor;
+        //! Value of "gui/backgroundColor".
+        QColor backgroundColor;
+        //! Value of "gui/lineColor".
+        QColor lineColor;
+        //! Value of "gui/selectionColor".
+        QColor selectionColor;
+        //! Value of "gui/lineWidth".
+        int lineWidth;
+
+        //! Pen of lineWidth width and lineColor color.
+        QPen linePen;
+        //! Pen of lineWidth width and selectionColor color.
+        QPen selectionPen;
+        //! Pen of lineWidth width and foregroundColor color.
+        QPen foregroundPen;
+    };
+
     /*!
      * \brief This class handles all of Caneda's settings.
      *
@@ -52,6 +89,8 @@ namespace Caneda
 
         void setCurrentValue(const QString& key, const QVariant& value);
 
+        const RenderSettings& renderSettings() const;
+
         bool load();
         bool save();
 
@@ -60,6 +99,10 @@ namespace Caneda
 
         QMap<QString, QVariant> defaultSettings;
         QMap<QString, QVariant> currentSettings;
+
+        //! Cached render settings, valid while m_renderSettingsValid is set.
+        mutable RenderSettings m_renderSettings;
+        mutable bool m_renderSettingsValid;
     };
 
 } // namespace Caneda
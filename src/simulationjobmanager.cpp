@@ -0,0 +1,394 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "simulationjobmanager.h"
+
+#include "settings.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QThread>
+
+namespace Caneda
+{
+    //! \brief Constructor.
+    SimulationJobManager::SimulationJobManager(QObject *parent) :
+        QObject(parent),
+        m_nextId(0)
+    {
+    }
+
+    //! \copydoc MainWindow::instance()
+    SimulationJobManager* SimulationJobManager::instance()
+    {
+        static SimulationJobManager *instance = 0;
+        if (!instance) {
+            instance = new SimulationJobManager();
+        }
+        return instance;
+    }
+
+    /*!
+     * \brief Queues \a job to be run as soon as there is a free slot.
+     *
+     * \return The id of the new job.
+     *
+     * \sa jobStarted(), jobFinished()
+     */
+    int SimulationJobManager::addJob(const SimulationJob &job)
+    {
+        int id = m_nextId++;
+
+        JobData data;
+        data.job = job;
+        data.status = Queued;
+        data.step = 0;
+        data.process = 0;
+
+        m_jobs.insert(id, data);
+        m_queue.append(id);
+
+        startJobs();
+        return id;
+    }
+
+    /*!
+     * \brief Queues a parameter sweep, one job for each of the \a values.
+     *
+     * For each value, a variant of the spice netlist \a netlistFile is
+     * written next to it, named after the netlist, the parameter and the
+     * value index (for example "amplifier_rload_3.net"). In each variant,
+     * the value of \a parameter in the .param statements is replaced by the
+     * corresponding value. If the netlist doesn't define the parameter, a
+     * new .param statement is added after the title line.
+     *
+     * Every variant is run with the commands of \a job, replacing the
+     * %filename placeholder by the variant base name. The log of each
+     * variant is written to its own file, next to the variant netlist.
+     *
+     * \return The ids of the new jobs, in the order of \a values. Variants
+     * which could not be written are skipped.
+     */
+    QList<int> SimulationJobManager::addSweep(const SimulationJob &job, const QString &netlistFile,
+                                              const QString &parameter, const QStringList &values)
+    {
+        QList<int> ids;
+
+        QFileInfo info(netlistFile);
+        QDir dir = info.absoluteDir();
+
+        for(int i = 0; i < values.size(); ++i) {
+            QString baseName = info.completeBaseName() + "_" + parameter + "_" + QString::number(i);
+            QString variantFile = dir.filePath(baseName + "." + info.suffix());
+
+            if(!writeSweepNetlist(netlistFile, variantFile, parameter, values.at(i))) {
+                qWarning() << "\nWarning: Cannot write sweep netlist" << variantFile;
+                continue;
+            }
+
+            SimulationJob variant = job;
+            variant.commands.replaceInStrings("%filename", baseName);
+            variant.logFile = dir.filePath(baseName + ".log");
+            if(variant.workingDirectory.isEmpty()) {
+                variant.workingDirectory = dir.absolutePath();
+            }
+
+            ids << addJob(variant);
+        }
+
+        return ids;
+    }
+
+    /*!
+     * \brief Cancels job \a id, killing its running command if any.
+     *
+     * The jobFinished() signal is emitted once the job is canceled. Jobs
+     * already finished are not affected.
+     */
+    void SimulationJobManager::cancel(int id)
+    {
+        if(!isActive(id)) {
+            return;
+        }
+
+        JobData &data = m_jobs[id];
+
+        if(data.status == Queued) {
+            m_queue.removeAll(id);
+            finishJob(id, Canceled);
+            return;
+        }
+
+        // The job is finished once the process actually exits
+        data.status = Canceled;
+        data.process->kill();
+    }
+
+    //! \brief Cancels all queued and running jobs.
+    void SimulationJobManager::cancelAll()
+    {
+        foreach(int id, m_jobs.keys()) {
+            cancel(id);
+        }
+    }
+
+    /*!
+     * \brief Forgets the finished job \a id.
+     *
+     * Active jobs must be canceled first, so this method does nothing for
+     * them.
+     */
+    void SimulationJobManager::removeJob(int id)
+    {
+        if(!isActive(id)) {
+            m_jobs.remove(id);
+        }
+    }
+
+    //! \brief Returns the status of job \a id.
+    SimulationJobManager::JobStatus SimulationJobManager::status(int id) const
+    {
+        QHash<int, JobData>::const_iterator it = m_jobs.constFind(id);
+        if(it == m_jobs.constEnd()) {
+            return Unknown;
+        }
+
+        return it->status;
+    }
+
+    //! \brief Returns true if job \a id is queued or running.
+    bool SimulationJobManager::isActive(int id) const
+    {
+        QHash<int, JobData>::const_iterator it = m_jobs.constFind(id);
+        if(it == m_jobs.constEnd()) {
+            return false;
+        }
+
+        // A canceled job keeps its process until it exits
+        return it->status == Queued || it->status == Running || it->process;
+    }
+
+    //! \brief Returns the file where the output of job \a id is written.
+    QString SimulationJobManager::logFile(int id) const
+    {
+        QHash<int, JobData>::const_iterator it = m_jobs.constFind(id);
+        if(it == m_jobs.constEnd()) {
+            return QString();
+        }
+
+        return it->job.logFile;
+    }
+
+    /*!
+     * \brief Returns the number of jobs that may run at the same time.
+     *
+     * This is taken from the "sim/maximumJobs" setting, which defaults to
+     * the number of processor cores.
+     */
+    int SimulationJobManager::maximumJobs() const
+    {
+        int jobs = Settings::instance()->currentValue("sim/maximumJobs").toInt();
+        if(jobs < 1) {
+            jobs = qMax(1, QThread::idealThreadCount());
+        }
+
+        return jobs;
+    }
+
+    //! \brief Starts queued jobs while there are free slots.
+    void SimulationJobManager::startJobs()
+    {
+        int maximum = maximumJobs();
+
+        while(!m_queue.isEmpty() && m_processes.size() < maximum) {
+            int id = m_queue.takeFirst();
+
+            m_jobs[id].status = Running;
+            emit jobStarted(id);
+
+            startStep(id);
+        }
+    }
+
+    /*!
+     * \brief Starts the current command of job \a id.
+     *
+     * The output of the first command truncates the log file, while the
+     * output of the following ones is appended to it.
+     */
+    void SimulationJobManager::startStep(int id)
+    {
+        JobData &data = m_jobs[id];
+
+        if(data.step >= data.job.commands.size()) {
+            finishJob(id, Finished);
+            return;
+        }
+
+        QProcess *process = new QProcess(this);
+        process->setWorkingDirectory(data.job.workingDirectory);
+        process->setProcessChannelMode(QProcess::MergedChannels);  // Output std:error and std:output together into the same file
+
+        if(!data.job.logFile.isEmpty()) {
+            process->setStandardOutputFile(data.job.logFile,
+                                           data.step == 0 ? QIODevice::WriteOnly : QIODevice::Append);
+        }
+
+        if(!data.job.environment.isEmpty()) {
+            process->setProcessEnvironment(data.job.environment);
+        }
+
+        connect(process, SIGNAL(finished(int, QProcess::ExitStatus)),
+                this, SLOT(processFinished(int, QProcess::ExitStatus)));
+        connect(process, SIGNAL(error(QProcess::ProcessError)),
+                this, SLOT(processError(QProcess::ProcessError)));
+
+        data.process = process;
+        m_processes.insert(process, id);
+
+        process->start(data.job.commands.at(data.step));
+    }
+
+    /*!
+     * \brief Finishes job \a id with \a status, and starts the next queued
+     * jobs.
+     */
+    void SimulationJobManager::finishJob(int id, JobStatus status)
+    {
+        JobData &data = m_jobs[id];
+
+        if(data.process) {
+            m_processes.remove(data.process);
+            data.process->deleteLater();
+            data.process = 0;
+        }
+
+        data.status = status;
+        emit jobFinished(id);
+
+        // Nobody waits for the results of a canceled job
+        if(status == Canceled) {
+            m_jobs.remove(id);
+        }
+
+        startJobs();
+    }
+
+    //! \brief Runs the next command of the job, or finishes it.
+    void SimulationJobManager::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+    {
+        QProcess *process = qobject_cast<QProcess*>(sender());
+        if(!process || !m_processes.contains(process)) {
+            return;
+        }
+
+        int id = m_processes.value(process);
+        JobData &data = m_jobs[id];
+
+        if(data.status == Canceled) {
+            finishJob(id, Canceled);
+            return;
+        }
+
+        if(exitStatus != QProcess::NormalExit || exitCode != 0) {
+            finishJob(id, Failed);
+            return;
+        }
+
+        // Start the next command of the job
+        m_processes.remove(process);
+        process->deleteLater();
+        data.process = 0;
+
+        ++data.step;
+        startStep(id);
+    }
+
+    /*!
+     * \brief Finishes the job of a command which could not be started.
+     *
+     * Other errors are followed by the finished() signal of the process, and
+     * are handled in processFinished().
+     */
+    void SimulationJobManager::processError(QProcess::ProcessError error)
+    {
+        QProcess *process = qobject_cast<QProcess*>(sender());
+        if(!process || !m_processes.contains(process) || error != QProcess::FailedToStart) {
+            return;
+        }
+
+        int id = m_processes.value(process);
+        finishJob(id, m_jobs[id].status == Canceled ? Canceled : FailedToStart);
+    }
+
+    /*!
+     * \brief Writes a copy of \a netlistFile into \a variantFile, with the
+     * value of \a parameter replaced by \a value.
+     *
+     * \sa addSweep()
+     */
+    bool SimulationJobManager::writeSweepNetlist(const QString &netlistFile, const QString &variantFile,
+                                                 const QString &parameter, const QString &value)
+    {
+        QFile input(netlistFile);
+        if(!input.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            return false;
+        }
+
+        QStringList lines = QTextStream(&input).readAll().split('\n');
+        input.close();
+
+        // Matches the parameter assignment, with its value being either a
+        // single token or an expression in braces.
+        QRegularExpression assignment("(\\b" + QRegularExpression::escape(parameter) +
+                                      "\\s*=\\s*)(\\{[^}]*\\}|\\S+)",
+                                      QRegularExpression::CaseInsensitiveOption);
+
+        bool found = false;
+        for(int i = 1; i < lines.size(); ++i) {
+            if(lines.at(i).trimmed().startsWith(".param", Qt::CaseInsensitive)) {
+                QString line = lines.at(i);
+                if(line.contains(assignment)) {
+                    lines[i] = line.replace(assignment, "\\1" + value);
+                    found = true;
+                }
+            }
+        }
+
+        // The first line of a spice netlist is always the title
+        if(!found) {
+            lines.insert(qMin(1, lines.size()), ".param " + parameter + "=" + value);
+        }
+
+        QFile output(variantFile);
+        if(!output.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            return false;
+        }
+
+        QTextStream stream(&output);
+        stream << lines.join("\n");
+
+        return true;
+    }
+
+} // namespace Caneda
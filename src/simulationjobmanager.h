@@ -0,0 +1,156 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef SIMULATION_JOB_MANAGER_H
+#define SIMULATION_JOB_MANAGER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+
+namespace Caneda
+{
+    /*!
+     * \brief Description of a simulation to be run by the
+     * SimulationJobManager.
+     *
+     * A job is made of one or more commands, which are run one after the
+     * other in the working directory (for example, the analysis, elaboration
+     * and run steps of a vhdl simulation). If any of the commands fails, the
+     * remaining ones are not run. The output of all commands is written to
+     * the log file.
+     *
+     * \sa SimulationJobManager
+     */
+    struct SimulationJob
+    {
+        //! Commands to run, in order.
+        QStringList commands;
+        //! Directory where the commands are run.
+        QString workingDirectory;
+        //! File receiving the output of the commands. May be empty.
+        QString logFile;
+        //! Environment of the commands. If empty, the system one is used.
+        QProcessEnvironment environment;
+    };
+
+    /*!
+     * \brief This class queues and runs simulation jobs.
+     *
+     * Simulations are run as external processes. Instead of starting and
+     * waiting for them on the spot, documents submit a SimulationJob with
+     * addJob() and get notified through the jobFinished() signal, so the
+     * event loop is never blocked while simulating.
+     *
+     * Up to maximumJobs() jobs run concurrently (by default, as many as
+     * processor cores), while the rest wait in a queue. This allows, for
+     * example, running all the netlist variants of a parameter sweep
+     * (created with addSweep()) at the same time.
+     *
+     * Every job is identified by an id, used to query its status() and log
+     * file, or to cancel() it. Finished jobs are kept until removeJob() is
+     * called, except canceled jobs, which are removed right after emitting
+     * jobFinished().
+     *
+     * This class is a singleton class and its only static instance (returned
+     * by instance()) is to be used.
+     *
+     * \sa SimulationJob
+     */
+    class SimulationJobManager : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        //! \brief Status of a job.
+        enum JobStatus {
+            Queued,         // Waiting for a free slot
+            Running,        // One of its commands is running
+            Finished,       // All commands finished successfully
+            Failed,         // A command crashed or returned an error code
+            FailedToStart,  // A command could not be started
+            Canceled,       // Canceled by the user
+            Unknown         // No job with the given id exists
+        };
+
+        static SimulationJobManager* instance();
+
+        int addJob(const SimulationJob &job);
+        QList<int> addSweep(const SimulationJob &job, const QString &netlistFile,
+                            const QString &parameter, const QStringList &values);
+
+        void cancel(int id);
+        void cancelAll();
+        void removeJob(int id);
+
+        JobStatus status(int id) const;
+        bool isActive(int id) const;
+        QString logFile(int id) const;
+
+        int maximumJobs() const;
+        //! Returns the number of jobs currently running.
+        int runningJobs() const { return m_processes.size(); }
+        //! Returns the number of jobs waiting to be run.
+        int queuedJobs() const { return m_queue.size(); }
+
+    Q_SIGNALS:
+        //! \brief Emitted when the first command of job \a id is started.
+        void jobStarted(int id);
+        //! \brief Emitted when job \a id finishes, fails or is canceled.
+        void jobFinished(int id);
+
+    private Q_SLOTS:
+        void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+        void processError(QProcess::ProcessError error);
+
+    private:
+        explicit SimulationJobManager(QObject *parent = 0);
+
+        //! \brief Internal state of a job.
+        struct JobData
+        {
+            SimulationJob job;
+            JobStatus status;
+            //! Index of the command being run.
+            int step;
+            QProcess *process;
+        };
+
+        void startJobs();
+        void startStep(int id);
+        void finishJob(int id, JobStatus status);
+
+        static bool writeSweepNetlist(const QString &netlistFile, const QString &variantFile,
+                                      const QString &parameter, const QString &value);
+
+        //! All known jobs, indexed by their id.
+        QHash<int, JobData> m_jobs;
+        //! Ids of the jobs waiting to be run, in order.
+        QList<int> m_queue;
+        //! Running processes, mapped to the id of their job.
+        QHash<QProcess*, int> m_processes;
+
+        int m_nextId;
+    };
+
+} // namespace Caneda
+
+#endif //SIMULATION_JOB_MANAGER_H
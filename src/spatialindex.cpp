@@ -0,0 +1,161 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "spatialindex.h"
+
+#include "port.h"
+#include "wire.h"
+
+#include <QtMath>
+
+namespace Caneda
+{
+    //! \brief Inserts \a port in the index, or updates its position.
+    void SpatialIndex::updatePort(Port *port)
+    {
+        Cell cell = portCell(port->scenePos());
+
+        QHash<Port*, Cell>::iterator it = m_portCells.find(port);
+        if(it != m_portCells.end()) {
+            if(it.value() == cell) {
+                return;
+            }
+            m_ports[it.value()].removeOne(port);
+            it.value() = cell;
+        }
+        else {
+            m_portCells.insert(port, cell);
+        }
+
+        m_ports[cell].append(port);
+    }
+
+    //! \brief Removes \a port from the index.
+    void SpatialIndex::removePort(Port *port)
+    {
+        QHash<Port*, Cell>::iterator it = m_portCells.find(port);
+        if(it == m_portCells.end()) {
+            return;
+        }
+
+        QHash<Cell, QList<Port*> >::iterator bucket = m_ports.find(it.value());
+        bucket->removeOne(port);
+        if(bucket->isEmpty()) {
+            m_ports.erase(bucket);
+        }
+
+        m_portCells.erase(it);
+    }
+
+    /*!
+     * \brief Returns the ports whose scene position rounds to the same point
+     * as \a pos.
+     *
+     * Callers needing an exact match must still compare the scene positions
+     * of the returned ports.
+     */
+    QList<Port*> SpatialIndex::ports(const QPointF &pos) const
+    {
+        return m_ports.value(portCell(pos));
+    }
+
+    //! \brief Inserts \a wire in the index, or updates its geometry.
+    void SpatialIndex::updateWire(Wire *wire)
+    {
+        // Same rect as Wire::boundingRect(), computed from the ports, as the
+        // wire geometry may not be updated yet while its ports are moving.
+        QRectF rect(wire->port1()->scenePos(), wire->port2()->scenePos());
+        rect = rect.normalized().adjusted(-portRadius, -portRadius, portRadius, portRadius);
+        QRect cells = wireCells(rect);
+
+        QHash<Wire*, QRect>::const_iterator it = m_wireCells.constFind(wire);
+        if(it != m_wireCells.constEnd()) {
+            if(it.value() == cells) {
+                return;
+            }
+            removeWire(wire);
+        }
+
+        for(int x = cells.left(); x <= cells.right(); ++x) {
+            for(int y = cells.top(); y <= cells.bottom(); ++y) {
+                m_wires[Cell(x, y)].append(wire);
+            }
+        }
+
+        m_wireCells.insert(wire, cells);
+    }
+
+    //! \brief Removes \a wire from the index.
+    void SpatialIndex::removeWire(Wire *wire)
+    {
+        QRect cells = m_wireCells.take(wire);
+        if(cells.isNull()) {
+            return;
+        }
+
+        for(int x = cells.left(); x <= cells.right(); ++x) {
+            for(int y = cells.top(); y <= cells.bottom(); ++y) {
+                QHash<Cell, QList<Wire*> >::iterator bucket = m_wires.find(Cell(x, y));
+                bucket->removeOne(wire);
+                if(bucket->isEmpty()) {
+                    m_wires.erase(bucket);
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Returns the wires whose cells overlap \a rect.
+     *
+     * The result may include wires near \a rect but not intersecting it, so
+     * callers must still check the geometry of the returned wires. Each wire
+     * is returned only once.
+     */
+    QList<Wire*> SpatialIndex::wires(const QRectF &rect) const
+    {
+        QRect cells = wireCells(rect);
+
+        QList<Wire*> result;
+        for(int x = cells.left(); x <= cells.right(); ++x) {
+            for(int y = cells.top(); y <= cells.bottom(); ++y) {
+                foreach(Wire *wire, m_wires.value(Cell(x, y))) {
+                    if(!result.contains(wire)) {
+                        result << wire;
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    //! \brief Returns the bucket of a port at scene position \a pos.
+    SpatialIndex::Cell SpatialIndex::portCell(const QPointF &pos)
+    {
+        return Cell(qRound(pos.x()), qRound(pos.y()));
+    }
+
+    //! \brief Returns the range of cells covered by \a rect.
+    QRect SpatialIndex::wireCells(const QRectF &rect)
+    {
+        return QRect(QPoint(qFloor(rect.left() / CellSize), qFloor(rect.top() / CellSize)),
+                     QPoint(qFloor(rect.right() / CellSize), qFloor(rect.bottom() / CellSize)));
+    }
+
+} // namespace Caneda
@@ -0,0 +1,93 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QRect>
+
+// Forward declarations
+class QPointF;
+class QRectF;
+
+namespace Caneda
+{
+    // Forward declarations
+    class Port;
+    class Wire;
+
+    /*!
+     * \brief The SpatialIndex class answers the geometric queries needed to
+     * connect the items of a scene: which ports lie at a given point, and
+     * which wires pass near a given area.
+     *
+     * The general purpose QGraphicsScene index answers these queries with
+     * collidingItems(), which walks a BSP tree and then needs every candidate
+     * to be filtered. As ports and wires snap to the scene grid, hashing them
+     * by position is much faster:
+     * \li Ports are hashed by their scene position, rounded to whole units.
+     * Coinciding ports always land in the same bucket, so a lookup costs a
+     * single hash access.
+     * \li Wires are hashed into square cells of CellSize units, once in each
+     * cell covered by their bounding rect. An area query only visits the
+     * cells it overlaps.
+     *
+     * Each GraphicsScene owns one SpatialIndex. Ports keep it up to date on
+     * their own, updating their entry (and that of their wire) whenever they
+     * are added to a scene, removed from it, or moved.
+     *
+     * \sa Port::findCoincidingPort(), GraphicsScene::splitAndCreateNodes()
+     */
+    class SpatialIndex
+    {
+    public:
+        void updatePort(Port *port);
+        void removePort(Port *port);
+        QList<Port*> ports(const QPointF &pos) const;
+
+        void updateWire(Wire *wire);
+        void removeWire(Wire *wire);
+        QList<Wire*> wires(const QRectF &rect) const;
+
+    private:
+        //! \brief Size of the wire cells, in scene units.
+        enum { CellSize = 50 };
+
+        typedef QPair<int, int> Cell;
+
+        static Cell portCell(const QPointF &pos);
+        static QRect wireCells(const QRectF &rect);
+
+        //! \brief Ports hashed by their rounded scene position.
+        QHash<Cell, QList<Port*> > m_ports;
+        //! \brief Current cell of each port in m_ports.
+        QHash<Port*, Cell> m_portCells;
+
+        //! \brief Wires hashed by the cells covered by their bounding rect.
+        QHash<Cell, QList<Wire*> > m_wires;
+        //! \brief Current range of cells of each wire in m_wires.
+        QHash<Wire*, QRect> m_wireCells;
+    };
+
+} // namespace Caneda
+
+#endif //SPATIAL_INDEX_H
@@ -22,6 +22,7 @@
 
 #include "actionmanager.h"
 #include "documentviewmanager.h"
+#include "fileformats.h"
 #include "graphicsscene.h"
 #include "graphicsview.h"
 #include "iview.h"
@@ -33,9 +34,96 @@
 
 #include <QApplication>
 #include <QClipboard>
+#include <QMimeData>
+#include <QStringList>
 
 namespace Caneda
 {
+    //! \brief Mime type of the items copied to the clipboard.
+    static const char ItemsMimeType[] = "application/x-caneda-items";
+    //! \brief Mime type of the identifier of the last copy.
+    static const char CopyIdMimeType[] = "application/x-caneda-copy-id";
+
+    /*!
+     * \brief Clipboard data of copied items, encoded only when requested.
+     *
+     * Copies of the items are kept in memory, to be pasted in this same
+     * instance of Caneda without decoding anything. The binary and xml
+     * formats are only generated (and then cached) if another instance of
+     * Caneda or another application reads the clipboard.
+     *
+     * \sa StateHandler::copy()
+     */
+    class ClipboardMimeData : public QMimeData
+    {
+    public:
+        explicit ClipboardMimeData(const QList<GraphicsItem*> &items)
+        {
+            foreach(GraphicsItem *item, items) {
+                m_items << item->copy();
+            }
+        }
+
+        ~ClipboardMimeData()
+        {
+            qDeleteAll(m_items);
+        }
+
+        //! \brief Returns the copies of the items, owned by this object.
+        QList<GraphicsItem*> items() const { return m_items; }
+
+        QStringList formats() const
+        {
+            return QMimeData::formats() << ItemsMimeType << "text/plain";
+        }
+
+    protected:
+        QVariant retrieveData(const QString &mimeType, QVariant::Type type) const
+        {
+            if(mimeType == ItemsMimeType) {
+                if(m_binary.isEmpty()) {
+                    m_binary = FormatBinary::saveItems(m_items);
+                }
+                return m_binary;
+            }
+
+            if(mimeType == "text/plain") {
+                if(m_text.isEmpty()) {
+                    m_text = itemsToXml();
+                }
+                return m_text;
+            }
+
+            return QMimeData::retrieveData(mimeType, type);
+        }
+
+    private:
+        //! \brief Returns the items saved in xml format.
+        QString itemsToXml() const
+        {
+            QString text;
+            Caneda::XmlWriter *writer = new Caneda::XmlWriter(&text);
+            writer->setAutoFormatting(true);
+            writer->writeStartDocument();
+            writer->writeDTD(QString("<!DOCTYPE caneda>"));
+            writer->writeStartElement("caneda");
+            writer->writeAttribute("version", Caneda::version());
+
+            foreach(GraphicsItem *item, m_items) {
+                item->saveData(writer);
+            }
+
+            writer->writeEndDocument();
+            delete writer;
+
+            return text;
+        }
+
+        QList<GraphicsItem*> m_items;  // Copies of the copied items
+        mutable QByteArray m_binary;  // Binary data, once requested
+        mutable QString m_text;  // Xml text, once requested
+    };
+
     //! \brief Constructor.
     StateHandler::StateHandler(QObject *parent) : QObject(parent)
     {
@@ -245,15 +333,83 @@ namespace Caneda
         }
     }
 
+    /*!
+     * \brief Copies \a items to the clipboard.
+     *
+     * The items are offered in the clipboard in two formats: the compact
+     * binary format of FormatBinary, under the ItemsMimeType mime type, and
+     * the xml format as plain text, to be read by other applications.
+     * Both are generated only when requested by the reader of the clipboard.
+     *
+     * Copies of the items are kept in memory along with the clipboard data.
+     * When pasting in this same instance of Caneda, those copies are used
+     * instead of decoding the clipboard.
+     *
+     * \sa paste(), ClipboardMimeData
+     */
+    void StateHandler::copy(const QList<GraphicsItem*> &items)
+    {
+        if(items.isEmpty()) {
+            return;
+        }
+
+        // The identifier tells this copy from copies made by other instances
+        // of Caneda, or by this one before.
+        static int copyCount = 0;
+        clipboardId = QByteArray::number(QCoreApplication::applicationPid()) + '-' +
+                      QByteArray::number(++copyCount);
+
+        clipboardData = new ClipboardMimeData(items);
+        clipboardData->setData(CopyIdMimeType, clipboardId);
+
+        QClipboard *clipboard =  QApplication::clipboard();
+        clipboard->setMimeData(clipboardData);
+    }
+
     /*!
      * \brief This method handles the paste action by reading the clipboard and
      * inserting (if found) the corresponding items.
+     *
+     * The items are read from the first available of:
+     * \li The copies kept by copy(), if the clipboard still holds the last
+     * copy made by this instance.
+     * \li The binary data under ItemsMimeType.
+     * \li The xml text.
+     *
+     * \sa copy()
      */
     void StateHandler::paste()
     {
         QClipboard *clipboard =  QApplication::clipboard();
-        const QString text = clipboard->text();
+        const QMimeData *mimeData = clipboard->mimeData();
+        if(!mimeData) {
+            return;
+        }
+
+        QList<GraphicsItem*> items;
+        if(clipboardData && mimeData->data(CopyIdMimeType) == clipboardId) {
+            foreach(GraphicsItem *item, clipboardData->items()) {
+                items << item->copy();
+            }
+        }
+        else if(mimeData->hasFormat(ItemsMimeType)) {
+            items = FormatBinary::loadItems(mimeData->data(ItemsMimeType));
+        }
+        else {
+            items = itemsFromXml(mimeData->text());
+        }
 
+        if (!items.isEmpty()) {
+            clearInsertibles();
+            insertibles = items;
+            performToggleAction("insertItem", true);
+        }
+    }
+
+    //! \brief Returns the items saved in the xml \a text.
+    QList<GraphicsItem*> StateHandler::itemsFromXml(const QString &text)
+    {
+        QList<GraphicsItem*> items;
         Caneda::XmlReader reader(text.toUtf8());
 
         while(!reader.atEnd()) {
@@ -265,14 +421,13 @@ namespace Caneda
         }
 
         if(reader.hasError() || !(reader.isStartElement() && reader.name() == "caneda")) {
-            return;
+            return items;
         }
 
         if(!Caneda::checkVersion(reader.attributes().value("version").toString())) {
-            return;
+            return items;
         }
 
-        QList<GraphicsItem*> items;
         while(!reader.atEnd()) {
             reader.readNext();
 
@@ -306,11 +461,7 @@ namespace Caneda
             }
         }
 
-        if (!items.isEmpty()) {
-            clearInsertibles();
-            insertibles = items;
-            performToggleAction("insertItem", true);
-        }
+        return items;
     }
 
     //! \brief Apply the cursor of the current state to the given view.
@@ -24,10 +24,12 @@
 #include "global.h"
 
 #include <QObject>
+#include <QPointer>
 
 namespace Caneda
 {
     // Forward declarations.
+    class ClipboardMimeData;
     class GraphicsItem;
     class GraphicsView;
     class Painting;
@@ -59,6 +61,8 @@ namespace Caneda
         static StateHandler* instance();
         ~StateHandler();
 
+        void copy(const QList<GraphicsItem*> &items);
+
     public Q_SLOTS:
         void setNormalAction();
         void performToggleAction(bool on);
@@ -75,9 +79,16 @@ namespace Caneda
 
         void clearInsertibles();
 
+        static QList<GraphicsItem*> itemsFromXml(const QString &text);
+
         Caneda::MouseAction mouseAction;
         QList<GraphicsItem*> insertibles;
         Painting *paintingDrawItem;
+
+        //! \brief Data of the last copy, while still owned by the clipboard
+        QPointer<ClipboardMimeData> clipboardData;
+        //! \brief Identifier of the last copy, stored along with the clipboard data
+        QByteArray clipboardId;
     };
 
 } // namespace Caneda
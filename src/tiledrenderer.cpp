@@ -0,0 +1,122 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#include "tiledrenderer.h"
+
+#include <QFontDatabase>
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QtConcurrentMap>
+
+namespace Caneda
+{
+    /*!
+     * \brief Constructs a renderer of the \a source area of \a scene into
+     * \a image, stretching the area to the whole image.
+     */
+    TiledRenderer::TiledRenderer(QGraphicsScene *scene, const QRectF &source,
+                                 QImage *image) :
+        m_scene(scene),
+        m_source(source),
+        m_image(image)
+    {
+    }
+
+    /*!
+     * \brief Renders the scene into the image.
+     *
+     * Images fitting in a single tile, or whose pixels are smaller than a
+     * byte, are rendered directly. If the platform can't render text outside
+     * the gui thread, the tiles are played back on the gui thread too.
+     */
+    void TiledRenderer::render()
+    {
+        const int width = m_image->width();
+        const int height = m_image->height();
+
+        if((width <= TileSize && height <= TileSize) || m_image->depth() < 8) {
+            QPainter painter(m_image);
+            m_scene->render(&painter, QRectF(0, 0, width, height), m_source,
+                            Qt::IgnoreAspectRatio);
+            return;
+        }
+
+        // Get the pixels here, as bits() may not be called concurrently
+        uchar *bits = m_image->bits();
+        const int bytesPerLine = m_image->bytesPerLine();
+        const int bytesPerPixel = m_image->depth() / 8;
+
+        const qreal scaleX = m_source.width() / width;
+        const qreal scaleY = m_source.height() / height;
+
+        const bool threaded = QFontDatabase::supportsThreadedFontRendering();
+
+        for(int y = 0; y < height; y += TileSize) {
+            QList<Tile> row;
+
+            // Record the tiles of this row
+            for(int x = 0; x < width; x += TileSize) {
+                Tile tile;
+                tile.rect = QRect(x, y, qMin(int(TileSize), width - x), qMin(int(TileSize), height - y));
+                tile.bits = bits + y * bytesPerLine + x * bytesPerPixel;
+                tile.bytesPerLine = bytesPerLine;
+                tile.format = m_image->format();
+
+                QRectF source(m_source.left() + x * scaleX,
+                              m_source.top() + y * scaleY,
+                              tile.rect.width() * scaleX,
+                              tile.rect.height() * scaleY);
+
+                QPainter painter(&tile.picture);
+                m_scene->render(&painter, QRectF(QPointF(0, 0), tile.rect.size()), source,
+                                Qt::IgnoreAspectRatio);
+                painter.end();
+
+                row << tile;
+            }
+
+            // Rasterize them
+            if(threaded) {
+                QtConcurrent::blockingMap(row, &TiledRenderer::renderTile);
+            }
+            else {
+                for(int i = 0; i < row.size(); ++i) {
+                    renderTile(row[i]);
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Plays back the recorded picture of \a tile into its region of
+     * the destination image.
+     *
+     * The region is wrapped in a QImage sharing the pixels of the destination
+     * image, so that each tile is painted with its own QPainter.
+     */
+    void TiledRenderer::renderTile(Tile &tile)
+    {
+        QImage region(tile.bits, tile.rect.width(), tile.rect.height(),
+                      tile.bytesPerLine, tile.format);
+
+        QPainter painter(&region);
+        painter.drawPicture(0, 0, tile.picture);
+    }
+
+} // namespace Caneda
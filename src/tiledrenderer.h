@@ -0,0 +1,81 @@
+/***************************************************************************
+ * Copyright (C) 2016 by Pablo Daniel Pareja Obregon                       *
+ *                                                                         *
+ * This is free software; you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 2, or (at your option)     *
+ * any later version.                                                      *
+ *                                                                         *
+ * This software is distributed in the hope that it will be useful,        *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License       *
+ * along with this package; see the file COPYING.  If not, write to        *
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,   *
+ * Boston, MA 02110-1301, USA.                                             *
+ ***************************************************************************/
+
+#ifndef TILED_RENDERER_H
+#define TILED_RENDERER_H
+
+#include <QImage>
+#include <QList>
+#include <QPicture>
+#include <QRectF>
+
+// Forward declarations
+class QGraphicsScene;
+
+namespace Caneda
+{
+    /*!
+     * \brief The TiledRenderer class renders an area of a scene into a large
+     * image, splitting it into tiles rendered concurrently.
+     *
+     * Items of a scene may only be used from the gui thread, so rendering a
+     * poster-size image with QGraphicsScene::render() rasterizes the whole
+     * scene on that thread. Instead, the image is split into rows of tiles.
+     * For each tile, the drawing commands of the items are recorded into a
+     * QPicture on the gui thread, which is cheap as nothing is rasterized.
+     * Those pictures are an immutable snapshot of the scene, and are then
+     * played back on worker threads, each one painting directly into its own
+     * region of the destination image.
+     *
+     * Only one row of tiles is recorded at a time, so the memory used by the
+     * snapshots doesn't grow with the size of the image.
+     *
+     * \sa GraphicsScene::exportImage()
+     */
+    class TiledRenderer
+    {
+    public:
+        TiledRenderer(QGraphicsScene *scene, const QRectF &source, QImage *image);
+
+        void render();
+
+        //! \brief Width and height of the tiles, in pixels.
+        enum { TileSize = 512 };
+
+    private:
+        //! \brief Region of the image rendered by a worker thread.
+        struct Tile
+        {
+            QRect rect;  // Region of the destination image
+            QPicture picture;  // Recorded drawing commands of the region
+            uchar *bits;  // First pixel of the region in the destination image
+            int bytesPerLine;  // Bytes per line of the destination image
+            QImage::Format format;  // Format of the destination image
+        };
+
+        static void renderTile(Tile &tile);
+
+        QGraphicsScene *m_scene;  // Scene being rendered
+        QRectF m_source;  // Area of the scene to render
+        QImage *m_image;  // Destination image
+    };
+
+} // namespace Caneda
+
+#endif //TILED_RENDERER_H
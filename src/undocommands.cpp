@@ -46,11 +46,13 @@ namespace Caneda
                              const QPointF &init,
                              const QPointF &end,
                              QUndoCommand *parent) :
-        QUndoCommand(parent),
-        m_item(item),
-        m_initialPos(init),
-        m_finalPos(end)
+        QUndoCommand(parent)
     {
+        Move move;
+        move.item = item;
+        move.initialPos = init;
+        move.finalPos = end;
+        m_moves << move;
     }
 
     /*!
@@ -67,13 +69,10 @@ namespace Caneda
      */
     void MoveItemCmd::undo()
     {
-        if(m_item->parentItem()) {
-            QPointF p = m_item->mapFromScene(m_initialPos);
-            p = m_item->mapToParent(p);
-            m_item->setPos(p);
-        }
-        else {
-            m_item->setPos(m_initialPos);
+        // Undo in reverse order, as the same item may have been moved more
+        // than once.
+        for(int i = m_moves.size() - 1; i >= 0; --i) {
+            moveItem(m_moves.at(i).item, m_moves.at(i).initialPos);
         }
     }
 
@@ -91,13 +90,39 @@ namespace Caneda
      */
     void MoveItemCmd::redo()
     {
-        if(m_item->parentItem()) {
-            QPointF p = m_item->mapFromScene(m_finalPos);
-            p = m_item->mapToParent(p);
-            m_item->setPos(p);
+        foreach(const Move &move, m_moves) {
+            moveItem(move.item, move.finalPos);
+        }
+    }
+
+    /*!
+     * \brief Merges \a other, a move command pushed right after this one,
+     * into this command.
+     *
+     * QUndoStack calls this method when pushing a command with the same id()
+     * as the last one pushed (or the last child of the open macro). Instead
+     * of keeping one command per moved item, the moves of \a other are
+     * appended to this command, which is then undone and redone as a whole.
+     *
+     * \sa id()
+     */
+    bool MoveItemCmd::mergeWith(const QUndoCommand *other)
+    {
+        const MoveItemCmd *command = static_cast<const MoveItemCmd*>(other);
+        m_moves << command->m_moves;
+        return true;
+    }
+
+    //! \brief Moves \a item to the scene position \a pos.
+    void MoveItemCmd::moveItem(GraphicsItem *item, const QPointF &pos)
+    {
+        if(item->parentItem()) {
+            QPointF p = item->mapFromScene(pos);
+            p = item->mapToParent(p);
+            item->setPos(p);
         }
         else {
-            m_item->setPos(m_finalPos);
+            item->setPos(pos);
         }
     }
 
@@ -135,20 +160,40 @@ namespace Caneda
                                  QUndoCommand *parent) :
         QUndoCommand(parent),
         m_wire(wire),
-        m_scene(scene)
+        m_scene(scene),
+        m_ownsItem(true)
+    {
+    }
+
+    /*!
+     * \brief Destructor.
+     *
+     * Commands removing items from the scene own them until they are
+     * undone. When the command is destroyed (either because the undo stack
+     * was cleared, the command fell off the undo limit or was discarded
+     * while undone) the items it still owns are deleted.
+     */
+    InsertWireCmd::~InsertWireCmd()
     {
+        if(m_ownsItem) {
+            delete m_wire;
+        }
     }
 
     //! \copydoc MoveItemCmd::undo()
     void InsertWireCmd::undo()
     {
+        m_scene->disconnectItems(m_wire);
         m_scene->removeItem(m_wire);
+        m_ownsItem = true;
     }
 
     //! \copydoc MoveItemCmd::redo()
     void InsertWireCmd::redo()
     {
         m_scene->addItem(m_wire);
+        m_scene->connectItems(m_wire);
+        m_ownsItem = false;
     }
 
 
@@ -163,15 +208,25 @@ namespace Caneda
         QUndoCommand(parent),
         m_item(item),
         m_scene(scene),
-        m_pos(pos)
+        m_pos(pos),
+        m_ownsItem(true)
     {
     }
 
+    //! \copydoc InsertWireCmd::~InsertWireCmd()
+    InsertItemCmd::~InsertItemCmd()
+    {
+        if(m_ownsItem) {
+            delete m_item;
+        }
+    }
+
     //! \copydoc MoveItemCmd::undo()
     void InsertItemCmd::undo()
     {
         m_scene->disconnectItems(m_item);
         m_scene->removeItem(m_item);
+        m_ownsItem = true;
     }
 
     //! \copydoc MoveItemCmd::redo()
@@ -181,6 +236,7 @@ namespace Caneda
         m_item->setPos(m_pos);
         m_scene->connectItems(m_item);
         m_scene->splitAndCreateNodes(m_item);
+        m_ownsItem = false;
     }
 
 
@@ -192,10 +248,54 @@ namespace Caneda
                                    GraphicsScene *scene,
                                    QUndoCommand *parent) :
         QUndoCommand(parent),
-        m_scene(scene)
+        m_scene(scene),
+        m_ownsItems(false),
+        m_cost(0),
+        m_undoIndex(scene->undoStack()->index())
     {
         foreach(GraphicsItem *item, items) {
             m_itemPointPairs << ItemPointPair(item, item->pos());
+
+            // Child items, such as property groups, are deleted along
+            m_cost += ItemCost * (1 + item->childItems().size());
+            m_cost += PortCost * item->ports().size();
+        }
+
+        m_scene->addRemoveCommand(this);
+    }
+
+    //! \copydoc InsertWireCmd::~InsertWireCmd()
+    RemoveItemsCmd::~RemoveItemsCmd()
+    {
+        m_scene->removeRemoveCommand(this);
+        release();
+    }
+
+    /*!
+     * \brief Returns the estimated bytes used by the removed items while they
+     * are kept by this command, or 0 while they are in the scene.
+     */
+    qint64 RemoveItemsCmd::cost() const
+    {
+        return m_ownsItems ? m_cost : 0;
+    }
+
+    /*!
+     * \brief Deletes the removed items kept by this command, which does
+     * nothing afterwards.
+     *
+     * The scene must not undo the history past this command once released.
+     *
+     * \sa GraphicsScene::trimUndoHistory()
+     */
+    void RemoveItemsCmd::release()
+    {
+        if(m_ownsItems) {
+            foreach(ItemPointPair p, m_itemPointPairs) {
+                delete p.first;
+            }
+            m_itemPointPairs.clear();
+            m_ownsItems = false;
         }
     }
 
@@ -207,6 +307,7 @@ namespace Caneda
             p.first->setPos(p.second);
             m_scene->connectItems(p.first);
         }
+        m_ownsItems = false;
     }
 
     //! \copydoc MoveItemCmd::redo()
@@ -216,6 +317,7 @@ namespace Caneda
             m_scene->disconnectItems(p.first);
             m_scene->removeItem(p.first);
         }
+        m_ownsItems = true;
     }
 
 
@@ -26,6 +26,7 @@
 
 #include <QPair>
 #include <QUndoCommand>
+#include <QVector>
 
 namespace Caneda
 {
@@ -73,6 +74,11 @@ namespace Caneda
      * apply a change to a document with the redo() method and undo the change
      * with the undo() method. The implementations for these functions must be
      * provided in each derived class.
+     *
+     * Moving a selection pushes one MoveItemCmd per item. Consecutive move
+     * commands are merged (see mergeWith()) into a single command holding
+     * the list of moves, so that dragging thousands of items adds only one
+     * compact command to the undo stack.
      */
     class MoveItemCmd : public QUndoCommand
     {
@@ -85,10 +91,23 @@ namespace Caneda
         void undo();
         void redo();
 
+        //! \brief Identifies move commands, allowing them to be merged.
+        enum { Id = 1 };
+        int id() const { return Id; }
+        bool mergeWith(const QUndoCommand *other);
+
     private:
-        GraphicsItem *m_item;
-        QPointF m_initialPos;
-        QPointF m_finalPos;
+        //! \brief Single item move, in scene coordinates.
+        struct Move
+        {
+            GraphicsItem *item;
+            QPointF initialPos;
+            QPointF finalPos;
+        };
+
+        static void moveItem(GraphicsItem *item, const QPointF &pos);
+
+        QVector<Move> m_moves;
     };
 
     /*!
@@ -123,12 +142,15 @@ namespace Caneda
                                GraphicsScene *scene,
                                QUndoCommand *parent = 0);
 
+        ~InsertWireCmd();
+
         void undo();
         void redo();
 
     private:
         Wire *m_wire;
         GraphicsScene *m_scene;
+        bool m_ownsItem;  // True while the item is out of the scene
     };
 
     /*!
@@ -145,6 +167,8 @@ namespace Caneda
                                GraphicsScene *scene,
                                QUndoCommand *parent = 0);
 
+        ~InsertItemCmd();
+
         void undo();
         void redo();
 
@@ -152,13 +176,18 @@ namespace Caneda
         GraphicsItem *const m_item;
         GraphicsScene *const m_scene;
         QPointF m_pos;
+        bool m_ownsItem;  // True while the item is out of the scene
     };
 
     /*!
      * \brief Remove items command implementation of the QUndoCommand/QUndoStack
      * pattern for Qt's Undo Framework.
      *
+     * The removed items are kept by the command to be restored on undo. The
+     * scene may release them once the undo history exceeds its memory budget.
+     *
      * \copydetails MoveItemCmd
+     * \sa GraphicsScene::trimUndoHistory()
      */
     class RemoveItemsCmd : public QUndoCommand
     {
@@ -167,12 +196,26 @@ namespace Caneda
                                 GraphicsScene *scene,
                                 QUndoCommand *parent = 0);
 
+        ~RemoveItemsCmd();
+
         void undo();
         void redo();
 
+        qint64 cost() const;
+        void release();
+
+        //! \brief Index in the undo stack of the top level command holding this one.
+        int undoIndex() const { return m_undoIndex; }
+
+        //! \brief Estimated bytes used by a removed item and by each of its ports.
+        enum { ItemCost = 1024, PortCost = 256 };
+
     protected:
         QList<ItemPointPair> m_itemPointPairs;
         GraphicsScene *const m_scene;
+        bool m_ownsItems;  // True while the items are out of the scene
+        qint64 m_cost;  // Estimated bytes used by the items
+        const int m_undoIndex;  // Undo stack index, recorded when created
     };
 
     /*!
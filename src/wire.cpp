@@ -22,7 +22,9 @@
 
 #include "actionmanager.h"
 #include "global.h"
+#include "graphicsscene.h"
 #include "settings.h"
+#include "spatialindex.h"
 #include "xmlutilities.h"
 
 #include <QGraphicsSceneEvent>
@@ -43,7 +45,9 @@ namespace Caneda
      * \param parent Parent of the Wire item.
      */
     Wire::Wire(const QPointF& startPos, const QPointF& endPos,
-               QGraphicsItem *parent) : GraphicsItem(parent)
+               QGraphicsItem *parent) :
+        GraphicsItem(parent),
+        m_shapeOutdated(true)
     {
         // Set flags
         setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
@@ -63,6 +67,11 @@ namespace Caneda
     //! \brief Destructor.
     Wire::~Wire()
     {
+        GraphicsScene *graphicsScene = qobject_cast<GraphicsScene*>(scene());
+        if(graphicsScene) {
+            graphicsScene->spatialIndex()->removeWire(this);
+        }
+
         qDeleteAll(m_ports);
     }
 
@@ -94,23 +103,38 @@ namespace Caneda
         updateGeometry();
     }
 
-    //! \brief Updates the wire's geometry and caches it.
+    //! \brief Notifies the scene of a change in the wire's geometry.
     void Wire::updateGeometry()
     {
-        // Create a path for the shape using a QPainterPathStroker to allow for
-        // a thick selection band. Otherwise, if we use only a line, it is very
-        // difficult to make a wire selection. The last alternative is to use a
-        // QRect as a shape, but that would extend far off limits the selection
-        // of diagonal wires.
-        QPainterPath path;
-        path.moveTo(port1()->pos());
-        path.lineTo(port2()->pos());
-
-        QPainterPathStroker stroker;
-        stroker.setWidth(2*portRadius);
-        path = stroker.createStroke(path);
-
-        GraphicsItem::setShapeAndBoundRect(path, boundingRect());
+        // The bounding rect is computed from the ports, but stroking the
+        // shape is expensive, and wires change their geometry on every mouse
+        // move while being dragged. Hence, the shape is only rebuilt once it
+        // is needed, in shape().
+        prepareGeometryChange();
+        m_shapeOutdated = true;
+    }
+
+    //! \brief Returns the shape of the wire, rebuilding it if outdated.
+    QPainterPath Wire::shape() const
+    {
+        if(m_shapeOutdated) {
+            // Create a path for the shape using a QPainterPathStroker to allow for
+            // a thick selection band. Otherwise, if we use only a line, it is very
+            // difficult to make a wire selection. The last alternative is to use a
+            // QRect as a shape, but that would extend far off limits the selection
+            // of diagonal wires.
+            QPainterPath path;
+            path.moveTo(port1()->pos());
+            path.lineTo(port2()->pos());
+
+            QPainterPathStroker stroker;
+            stroker.setWidth(2*portRadius);
+
+            m_wireShape = stroker.createStroke(path);
+            m_shapeOutdated = false;
+        }
+
+        return m_wireShape;
     }
 
     //! \brief Returns bounding rectangle arround the wire
@@ -141,14 +165,12 @@ namespace Caneda
         QPen savedPen = painter->pen();
 
         // Set global pen settings
-        Settings *settings = Settings::instance();
+        const RenderSettings &settings = Settings::instance()->renderSettings();
         if(option->state & QStyle::State_Selected) {
-            painter->setPen(QPen(settings->currentValue("gui/selectionColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(settings.selectionPen);
         }
         else {
-            painter->setPen(QPen(settings->currentValue("gui/lineColor").value<QColor>(),
-                                 settings->currentValue("gui/lineWidth").toInt()));
+            painter->setPen(settings.linePen);
         }
 
         // Draw the wire
@@ -156,6 +178,8 @@ namespace Caneda
 
         // Restore pen
         painter->setPen(savedPen);
+
+        paintPorts(painter);
     }
 
     //! \copydoc GraphicsItem::copy()
@@ -66,6 +66,7 @@ namespace Caneda
 
         void updateGeometry();
         QRectF boundingRect() const;
+        QPainterPath shape() const;
 
         void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                 QWidget *widget = 0);
@@ -80,6 +81,10 @@ namespace Caneda
 
     protected:
         void contextMenuEvent(QGraphicsSceneContextMenuEvent *event);
+
+    private:
+        mutable QPainterPath m_wireShape; //! Shape cache, built by shape()
+        mutable bool m_shapeOutdated; //! Shape cache must be rebuilt
     };
 
 } // namespace Caneda
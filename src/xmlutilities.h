@@ -56,6 +56,8 @@ namespace Caneda
     public:
         //! Constructs an xml stream reader acting on \a data.
         explicit XmlReader(const QByteArray & data) : QXmlStreamReader(data) {}
+        //! Constructs an xml stream reader reading incrementally from \a device.
+        explicit XmlReader(QIODevice *device) : QXmlStreamReader(device) {}
 
         int readInt();
         double readDouble();